@@ -0,0 +1,103 @@
+// This file provides the implementation of the Animation class
+// - author: Jared Bechthold
+
+#include "animation.h"
+#include "rayTracer.h"
+
+//--------------------------------------------------------------
+// Finds the keys around the frame and blends their values
+glm::vec3 AnimationTrack::evaluate(int frame) const {
+	if (keys.empty()) return glm::vec3(0);
+	if (frame <= keys.front().frame) return keys.front().value;
+	if (frame >= keys.back().frame) return keys.back().value;
+	size_t next = 1;
+	while (keys[next].frame < frame) next++;
+	const Keyframe &a = keys[next - 1];
+	const Keyframe &b = keys[next];
+	float t = (float)(frame - a.frame) / (b.frame - a.frame);
+	return glm::mix(a.value, b.value, t);
+}
+
+//--------------------------------------------------------------
+// Inserts the key in frame order
+void Animation::addKey(AnimationTarget target, int index, AnimatedProperty property, int frame, const glm::vec3 &value) {
+	AnimationTrack *track = NULL;
+	for (AnimationTrack &existing : tracks) {
+		if (existing.target == target && existing.index == index && existing.property == property) track = &existing;
+	}
+	if (track == NULL) {
+		tracks.emplace_back();
+		track = &tracks.back();
+		track->target = target;
+		track->index = index;
+		track->property = property;
+	}
+	auto key = track->keys.begin();
+	while (key != track->keys.end() && key->frame < frame) key++;
+	if (key != track->keys.end() && key->frame == frame) key->value = value;
+	else track->keys.insert(key, { frame, value });
+}
+
+//--------------------------------------------------------------
+// Moves an element to a new position
+static void setPosition(RayTracer &rayTracer, const AnimationTrack &track, const glm::vec3 &position) {
+	switch (track.target) {
+	case TARGET_CAMERA: {
+		// the aim and ViewPlane are given in world coordinates, so they are moved
+		// with the camera (aim tracks, applied after every position, override the aim)
+		RenderCam &camera = rayTracer.renderCam;
+		glm::vec3 delta = position - camera.position;
+		camera.position = position;
+		camera.aim += delta;
+		camera.view.setSize(camera.view.min + glm::vec2(delta.x, delta.y), camera.view.max + glm::vec2(delta.x, delta.y));
+		camera.view.position.z += delta.z;
+		break;
+	}
+	case TARGET_AREA_LIGHT:
+		rayTracer.areaLight.translate(position - rayTracer.areaLight.position);
+		break;
+	case TARGET_OBJECT: {
+		SceneObject *object = rayTracer.scene[track.index];
+		if (object->type == OBJECT_MESH) static_cast<Mesh *>(object)->translate(position - object->position);
+		else object->position = position;
+		break;
+	}
+	case TARGET_LIGHT:
+		rayTracer.lights[track.index].position = position;
+		break;
+	case TARGET_MESH_LIGHT:
+		rayTracer.meshLights[track.index].translate(position - rayTracer.meshLights[track.index].position);
+		break;
+	}
+}
+
+//--------------------------------------------------------------
+// Evaluates every track at the frame and writes its value to the scene
+void Animation::apply(RayTracer &rayTracer, int frame) const {
+	for (const AnimationTrack &track : tracks) {
+		// tracks of elements that no longer exist are skipped
+		if (track.target == TARGET_OBJECT && track.index >= (int)rayTracer.scene.size()) continue;
+		if (track.target == TARGET_LIGHT && track.index >= (int)rayTracer.lights.size()) continue;
+		if (track.target == TARGET_MESH_LIGHT && track.index >= (int)rayTracer.meshLights.size()) continue;
+		glm::vec3 value = track.evaluate(frame);
+		if (track.property == PROPERTY_POSITION) {
+			setPosition(rayTracer, track, value);
+		}
+		else if (track.property == PROPERTY_AIM) {
+			continue;
+		}
+		else if (track.target == TARGET_AREA_LIGHT) {
+			rayTracer.areaLight.setIntensity(value.x);
+		}
+		else if (track.target == TARGET_LIGHT) {
+			rayTracer.lights[track.index].setIntensity(value.x);
+		}
+		else if (track.target == TARGET_MESH_LIGHT) {
+			rayTracer.meshLights[track.index].setIntensity(value.x);
+		}
+	}
+	// the camera aim last, since moving the camera also moves its aim
+	for (const AnimationTrack &track : tracks) {
+		if (track.property == PROPERTY_AIM) rayTracer.renderCam.aim = track.evaluate(frame);
+	}
+}
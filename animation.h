@@ -0,0 +1,67 @@
+// This file provides the class definitions of Animation and AnimationTrack,
+// the keyframed camera, light and object parameters of a scene sequence
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+class RayTracer;
+
+// kinds of scene element a track animates
+enum AnimationTarget : uint8_t {
+	TARGET_CAMERA = 0,		// the RenderCam (its aim and ViewPlane move along with it)
+	TARGET_AREA_LIGHT = 1,	// the area light
+	TARGET_OBJECT = 2,		// RayTracer::scene[index]
+	TARGET_LIGHT = 3,		// RayTracer::lights[index]
+	TARGET_MESH_LIGHT = 4	// RayTracer::meshLights[index]
+};
+
+// parameters a track can animate
+enum AnimatedProperty : uint8_t {
+	PROPERTY_POSITION = 0,	// position (x, y, z)
+	PROPERTY_INTENSITY = 1,	// light intensity (stored in x)
+	PROPERTY_AIM = 2		// point the camera looks at
+};
+
+//  Value of a property at one frame
+//
+struct Keyframe {
+	int frame;			// frame number of the key
+	glm::vec3 value;	// value of the property at the frame
+};
+
+//  Keys of one property of one scene element, sorted by frame
+//  Values between keys are interpolated linearly and hold the first or
+//  last key's value outside of the keyed range.
+//
+struct AnimationTrack {
+	AnimationTarget target = TARGET_OBJECT;		// kind of element animated
+	int index = 0;								// element index (objects, lights and mesh lights only)
+	AnimatedProperty property = PROPERTY_POSITION;	// parameter animated
+	std::vector<Keyframe> keys;					// keys sorted by frame
+
+	// returns the value of the property at a frame
+	glm::vec3 evaluate(int frame) const;
+};
+
+//  Keyframed parameters of a scene and the length of its sequence
+//
+class Animation {
+public:
+	// removes every track
+	void clear() { tracks.clear(); frameCount = 1; }
+	// returns true if nothing is animated
+	bool empty() const { return tracks.empty(); }
+	// adds a key to the track of the element's property, replacing a key at the same frame
+	void addKey(AnimationTarget target, int index, AnimatedProperty property, int frame, const glm::vec3 &value);
+	// moves the animated elements of rayTracer to their values at a frame. Meshes
+	// and the area and mesh lights are translated in place, so nothing is reloaded or
+	// rebuilt; the scene BVH is refit by the next render (see RayTracer::refitBVH)
+	void apply(RayTracer &rayTracer, int frame) const;
+
+	std::vector<AnimationTrack> tracks;	// one track per animated property
+	int frameCount = 1;					// frames of the sequence
+};
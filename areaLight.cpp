@@ -0,0 +1,203 @@
+// This file provides the implementation of area light sampling
+// - author: Jared Bechthold
+
+#include "rayTracer.h"
+#include "watertightRay.h"
+
+// returns the centroid of a triangle
+static glm::vec3 centroidOf(const vector<glm::vec3> &verts, const Triangle &t) {
+	return (verts[t.vertInd[0]] + verts[t.vertInd[1]] + verts[t.vertInd[2]]) / 3.0f;
+}
+
+// splits triangles [first, last) at the median centroid of their longest axis
+// until every range holds at most clusterSize triangles, appending one
+// cluster per range
+static void splitClusters(const vector<glm::vec3> &verts, vector<Triangle> &triangles, int first, int last,
+	int clusterSize, vector<LightCluster> &clusters) {
+	if (last - first <= clusterSize) {
+		LightCluster cluster;
+		cluster.firstTriangle = first;
+		cluster.triangleCount = last - first;
+		clusters.push_back(cluster);
+		return;
+	}
+
+	// split along the axis where the centroids spread the most
+	AABB centroidBounds;
+	for (int i = first; i < last; i++) {
+		centroidBounds.expand(centroidOf(verts, triangles[i]));
+	}
+	glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	int middle = (first + last) / 2;
+	std::nth_element(triangles.begin() + first, triangles.begin() + middle, triangles.begin() + last,
+		[&](const Triangle &a, const Triangle &b) {
+		return centroidOf(verts, a)[axis] < centroidOf(verts, b)[axis];
+	});
+	splitClusters(verts, triangles, first, middle, clusterSize, clusters);
+	splitClusters(verts, triangles, middle, last, clusterSize, clusters);
+}
+
+//--------------------------------------------------------------
+// Groups the triangles into about sqrt(n) spatial clusters of about sqrt(n)
+// triangles each, so choosing a cluster per sample costs O(sqrt(n)), and
+// records the running area of the triangles in their new order
+void AreaLight::buildSampling() {
+	triangleCdf.clear();
+	clusters.clear();
+	area = 0;
+	if (triangles.empty()) return;
+
+	int clusterSize = std::max(1, (int)sqrt((double)triangles.size()));
+	splitClusters(verts, triangles, 0, (int)triangles.size(), clusterSize, clusters);
+
+	// running area of the triangles
+	triangleCdf.resize(triangles.size());
+	for (int i = 0; i < (int)triangles.size(); i++) {
+		const Triangle &t = triangles[i];
+		glm::vec3 v0 = verts[t.vertInd[0]];
+		area += 0.5f * glm::length(glm::cross(verts[t.vertInd[1]] - v0, verts[t.vertInd[2]] - v0));
+		triangleCdf[i] = area;
+	}
+
+	// area and bounds of each cluster
+	for (LightCluster &cluster : clusters) {
+		int last = cluster.firstTriangle + cluster.triangleCount - 1;
+		cluster.area = triangleCdf[last] - (cluster.firstTriangle > 0 ? triangleCdf[cluster.firstTriangle - 1] : 0);
+		for (int i = cluster.firstTriangle; i <= last; i++) {
+			for (int k = 0; k < 3; k++) {
+				cluster.bounds.expand(verts[triangles[i].vertInd[k]]);
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Picks a point with probability proportional to area over all triangles
+glm::vec3 AreaLight::samplePoint(glm::vec2 u, float &pdf) const {
+	pdf = 1.0f / area;
+	return sampleTriangles(u, 0, (int)triangles.size());
+}
+
+//--------------------------------------------------------------
+// Picks a point by area over all triangles and returns its triangle's normal
+glm::vec3 AreaLight::samplePoint(glm::vec2 u, float &pdf, glm::vec3 &normal) const {
+	pdf = 1.0f / area;
+	return sampleTriangles(u, 0, (int)triangles.size(), &normal);
+}
+
+//--------------------------------------------------------------
+// Tests every triangle with the watertight test of the meshes
+bool AreaLight::intersect(const Ray &ray, float tMax, float &t, glm::vec3 &normal) const {
+	WatertightRay wray(ray);
+	bool found = false;
+	for (const Triangle &tri : triangles) {
+		const glm::vec3 &v0 = verts[tri.vertInd[0]];
+		const glm::vec3 &v1 = verts[tri.vertInd[1]];
+		const glm::vec3 &v2 = verts[tri.vertInd[2]];
+		if (wray.intersect(v0, v1, v2, tMax, tMax)) {
+			t = tMax;
+			normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+			found = true;
+		}
+	}
+	return found;
+}
+
+//--------------------------------------------------------------
+// Tests the cluster's triangles with the watertight test of the meshes
+bool AreaLight::intersectCluster(const Ray &ray, int cluster, float &tMax, glm::vec3 &normal) const {
+	WatertightRay wray(ray);
+	const LightCluster &c = clusters[cluster];
+	bool found = false;
+	for (int i = c.firstTriangle; i < c.firstTriangle + c.triangleCount; i++) {
+		const Triangle &tri = triangles[i];
+		const glm::vec3 &v0 = verts[tri.vertInd[0]];
+		const glm::vec3 &v1 = verts[tri.vertInd[1]];
+		const glm::vec3 &v2 = verts[tri.vertInd[2]];
+		if (wray.intersect(v0, v1, v2, tMax, tMax)) {
+			normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+			found = true;
+		}
+	}
+	return found;
+}
+
+//--------------------------------------------------------------
+// Picks a point by area among the triangles of one cluster
+glm::vec3 AreaLight::sampleCluster(glm::vec2 u, int cluster, glm::vec3 *normal) const {
+	return sampleTriangles(u, clusters[cluster].firstTriangle, clusters[cluster].triangleCount, normal);
+}
+
+//--------------------------------------------------------------
+// Weighs every cluster by area / distance^2. The distance is measured to
+// the cluster's bounds and never taken below half the cluster's size, so a
+// point next to a cluster does not send it every sample.
+void AreaLight::clusterImportance(const glm::vec3 &point, vector<float> &cdf) const {
+	cdf.resize(clusters.size());
+	float sum = 0;
+	for (int c = 0; c < (int)clusters.size(); c++) {
+		const LightCluster &cluster = clusters[c];
+		glm::vec3 nearest = glm::min(glm::max(point, cluster.bounds.min), cluster.bounds.max);
+		glm::vec3 extent = cluster.bounds.max - cluster.bounds.min;
+		float distanceSquared = std::max(glm::dot(nearest - point, nearest - point), 0.25f * glm::dot(extent, extent));
+		sum += cluster.area / std::max(distanceSquared, 1e-8f);
+		cdf[c] = sum;
+	}
+}
+
+//--------------------------------------------------------------
+// Takes the nearest point of every cluster's bounds
+float AreaLight::nearestDistanceSquared(const glm::vec3 &point) const {
+	float nearestSquared = std::numeric_limits<float>::infinity();
+	for (const LightCluster &cluster : clusters) {
+		glm::vec3 nearest = glm::min(glm::max(point, cluster.bounds.min), cluster.bounds.max);
+		nearestSquared = std::min(nearestSquared, glm::dot(nearest - point, nearest - point));
+	}
+	return nearestSquared;
+}
+
+//--------------------------------------------------------------
+// Picks a cluster from the importance cdf with u.x, reuses the remainder of
+// u.x inside the cluster so the samples stay stratified, and picks a point
+// in the cluster by area
+glm::vec3 AreaLight::samplePoint(glm::vec2 u, const vector<float> &cdf, float &pdf) const {
+	float total = cdf.empty() ? 0 : cdf.back();
+	if (total <= 0) return samplePoint(u, pdf);
+
+	float target = u.x * total;
+	int c = std::upper_bound(cdf.begin(), cdf.end(), target) - cdf.begin();
+	c = std::min(c, (int)cdf.size() - 1);
+	float start = c > 0 ? cdf[c - 1] : 0;
+	float weight = cdf[c] - start;
+	u.x = glm::clamp((target - start) / weight, 0.0f, 0.99999994f);
+
+	const LightCluster &cluster = clusters[c];
+	pdf = (weight / total) / cluster.area;
+	return sampleTriangles(u, cluster.firstTriangle, cluster.triangleCount);
+}
+
+//--------------------------------------------------------------
+// Chooses a triangle in [first, first + count) by area with u.x and a
+// uniform point inside it with the remainder of u.x and u.y
+glm::vec3 AreaLight::sampleTriangles(glm::vec2 u, int first, int count, glm::vec3 *normal) const {
+	// pick the triangle whose slice of the running area contains the target
+	float low = first > 0 ? triangleCdf[first - 1] : 0;
+	float high = triangleCdf[first + count - 1];
+	float target = low + u.x * (high - low);
+	int t = std::upper_bound(triangleCdf.begin() + first, triangleCdf.begin() + first + count, target) - triangleCdf.begin();
+	t = std::min(t, first + count - 1);
+	float start = t > 0 ? triangleCdf[t - 1] : 0;
+	float triangleArea = triangleCdf[t] - start;
+	float ux = triangleArea > 0 ? glm::clamp((target - start) / triangleArea, 0.0f, 0.99999994f) : 0.5f;
+
+	// uniform barycentric coordinates (square root warp)
+	float su = sqrt(ux);
+	float b0 = 1 - su;
+	float b1 = u.y * su;
+	const Triangle &tri = triangles[t];
+	if (normal != NULL) {
+		*normal = glm::normalize(glm::cross(verts[tri.vertInd[1]] - verts[tri.vertInd[0]], verts[tri.vertInd[2]] - verts[tri.vertInd[0]]));
+	}
+	return b0 * verts[tri.vertInd[0]] + b1 * verts[tri.vertInd[1]] + (1 - b0 - b1) * verts[tri.vertInd[2]];
+}
@@ -0,0 +1,94 @@
+// This file provides the class definition of Arena, the block allocated
+// storage that owns the objects and lights of a scene
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//  Stores objects of one type in blocks of BLOCK_SIZE contiguous objects
+//  Objects never move once created, so pointers to them stay valid until
+//  they are removed; consecutive objects share cache lines, and a scene of
+//  millions of objects needs one allocation per block instead of one per
+//  object. Every object is destroyed with the Arena.
+//
+template<class T, size_t BLOCK_SIZE = 256>
+class Arena {
+public:
+	// Arena constructor (empty)
+	Arena() {}
+	// destroys every object
+	~Arena() { clear(); }
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	// constructs an object from args at the end of the arena and returns it
+	template<class... Args>
+	T *create(Args &&... args) {
+		if (count == blocks.size() * BLOCK_SIZE) blocks.emplace_back(new Slot[BLOCK_SIZE]);
+		T *object = new (slot(count)) T(std::forward<Args>(args)...);
+		count++;
+		return object;
+	}
+	// destroys the last object (e.g. a mesh whose file failed to load)
+	void removeLast() {
+		count--;
+		slot(count)->~T();
+	}
+	// destroys every object, keeping the blocks for the next scene
+	void clear() {
+		while (count > 0) removeLast();
+	}
+	// exchanges the objects of two arenas; the objects stay where they are,
+	// so pointers to them stay valid
+	void swap(Arena &other) {
+		blocks.swap(other.blocks);
+		std::swap(count, other.count);
+	}
+	// returns the number of objects
+	size_t size() const { return count; }
+	// returns true if the arena holds no object
+	bool empty() const { return count == 0; }
+	// returns the i-th object created
+	T &operator[](size_t i) { return *slot(i); }
+	const T &operator[](size_t i) const { return *slot(i); }
+
+	//  Visits the objects in the order they were created
+	//
+	template<class Value, class Owner>
+	class Iterator {
+	public:
+		Iterator(Owner *arena, size_t index) { this->arena = arena; this->index = index; }
+		Value &operator*() const { return (*arena)[index]; }
+		Value *operator->() const { return &(*arena)[index]; }
+		Iterator &operator++() { index++; return *this; }
+		bool operator!=(const Iterator &other) const { return index != other.index; }
+		bool operator==(const Iterator &other) const { return index == other.index; }
+
+	private:
+		Owner *arena;	// arena being visited
+		size_t index;	// index of the current object
+	};
+	typedef Iterator<T, Arena> iterator;
+	typedef Iterator<const T, const Arena> const_iterator;
+
+	// range of every object, for range based for loops
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, count); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, count); }
+
+private:
+	// uninitialized memory for one object
+	typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+	// returns the memory of the i-th object
+	T *slot(size_t i) const { return reinterpret_cast<T *>(&blocks[i / BLOCK_SIZE][i % BLOCK_SIZE]); }
+
+	std::vector<std::unique_ptr<Slot[]>> blocks;	// blocks of BLOCK_SIZE objects
+	size_t count = 0;								// objects created and not removed
+};
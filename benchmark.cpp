@@ -0,0 +1,276 @@
+// This file provides the render benchmarks of the Ray Tracer App
+// - author: Jared Bechthold
+
+#include "rayTracer.h"
+#include "perfCounters.h"
+#include <chrono>
+#include <cstdio>
+
+//--------------------------------------------------------------
+// Returns true if any object of the scene is hit by ray before it reaches
+// lightPosition, testing every object like the original shadowCheck()
+static bool originalShadowCheck(const vector<SceneObject *> &scene, const Ray &ray, const glm::vec3 &lightPosition) {
+	glm::vec3 intersection, normal;
+	for (int k = 0; k < scene.size(); k++) {
+		if (scene[k]->intersect(ray, intersection, normal) && glm::distance(ray.p, intersection) < glm::distance(ray.p, lightPosition))
+			return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+// Returns the diffuse and phong shading of one light at point as the original
+// phong() and phongAreaLight() computed it: 8-bit colors, a white highlight
+// and a brute force shadow ray (both treated every area light vertex as a light)
+static ofColor originalPhongLight(const vector<SceneObject *> &scene, const glm::vec3 &cameraPosition, const glm::vec3 &point,
+	const glm::vec3 &norm, const ofColor &diffuse, const glm::vec3 &lightPosition, float intensity, float power) {
+	glm::vec3 directionToCam = glm::normalize(cameraPosition - point);
+	glm::vec3 directionToLight = glm::normalize(lightPosition - point);
+	if (originalShadowCheck(scene, Ray(point + 0.0001f * norm, directionToLight), lightPosition)) return ofColor(0);
+	float illumination = intensity / pow(glm::distance(lightPosition, point), 2);
+	ofColor result = diffuse * (illumination * glm::max(0.0f, glm::dot(norm, directionToLight)));
+	float dotProdNormBis = glm::dot(norm, glm::normalize(directionToCam + directionToLight));
+	result += ofColor::white * (illumination * pow(glm::max(0.0f, dotProdNormBis), power));
+	return result;
+}
+
+//--------------------------------------------------------------
+// Renders the current scene single threaded three times and prints the time
+// of each pass:
+//  - the original renderer: the rayTrace() loop this app started with, with
+//    its 8-bit shading and shadow rays that test every object, and every area
+//    light vertex shaded as a point light (no mesh lights);
+//  - brute force: the same loop structure (every SceneObject tested by its
+//    point/normal intersect(), the pixel shaded again after every hit) with
+//    today's shading and BVH-traced shadow rays, which isolates the primary
+//    ray query and the repeated shading;
+//  - the BVH closest-hit query and shading of renderTile(), which also traces
+//    the reflections and refractions of materials the other passes skip.
+void RayTracer::benchmarkClosestHit() {
+	typedef std::chrono::steady_clock Clock;
+	sceneBVH.build(scene);
+	buildLightTree();
+	renderCam.prepare(imageWidth, imageHeight);
+
+	// original renderer pass: every object per pixel, 8-bit shading after every hit
+	double checksum = 0;			// keeps the reference colors from being optimized away
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < imageWidth; i++) {
+		for (int j = 0; j < imageHeight; j++) {
+			Ray ray = renderCam.getRay((i + 0.5) / imageWidth, (j + 0.5) / imageHeight);
+			glm::vec3 intersectPt, intersectNormal;
+			bool hit = false;
+			float shortestDistance = std::numeric_limits<float>::infinity();
+			SceneObject *closestObject = NULL;
+			ofColor color = background;
+			for (int k = 0; k < scene.size(); k++) {
+				if (scene[k]->intersect(ray, intersectPt, intersectNormal)) {
+					float currentDistance = sqrt(pow(ray.p.x - intersectPt.x, 2) + pow(ray.p.y - intersectPt.y, 2)
+						+ pow(ray.p.z - intersectPt.z, 2));
+					if (currentDistance < shortestDistance) {
+						shortestDistance = currentDistance;
+						closestObject = scene[k];
+					}
+					hit = true;
+				}
+				if (hit) {
+					closestObject->intersect(ray, intersectPt, intersectNormal);
+					ofColor objColor = closestObject->getColor(intersectPt);
+					glm::vec3 norm = glm::normalize(intersectNormal);
+					color = objColor * 0.15f;	// ambient
+					for (int l = 0; l < lights.size(); l++) {
+						color += originalPhongLight(scene, renderCam.position, intersectPt, norm, objColor, lights[l].position, lights[l].intensity, phongPower);
+					}
+					for (int v = 0; v < areaLight.verts.size(); v++) {
+						color += originalPhongLight(scene, renderCam.position, intersectPt, norm, objColor, areaLight.verts[v], areaLight.intensity, phongPower);
+					}
+				}
+			}
+			checksum += color.r + color.g + color.b;
+		}
+	}
+	double originalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// brute force pass: every object per pixel, shading after every hit
+	start = Clock::now();
+	for (int i = 0; i < imageWidth; i++) {
+		for (int j = 0; j < imageHeight; j++) {
+			Ray ray = renderCam.getRay((i + 0.5) / imageWidth, (j + 0.5) / imageHeight);
+			glm::vec3 intersectPt, intersectNormal;
+			bool hit = false;
+			float shortestDistance = std::numeric_limits<float>::infinity();
+			SceneObject *closestObject = NULL;
+			glm::vec3 color = linearColor(background);
+			for (int k = 0; k < scene.size(); k++) {
+				if (scene[k]->intersect(ray, intersectPt, intersectNormal)) {
+					float currentDistance = sqrt(pow(ray.p.x - intersectPt.x, 2) + pow(ray.p.y - intersectPt.y, 2)
+						+ pow(ray.p.z - intersectPt.z, 2));
+					if (currentDistance < shortestDistance) {
+						shortestDistance = currentDistance;
+						closestObject = scene[k];
+					}
+					hit = true;
+				}
+				if (hit) {
+					closestObject->intersect(ray, intersectPt, intersectNormal);
+					glm::vec3 objColor = linearColor(closestObject->getColor(intersectPt));
+					color = phong(ray, intersectPt, intersectNormal, objColor, glm::vec3(1), phongPower);
+					color += phongAreaLight(ray, intersectPt, intersectNormal, objColor, glm::vec3(1), phongPower);
+				}
+			}
+			checksum += color.x + color.y + color.z;
+		}
+	}
+	double referenceSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// BVH pass: one closest-hit query and one shading call per pixel
+	start = Clock::now();
+	renderTile(Tile(0, 0, imageWidth, imageHeight), background);
+	double closestHitSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// report the results
+	cout << "closest-hit benchmark (" << imageWidth << "x" << imageHeight << ", " << scene.size() << " objects, 1 thread, "
+		<< sceneBVH.kernels->name << " kernels, checksum " << checksum << ")" << endl;
+	cout << "  original renderer:            " << originalSeconds << " s" << endl;
+	cout << "  brute force, today's shading: " << referenceSeconds << " s" << endl;
+	cout << "  BVH closest hit:              " << closestHitSeconds << " s" << endl;
+	cout << "  speedup over brute force:     " << referenceSeconds / closestHitSeconds << "x" << endl;
+	cout << "  speedup over the original:    " << originalSeconds / closestHitSeconds << "x" << endl;
+}
+
+//--------------------------------------------------------------
+// Runs each stage of the render over the whole image before the next one
+// starts, so every stage can be timed on its own. Shadow rays are traced
+// during shading; shadowCheck() times them and their time is taken out of
+// the shading time.
+RenderStageTimes RayTracer::measureStages(const string &imagePath) {
+	typedef std::chrono::steady_clock Clock;
+	RenderStageTimes times;
+	int pixelCount = imageWidth * imageHeight;
+
+	// acceleration structure
+	Clock::time_point start = Clock::now();
+	sceneBVH.build(scene);
+	buildLightTree();
+	times.bvhBuild = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// primary rays, generated like the rays of one image sized tile
+	vector<Ray> rays(pixelCount);
+	vector<glm::vec3> offsets;
+	start = Clock::now();
+	renderCam.prepare(imageWidth, imageHeight);
+	renderCam.tileOffsets(Tile(0, 0, imageWidth, imageHeight), 1, offsets);
+	for (int k = 0; k < pixelCount; k++) {
+		rays[k] = renderCam.getRay(offsets[k], glm::vec2(0.5f));
+	}
+	times.rayGeneration = std::chrono::duration<double>(Clock::now() - start).count();
+	times.primaryRays = pixelCount;
+
+	// closest hits
+	vector<HitRecord> hits(pixelCount);
+	start = Clock::now();
+	for (int k = 0; k < pixelCount; k++) {
+		sceneBVH.intersect(rays[k], hits[k]);
+	}
+	times.intersection = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// shading, with the shadow rays timed separately
+	stageTimes = &times;
+	start = Clock::now();
+	for (int i = 0; i < imageWidth; i++) {
+		for (int j = 0; j < imageHeight; j++) {
+			const HitRecord &hit = hits[i * imageHeight + j];
+			if (hit.hit()) {
+				RayDifferential differential = renderCam.getRayDifferential(rays[i * imageHeight + j], offsets[i * imageHeight + j], 1);
+				framebuffer.setPixel(i, imageHeight - 1 - j, shade(rays[i * imageHeight + j], hit, &differential));
+			}
+			else {
+				framebuffer.setPixel(i, imageHeight - 1 - j, linearColor(background));
+			}
+		}
+	}
+	times.shading = std::chrono::duration<double>(Clock::now() - start).count() - times.shadowRays;
+	stageTimes = NULL;
+
+	// image write
+	start = Clock::now();
+	saveImage(imagePath);
+	times.imageWrite = std::chrono::duration<double>(Clock::now() - start).count();
+	return times;
+}
+
+//--------------------------------------------------------------
+// Times full renders on the tile renderer, the same way rayTrace() renders
+double RayTracer::timeRender(int repeats) {
+	typedef std::chrono::steady_clock Clock;
+	cancelRender();
+	double best = std::numeric_limits<double>::infinity();
+	for (int r = 0; r < std::max(1, repeats); r++) {
+		Clock::time_point start = Clock::now();
+		renderPasses(1);
+		best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+	}
+	return best;
+}
+
+//--------------------------------------------------------------
+// Returns the change from reference to value in percent as text
+static string percentChange(double value, double reference) {
+	char text[32];
+	snprintf(text, sizeof(text), "%+.1f%%", 100.0 * (value - reference) / reference);
+	return text;
+}
+
+//--------------------------------------------------------------
+// Returns a count and its change against a reference count as text
+static string countChange(long long count, long long reference) {
+	if (count < 0) return "n/a";
+	string text = std::to_string(count);
+	if (reference > 0) text += " (" + percentChange((double)count, (double)reference) + ")";
+	return text;
+}
+
+//--------------------------------------------------------------
+// Renders every tile of the image on the calling thread in the tile order,
+// so the hardware counters of this thread see the whole render. Each order
+// renders once to warm the caches and once measured; the acceleration
+// structures are built once and shared by all orders.
+void RayTracer::benchmarkPixelOrder() {
+	typedef std::chrono::steady_clock Clock;
+	static const PixelOrder ORDERS[] = { PIXEL_ORDER_COLUMNS, PIXEL_ORDER_MORTON, PIXEL_ORDER_HILBERT };
+	static const char *NAMES[] = { "columns", "morton", "hilbert" };
+	PixelOrder savedOrder = pixelOrder;
+	prepareRender();
+	PerfCounters counters;
+	string error;
+	if (!counters.open(error)) cout << error << ", reporting times only" << endl;
+
+	cout << "pixel order benchmark (" << imageWidth << "x" << imageHeight << ", " << scene.size() << " objects, "
+		<< tileRenderer.tileSize << " pixel tiles, 1 thread)" << endl;
+	PerfCounts reference;
+	double referenceSeconds = 0;
+	for (int o = 0; o < 3; o++) {
+		pixelOrder = ORDERS[o];
+		tileRenderer.setOrder(pixelOrder);
+		vector<Tile> tiles = tileRenderer.makeTiles(imageWidth, imageHeight);
+		for (const Tile &tile : tiles) renderTile(tile, background);
+		Clock::time_point start = Clock::now();
+		counters.start();
+		for (const Tile &tile : tiles) renderTile(tile, background);
+		PerfCounts counts = counters.stop();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (o == 0) {
+			reference = counts;
+			referenceSeconds = seconds;
+		}
+
+		cout << "  " << NAMES[o] << ": " << seconds << " s";
+		if (o > 0) cout << " (" << percentChange(seconds, referenceSeconds) << ")";
+		cout << ", L1 misses " << countChange(counts.l1Misses, o > 0 ? reference.l1Misses : 0)
+			<< ", cache misses " << countChange(counts.cacheMisses, o > 0 ? reference.cacheMisses : 0)
+			<< ", TLB misses " << countChange(counts.tlbMisses, o > 0 ? reference.tlbMisses : 0)
+			<< ", instructions " << countChange(counts.instructions, o > 0 ? reference.instructions : 0) << endl;
+	}
+	pixelOrder = savedOrder;
+	tileRenderer.setOrder(pixelOrder);
+}
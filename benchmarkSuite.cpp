@@ -0,0 +1,180 @@
+// This file provides the implementation of the render benchmark suite
+// - author: Jared Bechthold
+
+#include "benchmarkSuite.h"
+#include "sampling.h"
+#include <memory>
+
+//--------------------------------------------------------------
+// Returns the absolute path of a file in the assets directory
+static string assetPath(const BenchmarkOptions &options, const string &file) {
+	return ofFilePath::getAbsolutePath(options.assetsPath + "/" + file, false);
+}
+
+//--------------------------------------------------------------
+// Builds the default scene of the app with the given floor texture and the
+// GUI's default shading settings
+static bool buildDefaultScene(RayTracer &rayTracer, const BenchmarkOptions &options, const string &texture, string &error) {
+	string path = assetPath(options, "texture_images/" + texture);
+	if (!ofFile::doesFileExist(path, false)) {
+		error = "missing " + path;
+		return false;
+	}
+	rayTracer.imageWidth = options.width;
+	rayTracer.imageHeight = options.height;
+	rayTracer.setupDefaultScene(path);
+	rayTracer.setLightIntensities(10, 500);
+	rayTracer.phongPower = 20;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Builds the default scene lit by one of the area lights
+static bool buildAreaLightScene(RayTracer &rayTracer, const BenchmarkOptions &options, const string &light, string &error) {
+	if (!buildDefaultScene(rayTracer, options, "textureImg.jpg", error)) return false;
+	string path = assetPath(options, "area_lights/" + light);
+	if (!rayTracer.loadAreaLight(path)) {
+		error = "missing " + path;
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns a reproducible number in [0, 1) for index i
+static float benchmarkRandom(uint32_t i) {
+	return hashUint(i) / 4294967296.0f;
+}
+
+//--------------------------------------------------------------
+// Adds count small spheres scattered behind the default scene
+static void addSpheres(RayTracer &rayTracer, int count) {
+	for (int i = 0; i < count; i++) {
+		glm::vec3 position(-10 + 20 * benchmarkRandom(5 * i), -2 + 8 * benchmarkRandom(5 * i + 1), -30 + 28 * benchmarkRandom(5 * i + 2));
+		ofColor color = ofColor::fromHsb(255 * benchmarkRandom(5 * i + 3), 200, 255);
+		rayTracer.addSphere(position, 0.1 + 0.15 * benchmarkRandom(5 * i + 4), color);
+	}
+}
+
+//--------------------------------------------------------------
+// Adds a rolling height field of 2 * resolution^2 triangles above the floor
+static void addTerrain(RayTracer &rayTracer, int resolution) {
+	Mesh *mesh = rayTracer.addMesh(glm::vec3(0, 0, 0), ofColor::sandyBrown);
+	for (int i = 0; i <= resolution; i++) {
+		for (int j = 0; j <= resolution; j++) {
+			float x = -10 + 20.0f * i / resolution;
+			float z = -20 + 18.0f * j / resolution;
+			mesh->verts.push_back(glm::vec3(x, -1.5 + 0.5 * sin(x * 1.3) * cos(z * 0.9), z));
+		}
+	}
+	for (int i = 0; i < resolution; i++) {
+		for (int j = 0; j < resolution; j++) {
+			int a = i * (resolution + 1) + j;
+			int b = a + resolution + 1;
+			mesh->triangles.push_back(Triangle(a, b, a + 1));
+			mesh->triangles.push_back(Triangle(b, b + 1, a + 1));
+		}
+	}
+	mesh->build();
+}
+
+//--------------------------------------------------------------
+// Lists the reference scenes of the suite
+vector<BenchmarkScene> benchmarkScenes() {
+	vector<BenchmarkScene> scenes;
+	scenes.push_back({ "default", [](RayTracer &rayTracer, const BenchmarkOptions &options, string &error) {
+		return buildDefaultScene(rayTracer, options, "textureImg.jpg", error);
+	} });
+	for (string light : { "planearealight.obj", "curvearealight.obj", "discarealight.obj" }) {
+		scenes.push_back({ "area_" + ofFilePath::removeExt(light), [light](RayTracer &rayTracer, const BenchmarkOptions &options, string &error) {
+			return buildAreaLightScene(rayTracer, options, light, error);
+		} });
+	}
+	for (string texture : { "textureImg2.jpg", "textureImg3.jpg" }) {
+		scenes.push_back({ "floor_" + ofFilePath::removeExt(texture), [texture](RayTracer &rayTracer, const BenchmarkOptions &options, string &error) {
+			return buildDefaultScene(rayTracer, options, texture, error);
+		} });
+	}
+	scenes.push_back({ "spheres_10k", [](RayTracer &rayTracer, const BenchmarkOptions &options, string &error) {
+		if (!buildDefaultScene(rayTracer, options, "textureImg.jpg", error)) return false;
+		addSpheres(rayTracer, 10000);
+		return true;
+	} });
+	scenes.push_back({ "mesh_200k", [](RayTracer &rayTracer, const BenchmarkOptions &options, string &error) {
+		if (!buildDefaultScene(rayTracer, options, "textureImg.jpg", error)) return false;
+		addTerrain(rayTracer, 316);
+		return true;
+	} });
+	return scenes;
+}
+
+//--------------------------------------------------------------
+// Returns the number of triangles in the meshes and the area light of a scene
+static long triangleCount(const RayTracer &rayTracer) {
+	long count = rayTracer.areaLight.triangles.size();
+	for (const Mesh &mesh : rayTracer.meshes) {
+		count += mesh.triangles.size();
+	}
+	return count;
+}
+
+//--------------------------------------------------------------
+// Renders every scene that matches the filter and writes the JSON report
+int runBenchmarkSuite(const BenchmarkOptions &options) {
+	std::ostringstream json;
+	json << "{\n  \"version\": 1,\n  \"width\": " << options.width << ",\n  \"height\": " << options.height
+		<< ",\n  \"threads\": " << (options.threads > 0 ? options.threads : WorkStealingPool::hardwareThreads())
+		<< ",\n  \"kernels\": \"" << simdKernels().name << "\",\n  \"repeats\": " << options.repeats
+		<< ",\n  \"scenes\": [";
+	ofDirectory::createDirectory(options.imageDirectory, false, true);
+
+	bool first = true;
+	for (const BenchmarkScene &benchmark : benchmarkScenes()) {
+		if (!options.filter.empty() && benchmark.name.find(options.filter) == string::npos) continue;
+		json << (first ? "\n" : ",\n") << "    {\"name\": \"" << benchmark.name << "\"";
+		first = false;
+
+		// build the scene (each scene gets its own RayTracer and thread pool)
+		std::unique_ptr<RayTracer> rayTracer(new RayTracer());
+		rayTracer->renderThreads = options.threads;
+		string error;
+		if (!benchmark.build(*rayTracer, options, error)) {
+			cout << benchmark.name << ": skipped (" << error << ")" << endl;
+			json << ", \"skipped\": true}";
+			continue;
+		}
+
+		// staged single threaded render, then the timed parallel renders
+		RenderStageTimes stages = rayTracer->measureStages(options.imageDirectory + "/" + benchmark.name + ".png");
+		double seconds = rayTracer->timeRender(options.repeats);
+		long rays = stages.primaryRays + stages.shadowRayCount;
+		double pixels = (double)options.width * options.height;
+		double raysPerSecond = seconds > 0 ? rays / seconds : 0;
+
+		cout << benchmark.name << ": " << seconds << " s, " << raysPerSecond / 1e6 << " Mrays/s, "
+			<< seconds * 1e9 / pixels << " ns/pixel" << endl;
+		json << ", \"objects\": " << rayTracer->scene.size() << ", \"triangles\": " << triangleCount(*rayTracer)
+			<< ", \"primary_rays\": " << stages.primaryRays << ", \"shadow_rays\": " << stages.shadowRayCount
+			<< ", \"shadow_cache_hits\": " << stages.shadowCacheHits
+			<< ",\n     \"render_seconds\": " << seconds << ", \"rays_per_second\": " << raysPerSecond
+			<< ", \"ns_per_pixel\": " << seconds * 1e9 / pixels
+			<< ",\n     \"stages\": {\"bvh_build\": " << stages.bvhBuild << ", \"ray_generation\": " << stages.rayGeneration
+			<< ", \"intersection\": " << stages.intersection << ", \"shading\": " << stages.shading
+			<< ", \"shadow_rays\": " << stages.shadowRays << ", \"image_write\": " << stages.imageWrite << "}}";
+	}
+	json << "\n  ]\n}\n";
+
+	// write the report
+	if (options.jsonPath.empty()) {
+		cout << json.str();
+		return 0;
+	}
+	ofstream file(options.jsonPath);
+	file << json.str();
+	if (!file) {
+		cerr << "could not write " << options.jsonPath << endl;
+		return 1;
+	}
+	cout << "wrote " << options.jsonPath << endl;
+	return 0;
+}
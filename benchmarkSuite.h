@@ -0,0 +1,45 @@
+// This file provides the render benchmark suite, which renders a fixed set
+// of reference scenes and reports their timings as JSON
+// - author: Jared Bechthold
+//
+// Every scene is rendered twice:
+//   - once single threaded one stage at a time (RayTracer::measureStages),
+//     which gives the breakdown into BVH build, ray generation, intersection,
+//     shading, shadow rays and image write, and the ray counts
+//   - then repeatedly on the tile renderer with all render threads
+//     (RayTracer::timeRender); the fastest run gives rays per second and
+//     time per pixel
+// Scene assets (texture_images/ and area_lights/) are looked up under the
+// assets directory; scenes whose assets are missing are reported as skipped.
+
+#pragma once
+
+#include "rayTracer.h"
+#include <functional>
+
+//  Settings of a benchmark run
+//
+struct BenchmarkOptions {
+	int width = 600;						// width of the rendered images
+	int height = 400;						// height of the rendered images
+	int threads = 0;						// render threads for the timed renders (0 = all cores)
+	int repeats = 3;						// timed renders per scene (the fastest is reported)
+	string assetsPath = ".";				// directory holding texture_images/ and area_lights/
+	string imageDirectory = "benchmark";	// directory the images of the staged renders are written to
+	string jsonPath = "benchmark.json";		// JSON report (empty prints it to stdout only)
+	string filter;							// only scenes whose name contains this text
+};
+
+//  Reference scene of the suite
+//
+struct BenchmarkScene {
+	string name;	// name used in the report
+	// builds the scene into a RayTracer; returns false and sets error if an asset is missing
+	std::function<bool(RayTracer &rayTracer, const BenchmarkOptions &options, string &error)> build;
+};
+
+// returns the reference scenes: the default scene, the default scene with each
+// area light, each floor texture, and large synthetic sphere and mesh scenes
+vector<BenchmarkScene> benchmarkScenes();
+// renders every scene and writes the report; returns the process exit code
+int runBenchmarkSuite(const BenchmarkOptions &options);
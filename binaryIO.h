@@ -0,0 +1,91 @@
+// This file provides the class definitions of BinaryWriter and BinaryReader,
+// used to flatten data into bytes for the scene cache and the distributed
+// render protocol
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "ofMain.h"
+#include <cstdint>
+#include <cstring>
+
+//  Appends plain values and arrays to a byte buffer
+//
+class BinaryWriter {
+public:
+	// appends the bytes of a trivially copyable value
+	template <class T>
+	void write(const T &value) { append(&value, sizeof(T)); }
+	// appends a count followed by the elements of an array
+	template <class T>
+	void writeArray(const vector<T> &values) {
+		write((uint64_t)values.size());
+		if (!values.empty()) append(values.data(), values.size() * sizeof(T));
+	}
+	// appends a length-prefixed string
+	void writeString(const string &value) {
+		write((uint32_t)value.size());
+		append(value.data(), value.size());
+	}
+	// appends a color as 4 bytes
+	void writeColor(const ofColor &color) {
+		uint8_t rgba[4] = { color.r, color.g, color.b, color.a };
+		append(rgba, 4);
+	}
+
+	vector<char> buffer;	// bytes written so far
+
+private:
+	// appends raw bytes
+	void append(const void *data, size_t size) {
+		const char *bytes = (const char *)data;
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+};
+
+//  Reads plain values and arrays from a memory range with bounds checks
+//
+class BinaryReader {
+public:
+	// BinaryReader constructor over [data, data + size)
+	BinaryReader(const char *data, size_t size) { current = data; end = data + size; }
+
+	// reads a trivially copyable value; returns false past the end of the data
+	template <class T>
+	bool read(T &value) { return take(&value, sizeof(T)); }
+	// reads an array written by BinaryWriter::writeArray
+	template <class T>
+	bool readArray(vector<T> &values) {
+		uint64_t count;
+		if (!read(count) || count > (uint64_t)(end - current) / sizeof(T)) return false;
+		values.resize((size_t)count);
+		return count == 0 || take(values.data(), (size_t)count * sizeof(T));
+	}
+	// reads a length-prefixed string
+	bool readString(string &value) {
+		uint32_t length;
+		if (!read(length) || length > (uint64_t)(end - current)) return false;
+		value.assign(current, length);
+		current += length;
+		return true;
+	}
+	// reads a color written by BinaryWriter::writeColor
+	bool readColor(ofColor &color) {
+		uint8_t rgba[4];
+		if (!take(rgba, 4)) return false;
+		color = ofColor(rgba[0], rgba[1], rgba[2], rgba[3]);
+		return true;
+	}
+
+private:
+	// copies raw bytes out of the range
+	bool take(void *data, size_t size) {
+		if (size > (size_t)(end - current)) return false;
+		memcpy(data, current, size);
+		current += size;
+		return true;
+	}
+
+	const char *current;	// next byte to read
+	const char *end;		// end of the data
+};
@@ -0,0 +1,112 @@
+// This file provides the implementation of the BVH builder
+// - author: Jared Bechthold
+
+#include "bvh.h"
+#include <algorithm>
+
+// number of centroid bins evaluated per axis by the SAH
+static const int SAH_BINS = 12;
+// deepest level of the hierarchy (keeps traversal within its fixed stack)
+static const int MAX_DEPTH = 60;
+
+// Builds the hierarchy over every primitive with non-empty bounds
+void BVH::build(const std::vector<AABB> &primBounds, int maxLeafSize) {
+	clear();
+
+	// collect the primitives that can be hit and their centroids
+	std::vector<glm::vec3> centroids(primBounds.size());
+	for (int i = 0; i < (int)primBounds.size(); i++) {
+		if (primBounds[i].isEmpty()) continue;
+		primIndices.push_back(i);
+		centroids[i] = primBounds[i].centroid();
+	}
+	if (primIndices.empty()) return;
+
+	// a binary tree over n primitives never has more than 2n - 1 nodes
+	nodes.reserve(2 * primIndices.size());
+	buildRecursive(primBounds, centroids, 0, (int)primIndices.size(), std::max(maxLeafSize, 1), 0);
+}
+
+// Splits primIndices[first, first + count) with the binned surface area
+// heuristic and appends the resulting nodes in depth-first order
+int BVH::buildRecursive(const std::vector<AABB> &primBounds, const std::vector<glm::vec3> &centroids, int first, int count, int maxLeafSize, int depth) {
+	// bounds of the primitives and of their centroids
+	AABB bounds, centroidBounds;
+	for (int i = first; i < first + count; i++) {
+		bounds.expand(primBounds[primIndices[i]]);
+		centroidBounds.expand(centroids[primIndices[i]]);
+	}
+
+	int nodeIndex = (int)nodes.size();
+	nodes.push_back(BVHNode{ bounds.min, first, bounds.max, count });
+	if (count <= maxLeafSize || depth >= MAX_DEPTH) return nodeIndex;
+
+	// find the cheapest split over all axes and bin boundaries
+	float leafCost = (float)count;
+	float bestCost = std::numeric_limits<float>::infinity();
+	int bestAxis = -1;
+	int bestBin = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0) continue;
+		float scale = SAH_BINS / extent;
+
+		// sort primitives into bins by centroid
+		AABB binBounds[SAH_BINS];
+		int binCounts[SAH_BINS] = { 0 };
+		for (int i = first; i < first + count; i++) {
+			int prim = primIndices[i];
+			int bin = std::min(SAH_BINS - 1, (int)((centroids[prim][axis] - centroidBounds.min[axis]) * scale));
+			binBounds[bin].expand(primBounds[prim]);
+			binCounts[bin]++;
+		}
+
+		// sweep from the right to get the area and count right of every boundary
+		float rightArea[SAH_BINS - 1];
+		int rightCount[SAH_BINS - 1];
+		AABB rightBox;
+		int rightSum = 0;
+		for (int b = SAH_BINS - 1; b > 0; b--) {
+			rightBox.expand(binBounds[b]);
+			rightSum += binCounts[b];
+			rightArea[b - 1] = rightBox.surfaceArea();
+			rightCount[b - 1] = rightSum;
+		}
+
+		// sweep from the left and evaluate the cost of each boundary
+		AABB leftBox;
+		int leftSum = 0;
+		for (int b = 0; b < SAH_BINS - 1; b++) {
+			leftBox.expand(binBounds[b]);
+			leftSum += binCounts[b];
+			if (leftSum == 0 || rightCount[b] == 0) continue;
+			float cost = leftSum * leftBox.surfaceArea() + rightCount[b] * rightArea[b];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	// cost relative to the parent area, with one unit for the extra traversal step
+	float parentArea = bounds.surfaceArea();
+	if (bestAxis < 0 || (parentArea > 0 && 1.0f + bestCost / parentArea >= leafCost)) return nodeIndex;
+
+	// partition the primitives on the chosen boundary
+	float extent = centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis];
+	float scale = SAH_BINS / extent;
+	float splitMin = centroidBounds.min[bestAxis];
+	int *mid = std::partition(primIndices.data() + first, primIndices.data() + first + count, [&](int prim) {
+		return std::min(SAH_BINS - 1, (int)((centroids[prim][bestAxis] - splitMin) * scale)) <= bestBin;
+	});
+	int leftCount = (int)(mid - (primIndices.data() + first));
+	if (leftCount == 0 || leftCount == count) return nodeIndex;
+
+	// left child is built right after this node, the right child after the left subtree
+	nodes[nodeIndex].count = 0;
+	buildRecursive(primBounds, centroids, first, leftCount, maxLeafSize, depth + 1);
+	int right = buildRecursive(primBounds, centroids, first + leftCount, count - leftCount, maxLeafSize, depth + 1);
+	nodes[nodeIndex].offset = right;
+	return nodeIndex;
+}
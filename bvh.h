@@ -0,0 +1,167 @@
+// This file provides the class definitions AABB, BVHNode, and BVH, a
+// bounding volume hierarchy over any list of bounded primitives
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "renderStats.h"
+#include <glm/glm.hpp>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+//  Axis aligned bounding box
+//
+class AABB {
+public:
+	// AABB constructor from its min and max corners
+	AABB(glm::vec3 min, glm::vec3 max) { this->min = min; this->max = max; }
+	// default AABB constructor creates an empty box that grows with expand()
+	AABB() {
+		min = glm::vec3(std::numeric_limits<float>::infinity());
+		max = glm::vec3(-std::numeric_limits<float>::infinity());
+	}
+
+	// returns an unbounded box, used by objects that cannot be bounded (e.g. rotated planes)
+	static AABB infinite() { return AABB(-glm::vec3(std::numeric_limits<float>::infinity()), glm::vec3(std::numeric_limits<float>::infinity())); }
+
+	// grows the box to contain a point or another box
+	void expand(const glm::vec3 &p) { min = glm::min(min, p); max = glm::max(max, p); }
+	void expand(const AABB &box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+
+	// returns true if the box contains nothing
+	bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	// returns true if every side of the box is finite
+	bool isFinite() const {
+		for (int i = 0; i < 3; i++) {
+			if (!std::isfinite(min[i]) || !std::isfinite(max[i])) return false;
+		}
+		return true;
+	}
+	// returns the center of the box
+	glm::vec3 centroid() const { return 0.5f * (min + max); }
+	// returns the surface area of the box (0 for empty boxes)
+	float surfaceArea() const {
+		if (isEmpty()) return 0;
+		glm::vec3 e = max - min;
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	// slab test against a ray given its origin and inverse direction;
+	// returns true if the ray enters the box before tMax and stores the entry distance in tNear
+	bool intersect(const glm::vec3 &origin, const glm::vec3 &invDir, float tMax, float &tNear) const {
+		glm::vec3 t0 = (min - origin) * invDir;
+		glm::vec3 t1 = (max - origin) * invDir;
+		glm::vec3 tSmall = glm::min(t0, t1);
+		glm::vec3 tBig = glm::max(t0, t1);
+		tNear = glm::max(glm::max(tSmall.x, tSmall.y), glm::max(tSmall.z, 0.0f));
+		float tFar = glm::min(glm::min(tBig.x, tBig.y), glm::min(tBig.z, tMax));
+		return tNear <= tFar;
+	}
+
+	glm::vec3 min, max;	// corners of the box
+};
+
+//  Node of a flattened BVH (32 bytes, two nodes per cache line)
+//  Interior nodes store their left child directly after themselves and the
+//  index of the right child in offset. Leaves store the index of their first
+//  primitive in offset and the number of primitives in count.
+//
+struct BVHNode {
+	glm::vec3 boundsMin;	// min corner of the node's bounds
+	int offset;				// right child (interior) or first primitive (leaf)
+	glm::vec3 boundsMax;	// max corner of the node's bounds
+	int count;				// number of primitives (0 for interior nodes)
+
+	// returns true if the node is a leaf
+	bool isLeaf() const { return count > 0; }
+	// returns the bounds of the node
+	AABB bounds() const { return AABB(boundsMin, boundsMax); }
+};
+
+//  Bounding volume hierarchy built with the surface area heuristic
+//  The hierarchy only stores primitive indices, so the same class is
+//  used for scene objects and for mesh triangles.
+//
+class BVH {
+public:
+	// nodes the traversal stack holds, which bounds the depth of a hierarchy
+	static const int STACK_SIZE = 64;
+
+	// builds the hierarchy over primitives with the given bounds
+	// primitives with empty bounds are left out
+	void build(const std::vector<AABB> &primBounds, int maxLeafSize = 4);
+	// clears the hierarchy
+	void clear() { nodes.clear(); primIndices.clear(); }
+	// returns true if nothing was built
+	bool empty() const { return nodes.empty(); }
+	// returns the bounds of the whole hierarchy
+	AABB bounds() const { return nodes.empty() ? AABB() : nodes[0].bounds(); }
+
+	// visits every leaf primitive whose node bounds are hit by the ray before tMax,
+	// nearest child first. visit(primIndex, tMax) tests one primitive and may lower
+	// tMax; it returns true to stop the traversal (used by any-hit queries).
+	template <class Visitor>
+	void traverse(const glm::vec3 &origin, const glm::vec3 &dir, float &tMax, Visitor visit) const {
+		traverseLeaves(origin, dir, tMax, [&](int nodeIndex, float &tFar) {
+			const BVHNode &leaf = nodes[nodeIndex];
+			for (int i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+				if (visit(primIndices[i], tFar)) return true;
+			}
+			return false;
+		});
+	}
+
+	// same traversal as traverse() but hands whole leaves to visitLeaf(nodeIndex, tMax),
+	// for callers that keep their own per-leaf data
+	template <class LeafVisitor>
+	void traverseLeaves(const glm::vec3 &origin, const glm::vec3 &dir, float &tMax, LeafVisitor visitLeaf) const {
+		if (nodes.empty()) return;
+		glm::vec3 invDir = 1.0f / dir;
+		int stack[STACK_SIZE];			// indices of nodes still to visit
+		float stackNear[STACK_SIZE];	// entry distances of the nodes on the stack
+		int stackSize = 0;
+		int current = 0;
+		float tNear;
+		if (!nodes[0].bounds().intersect(origin, invDir, tMax, tNear)) return;
+		while (true) {
+			const BVHNode &node = nodes[current];
+			RT_STAT(bvhNodes);
+			if (node.isLeaf()) {
+				RT_STAT(bvhLeaves);
+				if (visitLeaf(current, tMax)) return;
+			}
+			else {
+				// test both children and descend into the nearer one first
+				int left = current + 1;
+				int right = node.offset;
+				float tLeft, tRight;
+				bool hitLeft = nodes[left].bounds().intersect(origin, invDir, tMax, tLeft);
+				bool hitRight = nodes[right].bounds().intersect(origin, invDir, tMax, tRight);
+				if (hitLeft && hitRight) {
+					if (tRight < tLeft) { std::swap(left, right); std::swap(tLeft, tRight); }
+					stack[stackSize] = right;
+					stackNear[stackSize++] = tRight;
+					current = left;
+					continue;
+				}
+				if (hitLeft) { current = left; continue; }
+				if (hitRight) { current = right; continue; }
+			}
+			// pop the next node, skipping nodes that are now farther than the closest hit
+			do {
+				if (stackSize == 0) return;
+				stackSize--;
+			} while (stackNear[stackSize] > tMax);
+			current = stack[stackSize];
+		}
+	}
+
+	std::vector<BVHNode> nodes;		// flattened nodes in depth-first order, root at 0
+	std::vector<int> primIndices;	// primitive indices referenced by the leaves
+
+private:
+	// builds the subtree over primIndices[first, first + count) and returns its node index
+	int buildRecursive(const std::vector<AABB> &primBounds, const std::vector<glm::vec3> &centroids, int first, int count, int maxLeafSize, int depth);
+};
@@ -0,0 +1,389 @@
+// This file provides the implementation of the distributed renderer
+// - author: Jared Bechthold
+
+#include "distributedRender.h"
+#include "binaryIO.h"
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+// messages of the protocol between coordinator and workers
+enum MessageType : uint32_t {
+	MESSAGE_HELLO = 1,		// worker -> coordinator: protocol version
+	MESSAGE_JOB = 2,		// coordinator -> worker: frame number and scene arguments
+	MESSAGE_TILE = 3,		// coordinator -> worker: frame number, tile index and bounds
+	MESSAGE_RESULT = 4,		// worker -> coordinator: frame number, tile index and samples
+	MESSAGE_FAILED = 5,		// worker -> coordinator: frame number and reason
+	MESSAGE_SHUTDOWN = 6	// coordinator -> worker: exit
+};
+
+// changes whenever a message layout changes
+static const uint32_t PROTOCOL_VERSION = 1;
+
+//--------------------------------------------------------------
+// Returns a steady clock time in seconds
+static double now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//--------------------------------------------------------------
+// Reads the accumulated samples of a region of the framebuffer, row by row from the top
+static void regionSamples(const RayTracer &rayTracer, const Tile &tile, vector<glm::vec4> &samples) {
+	samples.clear();
+	samples.reserve(tile.pixelCount());
+	for (int row = rayTracer.imageHeight - tile.y1; row < rayTracer.imageHeight - tile.y0; row++) {
+		for (int x = tile.x0; x < tile.x1; x++) {
+			samples.push_back(rayTracer.framebuffer.getSamples(x, row));
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Renders a tile on the coordinator. renderRegion() also shades a one pixel
+// border around the tile, which must not overwrite the neighboring tiles
+// that are already assembled, so the border is restored afterwards.
+static void renderLocally(RayTracer &rayTracer, const Tile &tile) {
+	Tile border(std::max(tile.x0 - 1, 0), std::max(tile.y0 - 1, 0),
+		std::min(tile.x1 + 1, rayTracer.imageWidth), std::min(tile.y1 + 1, rayTracer.imageHeight));
+	vector<glm::vec4> saved;
+	regionSamples(rayTracer, border, saved);
+	rayTracer.renderRegion(tile);
+	int i = 0;
+	for (int row = rayTracer.imageHeight - border.y1; row < rayTracer.imageHeight - border.y0; row++) {
+		int y = rayTracer.imageHeight - 1 - row;
+		for (int x = border.x0; x < border.x1; x++, i++) {
+			if (x < tile.x0 || x >= tile.x1 || y < tile.y0 || y >= tile.y1) rayTracer.framebuffer.setSamples(x, row, saved[i]);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Listens for workers and starts the local ones, splitting the cores between them
+bool RenderCoordinator::start(const DistributedOptions &options, string &error) {
+	this->options = options;
+	if (!listener.listen(options.bindAddress, options.port, error)) return false;
+	cout << "coordinator listening on " << options.bindAddress << ":" << listener.getPort() << endl;
+	int threads = options.workerThreads > 0 ? options.workerThreads :
+		std::max(1, WorkStealingPool::hardwareThreads() / std::max(1, options.localWorkers));
+	for (int i = 0; i < options.localWorkers; i++) {
+		if (!spawnWorker(threads)) cout << "could not start local worker " << i << endl;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Runs the renderer itself with "--worker 127.0.0.1:<port>"
+bool RenderCoordinator::spawnWorker(int threads) {
+	string address = "127.0.0.1:" + ofToString(listener.getPort());
+	string threadCount = ofToString(threads);
+#ifdef _WIN32
+	// _spawnv passes the arguments on a command line, so the program path is quoted
+	string program = "\"" + options.workerProgram + "\"";
+	const char *argv[] = { program.c_str(), "--worker", address.c_str(), "--threads", threadCount.c_str(), NULL };
+	intptr_t child = _spawnv(_P_NOWAIT, options.workerProgram.c_str(), argv);
+	if (child == -1) return false;
+	children.push_back(child);
+#else
+	const char *argv[] = { options.workerProgram.c_str(), "--worker", address.c_str(), "--threads", threadCount.c_str(), NULL };
+	pid_t child;
+	if (posix_spawn(&child, options.workerProgram.c_str(), NULL, NULL, (char *const *)argv, environ) != 0) return false;
+	children.push_back(child);
+#endif
+	return true;
+}
+
+//--------------------------------------------------------------
+// Accepts the connection without waiting for its hello, which is read
+// by greetWorker() when it arrives
+void RenderCoordinator::acceptWorker() {
+	Worker worker;
+	worker.socket.reset(new MessageSocket());
+	if (!listener.accept(*worker.socket)) return;
+	worker.acceptedTime = now();
+	connecting.push_back(std::move(worker));
+}
+
+//--------------------------------------------------------------
+// Promotes the connection to a worker once its whole hello arrived
+void RenderCoordinator::greetWorker(size_t index) {
+	Worker &worker = connecting[index];
+	uint32_t type;
+	vector<char> payload;
+	if (!worker.socket->receiveAvailable(type, payload)) {
+		if (!worker.socket->isOpen()) connecting.erase(connecting.begin() + index);
+		return;
+	}
+	uint32_t version = 0;
+	if (type != MESSAGE_HELLO || !BinaryReader(payload.data(), payload.size()).read(version) || version != PROTOCOL_VERSION) {
+		cout << "rejected a worker with a different protocol" << endl;
+		connecting.erase(connecting.begin() + index);
+		return;
+	}
+	workers.push_back(std::move(worker));
+	connecting.erase(connecting.begin() + index);
+	cout << "worker connected (" << workers.size() << " total)" << endl;
+}
+
+//--------------------------------------------------------------
+// Puts the worker's tiles back at the front of the queue so they are
+// picked up first by the remaining workers
+void RenderCoordinator::dropWorker(size_t index, const string &reason) {
+	Worker &worker = workers[index];
+	cout << "dropping worker: " << reason << " (" << worker.tiles.size() << " tiles requeued)" << endl;
+	for (auto tile = worker.tiles.rbegin(); tile != worker.tiles.rend(); tile++) {
+		pending.push_front(*tile);
+	}
+	workers.erase(workers.begin() + index);
+}
+
+//--------------------------------------------------------------
+// Hands out tiles, collects results and reassigns the tiles of failed
+// workers until every tile of the frame is in the framebuffer
+void RenderCoordinator::renderFrame(RayTracer &rayTracer, const vector<string> &job) {
+	frame++;
+	TileRenderer splitter;
+	splitter.setTileSize(options.tileSize);
+	tiles = splitter.makeTiles(rayTracer.imageWidth, rayTracer.imageHeight);
+	attempts.assign(tiles.size(), 0);
+	pending.clear();
+	for (size_t i = 0; i < tiles.size(); i++) pending.push_back((int)i);
+	vector<bool> done(tiles.size(), false);
+	size_t remaining = tiles.size();
+	rayTracer.framebuffer.clear();
+
+	// the job is the same for every worker of the frame
+	BinaryWriter jobMessage;
+	jobMessage.write((uint32_t)frame);
+	jobMessage.write((uint32_t)job.size());
+	for (const string &argument : job) jobMessage.writeString(argument);
+
+	bool localReady = false;		// the coordinator's own scene is prepared for rendering
+	double workerSeen = now();		// last time a worker was connected
+	uint32_t type;
+	vector<char> payload;
+	while (remaining > 0) {
+		// sends the job to new workers and tops up the tile queue of each worker
+		for (size_t i = 0; i < workers.size(); i++) {
+			Worker &worker = workers[i];
+			if (worker.frame != frame) {
+				worker.frame = frame;
+				if (!worker.socket->send(MESSAGE_JOB, jobMessage.buffer)) {
+					dropWorker(i--, "connection lost");
+					continue;
+				}
+			}
+			while ((int)worker.tiles.size() < options.tilesInFlight && !pending.empty()) {
+				int index = pending.front();
+				// a tile that failed too often is left to the coordinator
+				if (attempts[index] >= options.maxAttempts) break;
+				pending.pop_front();
+				const Tile &tile = tiles[index];
+				BinaryWriter message;
+				message.write((uint32_t)frame);
+				message.write((uint32_t)index);
+				message.write(tile.x0);
+				message.write(tile.y0);
+				message.write(tile.x1);
+				message.write(tile.y1);
+				attempts[index]++;
+				worker.tiles.push_back(index);
+				worker.sentTimes.push_back(now());
+				if (!worker.socket->send(MESSAGE_TILE, message.buffer)) break;
+			}
+			if (!worker.socket->isOpen()) dropWorker(i--, "connection lost");
+		}
+
+		// renders locally the tiles nobody else can: tiles that failed on
+		// maxAttempts workers, or everything while no worker is connected
+		if (!workers.empty()) workerSeen = now();
+		bool alone = workers.empty() && now() - workerSeen > options.workerWait;
+		while (!pending.empty() && (alone || attempts[pending.front()] >= options.maxAttempts)) {
+			if (!localReady) {
+				cout << (alone ? "no workers, rendering on the coordinator" : "rendering failed tiles on the coordinator") << endl;
+				rayTracer.prepareRender();
+				localReady = true;
+			}
+			int index = pending.front();
+			pending.pop_front();
+			renderLocally(rayTracer, tiles[index]);
+			done[index] = true;
+			remaining--;
+		}
+		if (remaining == 0) break;
+
+		// waits for results, hellos and new connections: the listener comes first,
+		// then the connections that have not said hello, then the workers
+		vector<SocketHandle> handles(1, listener.handle);
+		for (Worker &connection : connecting) handles.push_back(connection.socket->handle);
+		for (Worker &worker : workers) handles.push_back(worker.socket->handle);
+		size_t firstWorker = 1 + connecting.size();
+		vector<bool> readable;
+		if (MessageSocket::waitReadable(handles, 0.1, readable)) {
+			// only the bytes that arrived are read, so a worker in the middle of
+			// sending a result never holds up the others
+			for (size_t w = workers.size(); w-- > 0;) {
+				if (!readable[firstWorker + w]) continue;
+				Worker &worker = workers[w];
+				if (!worker.socket->receiveAvailable(type, payload)) {
+					if (!worker.socket->isOpen()) dropWorker(w, "connection lost");
+					continue;
+				}
+				BinaryReader reader(payload.data(), payload.size());
+				uint32_t messageFrame, index;
+				if (!reader.read(messageFrame)) {
+					dropWorker(w, "bad message");
+					continue;
+				}
+				if (type == MESSAGE_FAILED) {
+					string reason;
+					reader.readString(reason);
+					dropWorker(w, reason);
+					continue;
+				}
+				vector<glm::vec4> samples;
+				if (type != MESSAGE_RESULT || !reader.read(index) || !reader.readArray(samples)) {
+					dropWorker(w, "bad message");
+					continue;
+				}
+				// results of tiles the worker no longer owns (an earlier frame) are ignored
+				auto owned = std::find(worker.tiles.begin(), worker.tiles.end(), (int)index);
+				if (messageFrame != (uint32_t)frame || owned == worker.tiles.end()) continue;
+				const Tile &tile = tiles[index];
+				int tileWidth = tile.x1 - tile.x0;
+				if (samples.size() != (size_t)tile.pixelCount()) {
+					dropWorker(w, "wrong tile size");
+					continue;
+				}
+				worker.sentTimes.erase(worker.sentTimes.begin() + (owned - worker.tiles.begin()));
+				worker.tiles.erase(owned);
+				if (done[index]) continue;
+				for (int row = 0; row < tile.y1 - tile.y0; row++) {
+					rayTracer.framebuffer.addSamples(rayTracer.imageHeight - tile.y1 + row, tile.x0, &samples[row * tileWidth], tileWidth);
+				}
+				done[index] = true;
+				remaining--;
+			}
+			// new workers are added after the results so the indices above stay valid
+			for (size_t c = connecting.size(); c-- > 0;) {
+				if (readable[1 + c]) greetWorker(c);
+			}
+			if (readable[0]) acceptWorker();
+		}
+
+		// drops workers that sit on a tile for too long and connections that never say hello
+		for (size_t i = workers.size(); i-- > 0;) {
+			if (!workers[i].sentTimes.empty() && now() - workers[i].sentTimes.front() > options.tileTimeout) {
+				dropWorker(i, "tile timed out");
+			}
+		}
+		for (size_t c = connecting.size(); c-- > 0;) {
+			if (now() - connecting[c].acceptedTime > options.helloTimeout) {
+				cout << "dropped a connection that sent no hello" << endl;
+				connecting.erase(connecting.begin() + c);
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Sends the shutdown message, closes the connections and reaps the local workers
+void RenderCoordinator::finish() {
+	for (Worker &worker : workers) {
+		worker.socket->send(MESSAGE_SHUTDOWN, vector<char>());
+	}
+	workers.clear();
+	connecting.clear();
+	listener.close();
+	for (intptr_t child : children) {
+#ifdef _WIN32
+		_cwait(NULL, child, 0);
+#else
+		waitpid((pid_t)child, NULL, 0);
+#endif
+	}
+	children.clear();
+}
+
+//--------------------------------------------------------------
+// Sends a failure message for the current frame
+static void sendFailure(MessageSocket &socket, uint32_t frame, const string &reason) {
+	BinaryWriter message;
+	message.write(frame);
+	message.writeString(reason);
+	socket.send(MESSAGE_FAILED, message.buffer);
+}
+
+//--------------------------------------------------------------
+// Connects, then rebuilds the scene for every job and renders each tile
+// it is sent until the coordinator shuts it down or disconnects
+int runRenderWorker(const string &host, int port, int threads, const SceneBuilder &buildScene) {
+	// the coordinator may still be starting up
+	MessageSocket socket;
+	string error;
+	double giveUp = now() + 10;
+	while (!socket.connect(host, port, error)) {
+		if (now() > giveUp) {
+			cerr << error << endl;
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}
+	BinaryWriter hello;
+	hello.write(PROTOCOL_VERSION);
+	socket.send(MESSAGE_HELLO, hello.buffer);
+	cout << "worker connected to " << host << ":" << port << endl;
+
+	RayTracer *rayTracer = NULL;			// scene of the current job
+	uint32_t jobFrame = 0;					// frame of the current job
+	uint32_t type;
+	vector<char> payload;
+	vector<glm::vec4> samples;
+	while (socket.receive(type, payload, -1)) {
+		BinaryReader reader(payload.data(), payload.size());
+		if (type == MESSAGE_SHUTDOWN) return 0;
+		if (type == MESSAGE_JOB) {
+			// builds the frame's scene from its arguments
+			uint32_t count = 0;
+			vector<string> job;
+			reader.read(jobFrame);
+			reader.read(count);
+			job.resize(count);
+			for (string &argument : job) reader.readString(argument);
+			rayTracer = buildScene(job, error);
+			if (rayTracer == NULL) {
+				sendFailure(socket, jobFrame, "could not build the scene: " + error);
+				continue;
+			}
+			// the scene setup applies the job's thread count, which is not this worker's
+			rayTracer->renderThreads = threads;
+			rayTracer->prepareRender();
+		}
+		else if (type == MESSAGE_TILE) {
+			// renders the tile and returns its samples
+			uint32_t frame = jobFrame, index = 0;
+			int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+			if (!reader.read(frame) || !reader.read(index) || !reader.read(x0) || !reader.read(y0) || !reader.read(x1) || !reader.read(y1) ||
+				!rayTracer || frame != jobFrame || x0 < 0 || y0 < 0 || x1 > rayTracer->imageWidth || y1 > rayTracer->imageHeight || x0 >= x1 || y0 >= y1) {
+				sendFailure(socket, frame, "bad tile");
+				continue;
+			}
+			Tile tile(x0, y0, x1, y1);
+			rayTracer->renderRegion(tile);
+			regionSamples(*rayTracer, tile, samples);
+			BinaryWriter result;
+			result.write(frame);
+			result.write(index);
+			result.writeArray(samples);
+			if (!socket.send(MESSAGE_RESULT, result.buffer)) break;
+		}
+	}
+	cerr << "lost the connection to the coordinator" << endl;
+	return 1;
+}
@@ -0,0 +1,103 @@
+// This file provides the class definitions of the distributed renderer: a
+// RenderCoordinator that splits frames into tiles and hands them to worker
+// processes over TCP, and the worker loop that renders them
+// - author: Jared Bechthold
+//
+// Workers connect to the coordinator, which sends each of them a job (the
+// command line arguments that build the frame's scene, see renderCli.h)
+// followed by tiles. A worker renders a tile with its own thread pool,
+// including antialiasing, and sends back the tile's accumulated float
+// samples, which the coordinator adds to its framebuffer. Tiles of a
+// worker that disconnects, reports an error or goes silent are handed to
+// the other workers; a tile that fails maxAttempts times, or any tile
+// while no worker is connected, is rendered by the coordinator itself.
+// Scene and asset paths in the job must be valid on every worker. The
+// coordinator only listens on the loopback address unless it is given
+// another one, since anyone who can connect is handed the job's paths.
+//
+// The coordinator never blocks on one connection: hellos and results are
+// read as their bytes arrive, so a slow worker or a half sent message does
+// not hold up the other workers.
+
+#pragma once
+
+#include "rayTracer.h"
+#include "messageSocket.h"
+#include <deque>
+#include <functional>
+#include <memory>
+
+//  Settings of a RenderCoordinator
+//
+struct DistributedOptions {
+	int port = 0;				// port workers connect to (0 picks a free port)
+	string bindAddress = "127.0.0.1";	// IPv4 address the coordinator listens on (0.0.0.0 for remote workers)
+	int localWorkers = 0;		// worker processes started on this machine
+	string workerProgram;		// executable run for the local workers (the renderer itself)
+	int workerThreads = 0;		// render threads of each local worker (0 splits the cores between them)
+	int tileSize = 64;			// width and height of the tiles handed to workers
+	int tilesInFlight = 2;		// tiles queued on a worker at once, to hide the network latency
+	int maxAttempts = 3;		// times a tile is handed out before the coordinator renders it
+	double tileTimeout = 120;	// seconds a worker may take for a tile before it is dropped
+	double workerWait = 10;		// seconds without any worker before the coordinator renders alone
+	double helloTimeout = 10;	// seconds a new connection may take to send its hello
+};
+
+//  Hands the tiles of one frame after another to the connected workers and
+//  assembles the results in the framebuffer of the coordinator's RayTracer
+//
+class RenderCoordinator {
+public:
+	// shuts the workers down
+	~RenderCoordinator() { finish(); }
+
+	// listens for workers and starts the local worker processes; returns false and sets error on failure
+	bool start(const DistributedOptions &options, string &error);
+	// renders a frame into rayTracer.framebuffer. rayTracer must hold the scene
+	// built from job: it sets the image size and renders the tiles no worker
+	// could, so the frame is always finished
+	void renderFrame(RayTracer &rayTracer, const vector<string> &job);
+	// tells every worker to exit and waits for the local worker processes
+	void finish();
+	// returns the port workers connect to
+	int getPort() const { return listener.getPort(); }
+
+private:
+	//  Connection to one worker and the tiles it is rendering
+	struct Worker {
+		std::unique_ptr<MessageSocket> socket;	// connection to the worker
+		int frame = -1;							// frame whose job the worker holds
+		std::deque<int> tiles;					// tiles sent and not yet returned, oldest first
+		std::deque<double> sentTimes;			// time each of those tiles was sent
+		double acceptedTime = 0;				// time the connection was accepted
+	};
+
+	// accepts a connection, which becomes a worker once its hello arrives
+	void acceptWorker();
+	// reads what arrived of a new connection's hello and keeps the connection as a
+	// worker if it speaks our protocol
+	void greetWorker(size_t index);
+	// closes a worker's connection and puts its tiles back into pending
+	void dropWorker(size_t index, const string &reason);
+	// starts one local worker process; returns false if it could not be started
+	bool spawnWorker(int threads);
+
+	DistributedOptions options;		// settings given to start()
+	ListenSocket listener;			// socket the workers connect to
+	vector<Worker> workers;			// connected workers
+	vector<Worker> connecting;		// accepted connections whose hello has not arrived
+	vector<intptr_t> children;		// local worker processes
+	int frame = 0;					// number of the frame being rendered
+	vector<Tile> tiles;				// tiles of the current frame
+	vector<int> attempts;			// times each tile was handed out
+	std::deque<int> pending;		// tiles waiting for a worker
+};
+
+// builds the scene of a job and returns it (owned by the builder, which may reuse
+// it for the next job); returns NULL and sets error on failure
+typedef std::function<RayTracer *(const vector<string> &job, string &error)> SceneBuilder;
+
+// connects to the coordinator at host:port (retrying for a few seconds while it
+// starts) and renders the tiles it sends until it shuts the worker down;
+// returns the process exit code
+int runRenderWorker(const string &host, int port, int threads, const SceneBuilder &buildScene);
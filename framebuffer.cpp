@@ -0,0 +1,126 @@
+// This file provides the implementation of the Framebuffer and ToneMap classes
+// - author: Jared Bechthold
+
+#include "framebuffer.h"
+
+//--------------------------------------------------------------
+// Scales by the exposure, applies the curve and encodes with the gamma
+glm::vec3 ToneMap::apply(glm::vec3 color) const {
+	color *= pow(2.0f, exposure);
+	switch (op) {
+	case TONEMAP_REINHARD:
+		color = color / (glm::vec3(1) + color);
+		break;
+	case TONEMAP_ACES: {
+		// rational fit of the ACES reference rendering transform
+		glm::vec3 numerator = color * (2.51f * color + glm::vec3(0.03f));
+		glm::vec3 denominator = color * (2.43f * color + glm::vec3(0.59f)) + glm::vec3(0.14f);
+		color = numerator / denominator;
+		break;
+	}
+	default:
+		break;
+	}
+	color = glm::clamp(color, glm::vec3(0), glm::vec3(1));
+	if (gamma != 1) color = glm::pow(color, glm::vec3(1.0f / gamma));
+	return color;
+}
+
+//--------------------------------------------------------------
+// Looks an operator up by its command line name
+bool ToneMap::parseOperator(const string &name, ToneMapOperator &op) {
+	if (name == "clamp") op = TONEMAP_CLAMP;
+	else if (name == "reinhard") op = TONEMAP_REINHARD;
+	else if (name == "aces") op = TONEMAP_ACES;
+	else return false;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Sizes the pixel array and clears it
+void Framebuffer::allocate(int width, int height) {
+	this->width = width;
+	this->height = height;
+	pixels.assign((size_t)width * height, glm::vec4(0));
+}
+
+//--------------------------------------------------------------
+// Writes a run of single sample pixels of one row
+void Framebuffer::setRow(int y, int x, const glm::vec3 *colors, int count) {
+	glm::vec4 *row = &pixels[(size_t)y * width + x];
+	for (int i = 0; i < count; i++) {
+		row[i] = glm::vec4(colors[i], 1);
+	}
+}
+
+//--------------------------------------------------------------
+// Adds a run of accumulated samples to one row
+void Framebuffer::addSamples(int y, int x, const glm::vec4 *samples, int count) {
+	glm::vec4 *row = &pixels[(size_t)y * width + x];
+	for (int i = 0; i < count; i++) {
+		row[i] += samples[i];
+	}
+}
+
+//--------------------------------------------------------------
+// Resolves, tonemaps and rounds every pixel to 8 bits per channel
+void Framebuffer::toPixels(ofPixels &out, const ToneMap &toneMap) const {
+	if ((int)out.getWidth() != width || (int)out.getHeight() != height || out.getNumChannels() != 3) {
+		out.allocate(width, height, OF_PIXELS_RGB);
+	}
+	unsigned char *data = out.getData();
+	for (size_t i = 0; i < pixels.size(); i++) {
+		glm::vec3 color = toneMap.apply(resolve(pixels[i])) * 255.0f + glm::vec3(0.5f);
+		data[3 * i] = (unsigned char)color.x;
+		data[3 * i + 1] = (unsigned char)color.y;
+		data[3 * i + 2] = (unsigned char)color.z;
+	}
+}
+
+//--------------------------------------------------------------
+// Copies the resolved linear colors without any mapping
+void Framebuffer::toFloatPixels(ofFloatPixels &out) const {
+	out.allocate(width, height, OF_PIXELS_RGB);
+	float *data = out.getData();
+	for (size_t i = 0; i < pixels.size(); i++) {
+		glm::vec3 color = resolve(pixels[i]);
+		data[3 * i] = color.x;
+		data[3 * i + 1] = color.y;
+		data[3 * i + 2] = color.z;
+	}
+}
+
+//--------------------------------------------------------------
+// Chooses the encoding from the file extension
+bool Framebuffer::save(const string &path, const ToneMap &toneMap) const {
+	string extension = ofToLower(ofFilePath::getFileExt(path));
+	if (extension == "pfm") return savePFM(path);
+	if (extension == "exr") {
+		ofFloatPixels floats;
+		toFloatPixels(floats);
+		return ofSaveImage(floats, path);
+	}
+	ofPixels bytes;
+	toPixels(bytes, toneMap);
+	return ofSaveImage(bytes, path);
+}
+
+//--------------------------------------------------------------
+// Writes the "PF" header (a negative scale marks little endian data)
+// followed by the rows from the bottom of the image up
+bool Framebuffer::savePFM(const string &path) const {
+	ofstream file(path, std::ios::binary);
+	if (!file) return false;
+	file << "PF\n" << width << " " << height << "\n-1.0\n";
+	vector<float> row(3 * (size_t)width);
+	for (int y = height - 1; y >= 0; y--) {
+		for (int x = 0; x < width; x++) {
+			glm::vec3 color = getPixel(x, y);
+			row[3 * x] = color.x;
+			row[3 * x + 1] = color.y;
+			row[3 * x + 2] = color.z;
+		}
+		file.write((const char *)row.data(), row.size() * sizeof(float));
+	}
+	return (bool)file;
+}
@@ -0,0 +1,92 @@
+// This file provides the class definitions of Framebuffer, the linear float
+// image the renderer accumulates into, and ToneMap, which turns it into an
+// 8-bit image
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "ofMain.h"
+
+// returns an 8-bit color as a linear color where 1.0 is full intensity
+inline glm::vec3 linearColor(const ofColor &color) {
+	return glm::vec3(color.r, color.g, color.b) / 255.0f;
+}
+
+// returns the Rec. 709 luminance of a linear color
+inline float luminance(const glm::vec3 &color) {
+	return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+}
+
+//  Operators that map linear colors above 1.0 into the displayable range
+//
+enum ToneMapOperator {
+	TONEMAP_CLAMP,		// cuts off everything above 1.0 (the look of the old 8-bit renderer)
+	TONEMAP_REINHARD,	// x / (1 + x) per channel
+	TONEMAP_ACES		// filmic curve fitted to ACES by Krzysztof Narkowicz
+};
+
+//  Settings of the tonemap and quantize pass
+//
+struct ToneMap {
+	ToneMapOperator op = TONEMAP_CLAMP;	// curve applied after the exposure
+	float exposure = 0;					// scales colors by 2^exposure before the curve
+	float gamma = 1;					// encoding gamma (1 keeps the shading's display space colors)
+
+	// maps a linear color to the 0 - 1 display range
+	glm::vec3 apply(glm::vec3 color) const;
+	// returns the operator with the given name ("clamp", "reinhard" or "aces");
+	// returns false if the name is unknown
+	static bool parseOperator(const string &name, ToneMapOperator &op);
+};
+
+//  Linear float32 RGBA image, stored row by row from the top of the image
+//  Every pixel accumulates weighted samples: rgb holds the weighted sum of
+//  the samples and a the sum of their weights, so samples can be added
+//  progressively (or merged from other renders) without losing precision.
+//
+class Framebuffer {
+public:
+	// allocates a width x height framebuffer with every pixel cleared
+	void allocate(int width, int height);
+	// clears every pixel to no samples
+	void clear() { std::fill(pixels.begin(), pixels.end(), glm::vec4(0)); }
+	// returns the size of the framebuffer
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	// replaces the samples of a pixel with a single color
+	void setPixel(int x, int y, const glm::vec3 &color) { pixels[(size_t)y * width + x] = glm::vec4(color, 1); }
+	// adds a weighted sample to a pixel
+	void addSample(int x, int y, const glm::vec3 &color, float weight = 1) {
+		glm::vec4 &p = pixels[(size_t)y * width + x];
+		p += glm::vec4(color * weight, weight);
+	}
+	// returns the average of the samples of a pixel (black without samples)
+	glm::vec3 getPixel(int x, int y) const { return resolve(pixels[(size_t)y * width + x]); }
+	// returns the accumulated samples of a pixel (weighted rgb sum, weight sum)
+	const glm::vec4 &getSamples(int x, int y) const { return pixels[(size_t)y * width + x]; }
+	// replaces the accumulated samples of a pixel
+	void setSamples(int x, int y, const glm::vec4 &samples) { pixels[(size_t)y * width + x] = samples; }
+	// replaces count pixels of row y starting at column x with single colors
+	void setRow(int y, int x, const glm::vec3 *colors, int count);
+	// adds the accumulated samples of another framebuffer region to this one
+	void addSamples(int y, int x, const glm::vec4 *samples, int count);
+
+	// tonemaps and quantizes the framebuffer into an 8-bit RGB image
+	void toPixels(ofPixels &out, const ToneMap &toneMap) const;
+	// copies the resolved linear colors into a float RGB image
+	void toFloatPixels(ofFloatPixels &out) const;
+	// writes the framebuffer to a file: .pfm and .exr files keep the linear
+	// floats, other formats are tonemapped to 8 bits; returns false on failure
+	bool save(const string &path, const ToneMap &toneMap) const;
+	// writes the linear colors as a Portable Float Map (little endian RGB)
+	bool savePFM(const string &path) const;
+
+private:
+	// returns the average color of accumulated samples
+	static glm::vec3 resolve(const glm::vec4 &p) { return p.w > 0 ? glm::vec3(p) / p.w : glm::vec3(0); }
+
+	int width = 0;				// width in pixels
+	int height = 0;				// height in pixels
+	vector<glm::vec4> pixels;	// accumulated samples, row by row
+};
@@ -0,0 +1,171 @@
+// This file provides the G-buffer recording and re-shading of the RayTracer
+// - author: Jared Bechthold
+
+#include "rayTracer.h"
+
+//  Running FNV-1a hash of the values the G-buffer depends on
+//
+struct KeyHash {
+	uint64_t value = 14695981039346656037ull;	// hash of the bytes added so far
+
+	// adds the bytes of a plain value to the hash
+	template<class T>
+	void add(const T &data) {
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&data);
+		for (size_t i = 0; i < sizeof(T); i++) {
+			value = (value ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+};
+
+//--------------------------------------------------------------
+// Hashes what decides the camera rays, their hits, the base colors, the
+// shadow rays and which hits scatter. The object arenas reuse their blocks
+// after clearScene(), so a reloaded scene can hold objects at the addresses
+// of the old one; the scene generation tells the two scenes apart.
+uint64_t RayTracer::gBufferKey() const {
+	KeyHash hash;
+	hash.add(imageWidth);
+	hash.add(imageHeight);
+	hash.add(renderCam.position);
+	hash.add(renderCam.aim);
+	hash.add(renderCam.up);
+	hash.add(renderCam.fov);
+	hash.add(renderCam.aperture);
+	hash.add(renderCam.focusDistance);
+	hash.add(renderCam.view.min);
+	hash.add(renderCam.view.max);
+	hash.add(renderCam.view.position);
+
+	hash.add(sceneGeneration);
+	hash.add(scene.size());
+	for (SceneObject *object : scene) {
+		AABB bounds = object->getBounds();
+		hash.add(object);
+		hash.add(object->position);
+		hash.add(bounds.min);
+		hash.add(bounds.max);
+		hash.add(object->diffuseColor);
+		hash.add(object->material);
+		if (object->type != OBJECT_PLANE) continue;
+		// the base color of a textured plane is its filtered texel
+		const Plane *plane = static_cast<const Plane *>(object);
+		hash.add(plane->textureApplied);
+		hash.add(plane->textureVersion);
+		hash.add(plane->textureFilter);
+		hash.add(plane->tilesX);
+		hash.add(plane->tilesY);
+		for (char c : plane->textureFile) hash.add(c);
+	}
+	// the specular color only changes the shading
+	hash.add(materials.size());
+	for (const Material &material : materials) {
+		hash.add(material.reflectance);
+		hash.add(material.transmission);
+		hash.add(material.ior);
+		hash.add(material.gloss);
+	}
+
+	// light positions and what decides their sample points, but not their intensities
+	hash.add(lights.size());
+	for (const PointLight &light : lights) {
+		hash.add(light.position);
+	}
+	hash.add(areaLightCount());
+	for (int i = 0; i < areaLightCount(); i++) {
+		const AreaLight &light = areaLightAt(i);
+		hash.add(light.position);
+		hash.add(light.triangles.size());
+		hash.add(light.area);
+		for (const glm::vec3 &vertex : light.verts) hash.add(vertex);
+		for (const Triangle &triangle : light.triangles) hash.add(triangle.vertInd);
+	}
+	hash.add(areaLightSamples);
+	hash.add(areaLightImportance);
+	hash.add(lightTreeThreshold);
+	hash.add(lightTreeSamples);
+	return hash.value;
+}
+
+//--------------------------------------------------------------
+// Traces the camera ray and shades its hit like the Whitted integrator,
+// keeping the hit, its texture filtered color and every shadow ray result
+glm::vec3 RayTracer::recordPixel(const glm::vec3 &offset, glm::vec2 lens, float footprint, const glm::vec3 &backgroundColor,
+	int x, int y, vector<SecondaryRay> *deferred, int pixel)
+{
+	RT_STAT(primaryRays);
+	GBufferSample &sample = gBuffer.sample(x, y);
+	Ray ray = renderCam.getRay(offset, lens);
+	HitRecord hit;
+	if (!sceneBVH.intersect(ray, hit)) {
+		sample.state = GBUFFER_BACKGROUND;
+		return backgroundColor;
+	}
+
+	// the neighbors are one footprint away so textures are filtered over it
+	RayDifferential differential = renderCam.getRayDifferential(ray, offset, footprint);
+	glm::vec3 dpdx, dpdy;
+	differential.footprint(hit, dpdx, dpdy);
+	sample.point = hit.point;
+	sample.normal = hit.normal;
+	sample.direction = ray.d;
+	sample.color = linearColor(hit.object->getColor(hit.point, dpdx, dpdy));
+	sample.object = hit.object;
+	sample.state = GBUFFER_SURFACE;
+
+	LightVisibility visibility = gBuffer.visibility(x, y);
+	glm::vec3 color = shadeSurface(ray, hit, sample.color, &visibility);
+	scatter(ray, hit, glm::vec3(1), pixel, 1, *deferred);
+	return color;
+}
+
+//--------------------------------------------------------------
+// Shades every recorded hit of the tile with the current shading settings
+// and its recorded shadow rays, then traces the reflected and refracted
+// rays of the tile in batches like renderTile()
+void RayTracer::reshadeTile(const Tile &tile, const ofColor &background)
+{
+	glm::vec3 backgroundColor = linearColor(background);
+	int tileWidth = tile.x1 - tile.x0;
+	int firstRow = imageHeight - tile.y1;		// top image row of the tile (v grows up, rows grow down)
+	vector<glm::vec3> colors(tile.pixelCount());	// colors of the tile, row by row from the top
+	static thread_local vector<SecondaryRay> secondary;	// reflected and refracted rays of the tile
+	static thread_local vector<float> costs;		// seconds spent on the pixels of the tile (RT_STATS)
+	secondary.clear();
+	if (RENDER_STATS) costs.assign(colors.size(), 0);
+
+	for (int y = tile.y0; y < tile.y1; y++) {
+		for (int x = tile.x0; x < tile.x1; x++) {
+			int index = (imageHeight - 1 - y - firstRow) * tileWidth + (x - tile.x0);
+			const GBufferSample &sample = gBuffer.sample(x, y);
+			if (sample.state != GBUFFER_SURFACE) {
+				colors[index] = backgroundColor;
+				continue;
+			}
+			// only the direction of the camera ray is used for shading
+			Ray ray(sample.point, sample.direction);
+			HitRecord hit;
+			hit.point = sample.point;
+			hit.normal = sample.normal;
+			hit.object = sample.object;
+			double begin = statClock();
+			LightVisibility visibility = gBuffer.visibility(x, y);
+			colors[index] = shadeSurface(ray, hit, sample.color, &visibility);
+			scatter(ray, hit, glm::vec3(1), index, 1, secondary);
+			if (RENDER_STATS) costs[index] += (float)(statClock() - begin);
+		}
+	}
+	if (!secondary.empty()) traceSecondary(secondary, colors.data(), backgroundColor, RENDER_STATS ? costs.data() : NULL);
+	if (RENDER_STATS) {
+		for (int i = 0; i < (int)costs.size(); i++) {
+			profile.addPixelCost(tile.x0 + i % tileWidth, firstRow + i / tileWidth, costs[i]);
+		}
+	}
+
+	// writes the rows of the tile to the framebuffer
+	std::lock_guard<std::mutex> lock(frameMutex);
+	for (int row = 0; row < tile.y1 - tile.y0; row++) {
+		framebuffer.setRow(firstRow + row, tile.x0, &colors[row * tileWidth], tileWidth);
+	}
+	frameVersion++;
+}
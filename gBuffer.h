@@ -0,0 +1,144 @@
+// This file provides the class definitions of GBuffer, the primary hits and
+// shadow ray results kept from the last render, and LightVisibility
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SceneObject;
+
+// what a G-buffer pixel holds
+enum GBufferState : uint8_t {
+	GBUFFER_EMPTY = 0,		// not rendered yet
+	GBUFFER_BACKGROUND = 1,	// the camera ray missed the scene
+	GBUFFER_SURFACE = 2		// a hit, re-shaded from the cache (its reflected and refracted rays are traced again)
+};
+
+//  Primary hit of the center sample of one pixel
+//
+struct GBufferSample {
+	glm::vec3 point;				// point where the camera ray hit the object
+	glm::vec3 normal;				// surface normal at the hit point
+	glm::vec3 direction;			// direction of the camera ray
+	glm::vec3 color;				// linear base color from SceneObject::getColor (texture filtered)
+	SceneObject *object = NULL;		// object that was hit
+	GBufferState state = GBUFFER_EMPTY;	// what the pixel holds
+};
+
+//  Shadow ray results of one G-buffer pixel
+//  Lights are numbered like the shadow cache slots (see RayTracer::shadowCheck):
+//  point light i has one result, and each area light one per sample up to
+//  the 64th. Results that were never traced (lights skipped as too dim at
+//  the time, samples past 64) are unknown, so a re-shade traces them and
+//  records what it finds.
+//
+class LightVisibility {
+public:
+	// LightVisibility constructor over the words of one pixel (see GBuffer)
+	LightVisibility(uint64_t *words, int pointLights) {
+		this->words = words;
+		this->pointLights = pointLights;
+		pointWords = (pointLights + 63) / 64;
+	}
+
+	// returns true and sets blocked if the shadow ray of a light's sample was traced
+	bool lookup(int light, int sample, bool &blocked) const {
+		uint64_t *tested, *result;
+		uint64_t bit;
+		if (!locate(light, sample, tested, result, bit) || (*tested & bit) == 0) return false;
+		blocked = (*result & bit) != 0;
+		return true;
+	}
+	// records the result of the shadow ray of a light's sample
+	void record(int light, int sample, bool blocked) {
+		uint64_t *tested, *result;
+		uint64_t bit;
+		if (!locate(light, sample, tested, result, bit)) return;
+		*tested |= bit;
+		if (blocked) *result |= bit;
+		else *result &= ~bit;
+	}
+
+	// returns the number of words a pixel needs for the given lights
+	static int wordCount(int pointLights, int areaLights) { return 2 * ((pointLights + 63) / 64) + 2 * areaLights; }
+
+private:
+	// finds the tested and result words and the bit of a light's sample; returns
+	// false if the sample has no bit. The words start with the tested bits of the
+	// point lights, then their results, then a tested and a result word per area light.
+	bool locate(int light, int sample, uint64_t *&tested, uint64_t *&result, uint64_t &bit) const {
+		if (light < pointLights) {
+			tested = words + light / 64;
+			result = words + pointWords + light / 64;
+			bit = 1ull << (light % 64);
+			return true;
+		}
+		if (sample < 0 || sample >= 64) return false;
+		tested = words + 2 * pointWords + 2 * (light - pointLights);
+		result = tested + 1;
+		bit = 1ull << sample;
+		return true;
+	}
+
+	uint64_t *words;	// tested and result bits of the pixel
+	int pointLights;	// number of point lights (lower light numbers)
+	int pointWords;		// words per bit set of the point lights
+};
+
+//  Primary hits and shadow ray results of the center samples of the last
+//  render, one per pixel, kept so a change that only affects shading
+//  (Phong power, light intensities, specular colors) re-shades the image
+//  without tracing camera or shadow rays; only the reflected and refracted
+//  rays of mirrors and glass are traced again. The buffer belongs to the scene
+//  state it was rendered from, identified by a key (see RayTracer::gBufferKey).
+//
+class GBuffer {
+public:
+	// allocates a cleared buffer for a render of width x height pixels lit by the
+	// given lights, forgetting the last render; the buffer records until finish()
+	void allocate(int width, int height, int pointLights, int areaLights) {
+		this->width = width;
+		this->height = height;
+		this->pointLights = pointLights;
+		stride = LightVisibility::wordCount(pointLights, areaLights);
+		samples.assign((size_t)width * height, GBufferSample());
+		words.assign((size_t)width * height * stride, 0);
+		complete = false;
+	}
+	// frees the buffer
+	void clear() {
+		samples = std::vector<GBufferSample>();
+		words = std::vector<uint64_t>();
+		complete = false;
+	}
+	// marks the render complete; key identifies the scene state it shows
+	void finish(uint64_t key) {
+		this->key = key;
+		complete = true;
+	}
+	// returns true while a render records into the buffer
+	bool recording() const { return !samples.empty() && !complete; }
+	// returns true if a complete render of the given size and scene state is cached
+	bool matches(uint64_t key, int width, int height) const {
+		return complete && this->key == key && this->width == width && this->height == height;
+	}
+
+	// returns the sample of a pixel (y grows up, like the pixels of a Tile)
+	GBufferSample &sample(int x, int y) { return samples[(size_t)y * width + x]; }
+	// returns the shadow ray results of a pixel
+	LightVisibility visibility(int x, int y) { return LightVisibility(words.data() + ((size_t)y * width + x) * stride, pointLights); }
+
+private:
+	int width = 0;					// width in pixels
+	int height = 0;					// height in pixels
+	int pointLights = 0;			// point lights of the render
+	int stride = 0;					// visibility words per pixel
+	uint64_t key = 0;				// scene state of the complete render
+	bool complete = false;			// true once a render finished recording
+	std::vector<GBufferSample> samples;	// hits, row by row from the bottom
+	std::vector<uint64_t> words;	// visibility bits, stride words per pixel
+};
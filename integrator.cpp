@@ -0,0 +1,265 @@
+// This file provides the implementation of the integrators
+// - author: Jared Bechthold
+
+#include "integrator.h"
+
+static const float PI_F = 3.14159265f;
+
+//--------------------------------------------------------------
+// Returns the power heuristic weight (exponent 2) of a sample drawn with
+// density pdf against another technique with density otherPdf
+static float powerHeuristic(float pdf, float otherPdf) {
+	float a = pdf * pdf;
+	float b = otherPdf * otherPdf;
+	return a + b > 0 ? a / (a + b) : 0;
+}
+
+//--------------------------------------------------------------
+// Creates the integrator with the given name
+Integrator *createIntegrator(const string &name) {
+	if (name == "whitted") return new WhittedIntegrator();
+	if (name == "path") return new PathIntegrator();
+	return NULL;
+}
+
+//--------------------------------------------------------------
+// Shades the hit and traces the mirrored and refracted rays it spawns,
+// or queues them when the pixel's tile traces them in batches
+glm::vec3 WhittedIntegrator::radiance(RayTracer &rayTracer, const Ray &ray, const HitRecord &hit, const RayDifferential *differential,
+	const glm::vec3 &background, PixelSampler &, vector<SecondaryRay> *deferred, int pixel) const
+{
+	if (!hit.hit()) return background;
+	glm::vec3 color = rayTracer.shade(ray, hit, differential);
+	if (deferred != NULL) {
+		rayTracer.scatter(ray, hit, glm::vec3(1), pixel, 1, *deferred);
+		return color;
+	}
+	// a pixel traced on its own is a batch of one
+	static thread_local vector<SecondaryRay> secondary;
+	rayTracer.scatter(ray, hit, glm::vec3(1), 0, 1, secondary);
+	if (!secondary.empty()) rayTracer.traceSecondary(secondary, &color, background);
+	return color;
+}
+
+//--------------------------------------------------------------
+// Follows the path one bounce at a time. Every bounce draws the same three
+// 2D samples (light sample, lobe choice and roulette, bounce direction),
+// so a dimension of the sampler always means the same thing.
+glm::vec3 PathIntegrator::radiance(RayTracer &rayTracer, const Ray &cameraRay, const HitRecord &cameraHit, const RayDifferential *differential,
+	const glm::vec3 &background, PixelSampler &sampler, vector<SecondaryRay> *, int) const
+{
+	const LightTree &lightTree = rayTracer.lightTree;
+	bool useTree = rayTracer.usesLightTree();
+	glm::vec3 result(0);			// light gathered along the path
+	glm::vec3 throughput(1);		// share of the light at the current vertex that reaches the camera
+	Ray ray = cameraRay;
+	HitRecord hit = cameraHit;
+	float bouncePdf = 0;			// solid angle density of the last bounce (0 for camera rays, mirrors and refractions)
+	glm::vec3 bouncePoint;			// point the last bounce left from
+
+	for (int depth = 0; ; depth++) {
+		// an area or mesh light in front of the hit, weighted against its light samples
+		float lightDistance;
+		glm::vec3 lightNormal;
+		int emitter;
+		if (lightTree.intersect(ray, hit.t, lightDistance, lightNormal, emitter)) {
+			const LightPrimitive &cluster = lightTree.primitives[emitter];
+			const AreaLight &light = rayTracer.areaLightAt(cluster.light);
+			float lightCosine = std::fabs(glm::dot(lightNormal, ray.d));
+			float weight = 1;
+			if (bouncePdf > 0) {
+				// density of the light sample that could have found the same point
+				float areaPdf = useTree ? lightTree.probability(bouncePoint, emitter) / light.clusters[cluster.cluster].area : 1 / light.area;
+				float lightPdf = lightCosine > 0 ? areaPdf * lightDistance * lightDistance / lightCosine : 0;
+				weight = powerHeuristic(bouncePdf, lightPdf);
+			}
+			result += throughput * glm::vec3(PI_F * light.intensity / light.area) * weight;
+			break;
+		}
+		if (!hit.hit()) {
+			result += throughput * background;
+			break;
+		}
+
+		// turn the normal toward the ray; rays leaving a transmissive object refract from ior to 1
+		const Material &material = rayTracer.materials[hit.object->material];
+		glm::vec3 normal = glm::normalize(hit.normal);
+		float cosine = -glm::dot(ray.d, normal);
+		bool entering = cosine >= 0;
+		if (!entering) {
+			normal = -normal;
+			cosine = -cosine;
+		}
+		// shares of the light mirrored, refracted and reflected diffusely (the inside
+		// of a transmissive object is only lit through its surface)
+		float mirrored = material.fresnel(cosine);
+		float refracted = (1 - mirrored) * material.transmission;
+		float diffuse = entering || material.transmission <= 0 ? (1 - mirrored) * (1 - material.transmission) : 0;
+		glm::vec3 refractedDirection;
+		if (refracted > 0) {
+			refractedDirection = glm::refract(ray.d, normal, entering ? 1 / material.ior : material.ior);
+			// total internal reflection mirrors the light that would have been refracted
+			if (glm::dot(refractedDirection, refractedDirection) == 0) {
+				mirrored += refracted;
+				refracted = 0;
+			}
+		}
+		float total = mirrored + refracted + diffuse;
+
+		// surface color, filtered over the pixel footprint at the first hit
+		ofColor objColor;
+		if (depth == 0 && differential != NULL) {
+			glm::vec3 dpdx, dpdy;
+			differential->footprint(hit, dpdx, dpdy);
+			objColor = hit.object->getColor(hit.point, dpdx, dpdy);
+		}
+		else {
+			objColor = hit.object->getColor(hit.point);
+		}
+		glm::vec3 color = linearColor(objColor);
+
+		// next event estimation (draws its sample even when unused to keep the dimensions aligned)
+		if (diffuse > 0) result += throughput * directLight(rayTracer, hit.point, normal, diffuse * color, diffuse / total, sampler);
+		else sampler.next2D();
+		if (depth >= rayTracer.maxRayDepth || total <= 0) break;
+
+		// pick the bounce by the shares of the light, so the weight of each choice is total
+		glm::vec2 choice = sampler.next2D();
+		glm::vec2 u = sampler.next2D();
+		float pick = choice.x * total;
+		glm::vec3 origin, direction;
+		if (pick < diffuse) {
+			glm::vec3 tangent, bitangent;
+			tangentFrame(normal, tangent, bitangent);
+			glm::vec3 local = cosineHemisphere(u);
+			direction = glm::normalize(local.x * tangent + local.y * bitangent + local.z * normal);
+			origin = hit.point + 0.0001f * normal;
+			throughput *= color * total;
+			bouncePdf = (diffuse / total) * local.z / PI_F;
+			bouncePoint = hit.point;
+		}
+		else if (pick < diffuse + mirrored) {
+			direction = glm::reflect(ray.d, normal);
+			// a glossy ray spread below the surface falls back to the mirror direction
+			if (material.gloss > 0) {
+				glm::vec3 spread = spreadDirection(direction, material.gloss, u);
+				if (glm::dot(spread, normal) > 0) direction = spread;
+			}
+			origin = hit.point + 0.0001f * normal;
+			throughput *= linearColor(material.specularColor) * total;
+			bouncePdf = 0;
+		}
+		else {
+			direction = glm::normalize(refractedDirection);
+			if (material.gloss > 0) {
+				glm::vec3 spread = spreadDirection(direction, material.gloss, u);
+				if (glm::dot(spread, normal) < 0) direction = spread;
+			}
+			origin = hit.point - 0.0001f * normal;
+			throughput *= total;
+			bouncePdf = 0;
+		}
+
+		// Russian roulette: paths carrying little light rarely survive, but the survivors carry more
+		if (depth + 1 > rayTracer.rouletteDepth) {
+			float survival = std::min(1.0f, std::max(throughput.x, std::max(throughput.y, throughput.z)));
+			if (choice.y >= survival) break;
+			throughput /= survival;
+		}
+
+		ray = Ray(origin, direction);
+		hit = HitRecord();
+		RT_STAT(pathRays);
+		rayTracer.sceneBVH.intersect(ray, hit);
+	}
+	return result;
+}
+
+//--------------------------------------------------------------
+// Point lights can only be reached by shadow rays, so they get every
+// shadow ray at full weight. Area light samples are weighted against
+// the chance that the diffuse bounce would have found the same point.
+// In scenes of many lights one light is picked from the light tree
+// instead, weighted by one over the chance it was picked with.
+glm::vec3 PathIntegrator::directLight(RayTracer &rayTracer, const glm::vec3 &point, const glm::vec3 &normal, const glm::vec3 &albedo,
+	float diffuseChance, PixelSampler &sampler) const
+{
+	glm::vec3 result(0);
+	glm::vec3 origin = point + 0.0001f * normal;	// point where shadow rays start
+
+	if (rayTracer.usesLightTree()) {
+		glm::vec2 u = sampler.next2D();
+		float probability;
+		int picked = rayTracer.lightTree.pick(point, u.x, probability);
+		if (picked < 0 || probability <= 0) return result;
+		const LightPrimitive &emitter = rayTracer.lightTree.primitives[picked];
+		if (emitter.cluster < 0) {
+			const PointLight &light = rayTracer.lights[emitter.light];
+			glm::vec3 toLight = light.position - point;
+			float distanceSquared = glm::dot(toLight, toLight);
+			float illumination = light.intensity / distanceSquared;
+			if (!(illumination >= rayTracer.lightCutoff) || distanceSquared <= 0) return result;
+			float distance = sqrt(distanceSquared);
+			glm::vec3 direction = toLight / distance;
+			float cosine = glm::dot(normal, direction);
+			if (cosine <= 0 || rayTracer.shadowCheck(Ray(origin, direction), distance, emitter.light)) return result;
+			return albedo * illumination * cosine / probability;
+		}
+		const AreaLight &light = rayTracer.areaLightAt(emitter.light);
+		glm::vec3 lightNormal;
+		glm::vec3 toLight = light.sampleCluster(u, emitter.cluster, &lightNormal) - point;
+		float pdf = probability / light.clusters[emitter.cluster].area;
+		return areaLightSample(rayTracer, light, (int)rayTracer.lights.size() + emitter.light, point, normal, albedo,
+			toLight, lightNormal, pdf, diffuseChance);
+	}
+
+	for (int i = 0; i < (int)rayTracer.lights.size(); i++) {
+		const PointLight &light = rayTracer.lights[i];
+		glm::vec3 toLight = light.position - point;
+		float distanceSquared = glm::dot(toLight, toLight);
+		float illumination = light.intensity / distanceSquared;
+		if (!(illumination >= rayTracer.lightCutoff) || distanceSquared <= 0) continue;
+		float distance = sqrt(distanceSquared);
+		glm::vec3 direction = toLight / distance;
+		float cosine = glm::dot(normal, direction);
+		if (cosine <= 0) continue;
+		// albedo / pi times the light's pi * intensity / distance^2 times the cosine
+		if (!rayTracer.shadowCheck(Ray(origin, direction), distance, i)) result += albedo * illumination * cosine;
+	}
+
+	// one sample of every area light (the same sample, so each light keeps its dimensions)
+	glm::vec2 u = sampler.next2D();
+	for (int i = 0; i < rayTracer.areaLightCount(); i++) {
+		const AreaLight &areaLight = rayTracer.areaLightAt(i);
+		if (areaLight.triangles.empty() || areaLight.area <= 0) continue;
+		if (!(areaLight.intensity >= rayTracer.lightCutoff * areaLight.nearestDistanceSquared(point))) continue;
+		float pdf;
+		glm::vec3 lightNormal;
+		glm::vec3 toLight = areaLight.samplePoint(u, pdf, lightNormal) - point;
+		result += areaLightSample(rayTracer, areaLight, (int)rayTracer.lights.size() + i, point, normal, albedo,
+			toLight, lightNormal, pdf, diffuseChance);
+	}
+	return result;
+}
+
+//--------------------------------------------------------------
+// Turns the area density of the sample into a solid angle density and
+// weighs the sample against the diffuse bounce with the power heuristic
+glm::vec3 PathIntegrator::areaLightSample(RayTracer &rayTracer, const AreaLight &light, int slot, const glm::vec3 &point,
+	const glm::vec3 &normal, const glm::vec3 &albedo, const glm::vec3 &toLight, const glm::vec3 &lightNormal, float pdf,
+	float diffuseChance) const
+{
+	float distanceSquared = glm::dot(toLight, toLight);
+	if (distanceSquared <= 0 || pdf <= 0) return glm::vec3(0);
+	float distance = sqrt(distanceSquared);
+	glm::vec3 direction = toLight / distance;
+	float cosine = glm::dot(normal, direction);
+	float lightCosine = std::fabs(glm::dot(lightNormal, direction));
+	if (cosine <= 0 || lightCosine <= 0) return glm::vec3(0);
+	if (rayTracer.shadowCheck(Ray(point + 0.0001f * normal, direction), distance, slot)) return glm::vec3(0);
+
+	// albedo / pi times the radiance pi * intensity / area times the cosine, over the solid angle density
+	float lightPdf = pdf * distanceSquared / lightCosine;
+	float bouncePdf = diffuseChance * cosine / PI_F;
+	return albedo * (light.intensity / light.area) * cosine / lightPdf * powerHeuristic(lightPdf, bouncePdf);
+}
@@ -0,0 +1,71 @@
+// This file provides the class definitions of Integrator and the
+// integrators of the renderer: the Whitted ray tracer and the path tracer
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "rayTracer.h"
+
+//  Computes the light a camera ray brings to its pixel
+//  An Integrator holds no per-render state, so one instance serves every
+//  render thread; per-sample randomness comes from the PixelSampler.
+//
+class Integrator {
+public:
+	virtual ~Integrator() {}
+
+	// returns the linear radiance arriving along the camera ray, whose closest
+	// hit is hit (hit.hit() is false if it missed the scene). differential sets
+	// the texture footprint of the hit and background is the color of misses.
+	// Integrators whose secondary rays are traced in batches add them to
+	// deferred for pixel when it is given (see RayTracer::traceSecondary)
+	// and trace them before returning otherwise.
+	virtual glm::vec3 radiance(RayTracer &rayTracer, const Ray &ray, const HitRecord &hit, const RayDifferential *differential,
+		const glm::vec3 &background, PixelSampler &sampler, vector<SecondaryRay> *deferred, int pixel) const = 0;
+	// returns the name of the integrator on the command line
+	virtual string name() const = 0;
+};
+
+//  Phong shading of the point lights and the area light at the first hit,
+//  with mirror reflection and refraction by material (see RayTracer::shade
+//  and RayTracer::scatter). Converges in one sample per pixel but has no
+//  indirect light.
+//
+class WhittedIntegrator : public Integrator {
+public:
+	glm::vec3 radiance(RayTracer &rayTracer, const Ray &ray, const HitRecord &hit, const RayDifferential *differential,
+		const glm::vec3 &background, PixelSampler &sampler, vector<SecondaryRay> *deferred, int pixel) const;
+	string name() const { return "whitted"; }
+};
+
+//  Unidirectional path tracer with next event estimation
+//  Surfaces are Lambertian in the share of light their Material does not
+//  mirror or refract. At every diffuse bounce each point light gets a
+//  shadow ray and each area and mesh light one light sample (or, in scenes
+//  of many lights, one light is picked from RayTracer::lightTree); area
+//  lights are also found by the bounce rays, and the two estimates are
+//  combined with multiple importance sampling (power heuristic). Lights emit pi times
+//  their intensity, so a white surface facing a point light is as bright
+//  as with the Whitted integrator. Paths end after RayTracer::maxRayDepth
+//  bounces or, after RayTracer::rouletteDepth, by Russian roulette.
+//
+class PathIntegrator : public Integrator {
+public:
+	glm::vec3 radiance(RayTracer &rayTracer, const Ray &ray, const HitRecord &hit, const RayDifferential *differential,
+		const glm::vec3 &background, PixelSampler &sampler, vector<SecondaryRay> *deferred, int pixel) const;
+	string name() const { return "path"; }
+
+private:
+	// returns the light of the point lights and of one sample per area light that a
+	// Lambertian surface of albedo at point reflects; diffuseChance is the chance
+	// the bounce ray from point is diffuse (for the MIS weight)
+	glm::vec3 directLight(RayTracer &rayTracer, const glm::vec3 &point, const glm::vec3 &normal, const glm::vec3 &albedo,
+		float diffuseChance, PixelSampler &sampler) const;
+	// returns the light reflected at point from the area light sample at point + toLight,
+	// drawn with density pdf per unit area; slot is the light's shadow cache slot
+	glm::vec3 areaLightSample(RayTracer &rayTracer, const AreaLight &light, int slot, const glm::vec3 &point, const glm::vec3 &normal,
+		const glm::vec3 &albedo, const glm::vec3 &toLight, const glm::vec3 &lightNormal, float pdf, float diffuseChance) const;
+};
+
+// returns a new integrator by its command line name ("whitted" or "path"), or NULL
+Integrator *createIntegrator(const string &name);
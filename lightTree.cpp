@@ -0,0 +1,183 @@
+// This file provides the implementation of the LightTree
+// - author: Jared Bechthold
+
+#include "rayTracer.h"
+
+// largest float below 1, so rescaled samples stay in [0, 1)
+static const float ONE_BELOW = 0.99999994f;
+
+//--------------------------------------------------------------
+// Collects the lit emitters, builds a BVH with one emitter per leaf where
+// the SAH allows it, and sums the power of every subtree bottom up (nodes
+// are stored depth first, so children always come after their parent)
+void LightTree::build(const Arena<PointLight, 64> &pointLights, const vector<const AreaLight *> &lights) {
+	primitives.clear();
+	areaLights = lights;
+	bvh.clear();
+	nodePower.clear();
+	parents.clear();
+	primitiveNodes.clear();
+
+	// lights without power can never be picked, so they are left out
+	for (int i = 0; i < (int)pointLights.size(); i++) {
+		const PointLight &light = pointLights[i];
+		if (!(light.intensity > 0)) continue;
+		LightPrimitive emitter;
+		emitter.bounds = AABB(light.position, light.position);
+		emitter.power = light.intensity;
+		emitter.light = i;
+		primitives.push_back(emitter);
+	}
+	for (int a = 0; a < (int)areaLights.size(); a++) {
+		const AreaLight &light = *areaLights[a];
+		if (!(light.intensity > 0) || light.area <= 0) continue;
+		for (int c = 0; c < (int)light.clusters.size(); c++) {
+			LightPrimitive emitter;
+			emitter.bounds = light.clusters[c].bounds;
+			emitter.power = light.intensity * light.clusters[c].area / light.area;
+			emitter.light = a;
+			emitter.cluster = c;
+			if (emitter.power > 0) primitives.push_back(emitter);
+		}
+	}
+	if (primitives.empty()) return;
+
+	vector<AABB> bounds(primitives.size());
+	for (int i = 0; i < (int)primitives.size(); i++) {
+		bounds[i] = primitives[i].bounds;
+	}
+	bvh.build(bounds, 1);
+
+	// power below every node and the leaf of every emitter
+	int nodeCount = (int)bvh.nodes.size();
+	nodePower.assign(nodeCount, 0);
+	primitiveNodes.assign(primitives.size(), -1);
+	for (int n = nodeCount - 1; n >= 0; n--) {
+		const BVHNode &node = bvh.nodes[n];
+		if (node.isLeaf()) {
+			for (int i = node.offset; i < node.offset + node.count; i++) {
+				nodePower[n] += primitives[bvh.primIndices[i]].power;
+				primitiveNodes[bvh.primIndices[i]] = n;
+			}
+		}
+		else {
+			nodePower[n] = nodePower[n + 1] + nodePower[node.offset];
+		}
+	}
+	parents.assign(nodeCount, -1);
+	for (int n = 0; n < nodeCount; n++) {
+		if (bvh.nodes[n].isLeaf()) continue;
+		parents[n + 1] = n;
+		parents[bvh.nodes[n].offset] = n;
+	}
+}
+
+//--------------------------------------------------------------
+// Weighs power by the inverse squared distance to the bounds, like the
+// cluster importance of an area light: the distance is never taken below
+// half the size of the bounds, so a point inside a large node does not
+// send every sample into it
+float LightTree::importance(const glm::vec3 &point, const AABB &bounds, float power) {
+	glm::vec3 nearest = glm::min(glm::max(point, bounds.min), bounds.max);
+	glm::vec3 extent = bounds.max - bounds.min;
+	float distanceSquared = std::max(glm::dot(nearest - point, nearest - point), 0.25f * glm::dot(extent, extent));
+	return power / std::max(distanceSquared, 1e-8f);
+}
+
+//--------------------------------------------------------------
+// Descends from the root, choosing a child by importance with u and
+// keeping the remainder of u for the next choice, then chooses among the
+// emitters of the leaf the same way
+int LightTree::pick(const glm::vec3 &point, float &u, float &probability) const {
+	probability = 0;
+	if (bvh.empty()) return -1;
+	probability = 1;
+	int node = 0;
+	while (!bvh.nodes[node].isLeaf()) {
+		int left = node + 1;
+		int right = bvh.nodes[node].offset;
+		float leftWeight = importance(point, bvh.nodes[left].bounds(), nodePower[left]);
+		float rightWeight = importance(point, bvh.nodes[right].bounds(), nodePower[right]);
+		float total = leftWeight + rightWeight;
+		if (!(total > 0)) {
+			probability = 0;
+			return -1;
+		}
+		float leftChance = leftWeight / total;
+		if (u < leftChance) {
+			u = std::min(u / leftChance, ONE_BELOW);
+			probability *= leftChance;
+			node = left;
+		}
+		else {
+			float rightChance = rightWeight / total;
+			u = std::min((u - leftChance) / rightChance, ONE_BELOW);
+			probability *= rightChance;
+			node = right;
+		}
+	}
+
+	// emitters of the leaf by their own importance
+	const BVHNode &leaf = bvh.nodes[node];
+	float total = 0;
+	for (int i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+		const LightPrimitive &emitter = primitives[bvh.primIndices[i]];
+		total += importance(point, emitter.bounds, emitter.power);
+	}
+	if (!(total > 0)) {
+		probability = 0;
+		return -1;
+	}
+	float target = u * total;
+	float start = 0;
+	for (int i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+		int prim = bvh.primIndices[i];
+		float weight = importance(point, primitives[prim].bounds, primitives[prim].power);
+		if (target < start + weight || i == leaf.offset + leaf.count - 1) {
+			u = weight > 0 ? glm::clamp((target - start) / weight, 0.0f, ONE_BELOW) : 0.5f;
+			probability *= weight / total;
+			return prim;
+		}
+		start += weight;
+	}
+	return -1;
+}
+
+//--------------------------------------------------------------
+// Multiplies the chances of the choices pick() makes on the way to the
+// emitter, walking up from its leaf
+float LightTree::probability(const glm::vec3 &point, int primitive) const {
+	int node = primitiveNodes[primitive];
+	const BVHNode &leaf = bvh.nodes[node];
+	float total = 0;
+	for (int i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+		const LightPrimitive &emitter = primitives[bvh.primIndices[i]];
+		total += importance(point, emitter.bounds, emitter.power);
+	}
+	const LightPrimitive &emitter = primitives[primitive];
+	float result = total > 0 ? importance(point, emitter.bounds, emitter.power) / total : 0;
+	for (int parent = parents[node]; parent >= 0 && result > 0; node = parent, parent = parents[node]) {
+		int sibling = node == parent + 1 ? bvh.nodes[parent].offset : parent + 1;
+		float weight = importance(point, bvh.nodes[node].bounds(), nodePower[node]);
+		float siblingWeight = importance(point, bvh.nodes[sibling].bounds(), nodePower[sibling]);
+		result *= weight + siblingWeight > 0 ? weight / (weight + siblingWeight) : 0;
+	}
+	return result;
+}
+
+//--------------------------------------------------------------
+// Traverses the emitter bounds and tests the triangles of the area light
+// clusters the ray reaches, nearest first
+bool LightTree::intersect(const Ray &ray, float tMax, float &t, glm::vec3 &normal, int &primitive) const {
+	bool found = false;
+	bvh.traverse(ray.p, ray.d, tMax, [&](int prim, float &tFar) {
+		const LightPrimitive &emitter = primitives[prim];
+		if (emitter.cluster >= 0 && areaLights[emitter.light]->intersectCluster(ray, emitter.cluster, tFar, normal)) {
+			primitive = prim;
+			found = true;
+		}
+		return false;
+	});
+	if (found) t = tMax;
+	return found;
+}
@@ -1,8 +1,13 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "renderCli.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char *argv[]){
+	// any command line arguments run the headless batch renderer instead of the window
+	// (see renderCli.h for the options)
+	if (argc > 1) return runRenderCli(argc, argv);
+
 	ofSetupOpenGL(1200,800,OF_WINDOW);			// <-------- setup the GL context
 
 	// this kicks off the running of my app
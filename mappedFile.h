@@ -0,0 +1,38 @@
+// This file provides the class definition of MappedFile, a read-only
+// memory mapping of a whole file
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//  Read-only memory mapped file (mmap on POSIX, MapViewOfFile on Windows)
+//
+class MappedFile {
+public:
+	MappedFile() {}
+	// unmaps the file
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	// maps the whole file; returns false if it cannot be opened or is empty
+	bool open(const std::string &path);
+	// unmaps the file
+	void close();
+
+	// returns the first byte of the mapping (NULL when nothing is mapped)
+	const char *data() const { return bytes; }
+	// returns the size of the mapping in bytes
+	size_t size() const { return length; }
+
+private:
+	const char *bytes = NULL;	// start of the mapping
+	size_t length = 0;			// size of the mapping
+#ifdef _WIN32
+	void *fileHandle = NULL;	// HANDLE of the open file
+	void *mappingHandle = NULL;	// HANDLE of the file mapping
+#endif
+};
@@ -0,0 +1,40 @@
+// This file provides the class definition of Material, the surface
+// response of a SceneObject beyond its diffuse color
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "ofMain.h"
+#include <algorithm>
+
+//  Highlight, mirror reflection and transmission of a surface
+//  Objects refer to their material by its index in RayTracer::materials;
+//  material 0 is the default opaque Phong surface. Light that a surface
+//  mirrors or refracts is taken from its diffuse reflection, so a material
+//  never reflects more light than it receives.
+//
+class Material {
+public:
+	// returns true if the material spawns reflected or refracted rays
+	bool scatters() const { return reflectance > 0 || transmission > 0; }
+
+	// returns the fraction of light mirrored by the surface at an angle whose
+	// cosine to the normal is cosine (Schlick's approximation). Transmissive
+	// materials mirror at least what their index of refraction does.
+	float fresnel(float cosine) const {
+		if (!scatters()) return 0;
+		float r0 = reflectance;
+		if (transmission > 0) {
+			float r = (ior - 1) / (ior + 1);
+			r0 = std::max(r0, r * r);
+		}
+		float m = 1 - std::min(std::max(cosine, 0.0f), 1.0f);
+		return r0 + (1 - r0) * m * m * m * m * m;
+	}
+
+	ofColor specularColor = ofColor::white;	// color of the Phong highlight and the mirror reflection
+	float reflectance = 0;					// fraction of light mirrored at normal incidence
+	float transmission = 0;					// fraction of the unmirrored light refracted into the object
+	float ior = 1.5f;						// index of refraction of the inside (1 outside)
+	float gloss = 0;						// spread of the reflected and refracted rays (0 = sharp)
+};
@@ -0,0 +1,129 @@
+// This file provides the implementation of the Mesh class
+// - author: Jared Bechthold
+
+#include "rayTracer.h"
+#include "watertightRay.h"
+
+//--------------------------------------------------------------
+// Reads the OBJ file, moves the vertices by position and builds the BVH
+bool Mesh::load(string fileName) {
+	verts.clear();
+	triangles.clear();
+	if (!loadObj(fileName, verts, triangles)) return false;
+	sourceFile = fileName;
+	for (glm::vec3 &v : verts) {
+		v += position;
+	}
+	build();
+	return true;
+}
+
+//--------------------------------------------------------------
+// Builds the BVH over the triangles, reorders the triangles to match the
+// leaves and refreshes the mesh used for drawing
+void Mesh::build() {
+	// bounds of every triangle
+	vector<AABB> bounds(triangles.size());
+	for (int i = 0; i < (int)triangles.size(); i++) {
+		for (int k = 0; k < 3; k++) {
+			bounds[i].expand(verts[triangles[i].vertInd[k]]);
+		}
+	}
+	bvh.build(bounds);
+
+	// store the triangles in leaf order so the leaves index them directly
+	vector<Triangle> ordered;
+	ordered.reserve(bvh.primIndices.size());
+	for (int i = 0; i < (int)bvh.primIndices.size(); i++) {
+		ordered.push_back(triangles[bvh.primIndices[i]]);
+		bvh.primIndices[i] = i;
+	}
+	triangles.swap(ordered);
+	updateDrawMesh();
+}
+
+//--------------------------------------------------------------
+// Shifts the vertices and every node of the BVH, which keeps the tree
+// exact without rebuilding it
+void Mesh::translate(const glm::vec3 &delta) {
+	position += delta;
+	for (glm::vec3 &v : verts) {
+		v += delta;
+	}
+	for (BVHNode &node : bvh.nodes) {
+		node.boundsMin += delta;
+		node.boundsMax += delta;
+	}
+	updateDrawMesh();
+}
+
+//--------------------------------------------------------------
+// Copies the triangles into the mesh used for drawing
+void Mesh::updateDrawMesh() {
+	drawMesh.clear();
+	drawMesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	drawMesh.addVertices(verts);
+	for (Triangle &t : triangles) {
+		for (int k = 0; k < 3; k++) {
+			drawMesh.addIndex(t.vertInd[k]);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Finds the closest triangle hit by the ray
+bool Mesh::intersect(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) {
+	HitRecord hit;
+	if (!intersect(ray, std::numeric_limits<float>::infinity(), hit)) return false;
+	point = hit.point;
+	normal = hit.normal;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Stops at the first triangle hit before maxDistance instead of searching
+// for the closest one
+bool Mesh::occluded(const Ray &ray, float maxDistance) const {
+	WatertightRay wray(ray);
+	bool blocked = false;
+	bvh.traverse(ray.p, ray.d, maxDistance, [&](int prim, float &tFar) {
+		const Triangle &tri = triangles[prim];
+		float t;
+		RT_STAT(triangles);
+		blocked = wray.intersect(verts[tri.vertInd[0]], verts[tri.vertInd[1]], verts[tri.vertInd[2]], tFar, t);
+		return blocked;
+	});
+	return blocked;
+}
+
+//--------------------------------------------------------------
+// Finds the closest triangle hit by the ray before tMax. The normal is the
+// face normal, flipped to face the ray origin so shading and shadow offsets
+// work on both sides of open meshes.
+bool Mesh::intersect(const Ray &ray, float tMax, HitRecord &hit) {
+	WatertightRay wray(ray);
+	float closest = tMax;		// distance to the closest triangle so far
+	int closestTriangle = -1;	// index of the closest triangle so far
+
+	bvh.traverse(ray.p, ray.d, closest, [&](int prim, float &tFar) {
+		const Triangle &tri = triangles[prim];
+		float t;
+		RT_STAT(triangles);
+		if (wray.intersect(verts[tri.vertInd[0]], verts[tri.vertInd[1]], verts[tri.vertInd[2]], tFar, t)) {
+			tFar = t;
+			closestTriangle = prim;
+		}
+		return false;
+	});
+	if (closestTriangle < 0) return false;
+
+	// record the hit point and face normal of the closest triangle
+	const Triangle &tri = triangles[closestTriangle];
+	glm::vec3 v0 = verts[tri.vertInd[0]];
+	hit.t = closest;
+	hit.point = ray.p + closest * ray.d;
+	hit.normal = glm::normalize(glm::cross(verts[tri.vertInd[1]] - v0, verts[tri.vertInd[2]] - v0));
+	if (glm::dot(hit.normal, ray.d) > 0) hit.normal = -hit.normal;
+	hit.object = this;
+	return true;
+}
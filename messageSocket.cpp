@@ -0,0 +1,288 @@
+// This file provides the implementation of MessageSocket and ListenSocket
+// - author: Jared Bechthold
+
+#include "messageSocket.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef WSAPOLLFD PollEntry;
+#define pollSockets WSAPoll
+#define closeSocket closesocket
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef struct pollfd PollEntry;
+#define pollSockets poll
+#define closeSocket ::close
+#endif
+
+// flag that keeps send() on a closed connection from raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+// largest payload accepted by receive() (a 4K float framebuffer is 128 MB)
+static const uint32_t MAX_PAYLOAD = 256u << 20;
+
+//--------------------------------------------------------------
+// Starts Winsock once per process (nothing to do elsewhere)
+static bool startSockets() {
+#ifdef _WIN32
+	static bool started = false;
+	if (!started) {
+		WSADATA data;
+		started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}
+	return started;
+#else
+	return true;
+#endif
+}
+
+//--------------------------------------------------------------
+// Sends small messages at once instead of waiting to fill a packet
+static void disableNagle(SocketHandle handle) {
+	int enabled = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char *)&enabled, sizeof(enabled));
+}
+
+//--------------------------------------------------------------
+// Tries every address the host name resolves to until one connects
+bool MessageSocket::connect(const std::string &host, int port, std::string &error) {
+	close();
+	if (!startSockets()) {
+		error = "could not start sockets";
+		return false;
+	}
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo *addresses = NULL;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+		error = "unknown host " + host;
+		return false;
+	}
+	for (struct addrinfo *address = addresses; address != NULL && !open; address = address->ai_next) {
+		SocketHandle s = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+#ifdef _WIN32
+		if (s == INVALID_SOCKET) continue;
+#else
+		if (s < 0) continue;
+#endif
+		if (::connect(s, address->ai_addr, (int)address->ai_addrlen) == 0) {
+			handle = s;
+			open = true;
+		}
+		else {
+			closeSocket(s);
+		}
+	}
+	freeaddrinfo(addresses);
+	if (!open) {
+		error = "could not connect to " + host + ":" + std::to_string(port);
+		return false;
+	}
+	disableNagle(handle);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Writes the header and the payload
+bool MessageSocket::send(uint32_t type, const std::vector<char> &payload) {
+	if (!open) return false;
+	uint32_t header[2] = { type, (uint32_t)payload.size() };
+	if (!writeBytes((const char *)header, sizeof(header)) || !writeBytes(payload.data(), payload.size())) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Reads the header, then exactly the payload length
+bool MessageSocket::receive(uint32_t &type, std::vector<char> &payload, double timeoutSeconds) {
+	if (!open) return false;
+	uint32_t header[2];
+	if (!readBytes((char *)header, sizeof(header), timeoutSeconds) || header[1] > MAX_PAYLOAD) {
+		close();
+		return false;
+	}
+	type = header[0];
+	payload.resize(header[1]);
+	if (!readBytes(payload.data(), payload.size(), timeoutSeconds)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Makes a single recv call for the rest of the header or payload, which does
+// not block on a socket that poll reported readable
+bool MessageSocket::receiveAvailable(uint32_t &type, std::vector<char> &payload) {
+	if (!open) return false;
+	const size_t HEADER = 2 * sizeof(uint32_t);
+	uint32_t header[2] = { 0, 0 };
+	if (partial.size() >= HEADER) memcpy(header, partial.data(), HEADER);
+	size_t size = partial.size() < HEADER ? HEADER : HEADER + header[1];
+	size_t offset = partial.size();
+	partial.resize(size);
+	int received = (int)recv(handle, partial.data() + offset, (int)std::min(size - offset, (size_t)1 << 20), 0);
+	if (received <= 0) {
+		partial.clear();
+		close();
+		return false;
+	}
+	partial.resize(offset + received);
+	if (partial.size() < HEADER) return false;
+	memcpy(header, partial.data(), HEADER);
+	if (header[1] > MAX_PAYLOAD) {
+		partial.clear();
+		close();
+		return false;
+	}
+	if (partial.size() < HEADER + header[1]) return false;
+	type = header[0];
+	payload.assign(partial.begin() + HEADER, partial.end());
+	partial.clear();
+	return true;
+}
+
+//--------------------------------------------------------------
+// Closes the socket if it is open
+void MessageSocket::close() {
+	if (!open) return;
+	closeSocket(handle);
+	open = false;
+}
+
+//--------------------------------------------------------------
+// Calls recv until the buffer is full, giving up when the peer is silent
+// for timeoutSeconds
+bool MessageSocket::readBytes(char *data, size_t size, double timeoutSeconds) {
+	std::vector<SocketHandle> self(1, handle);
+	std::vector<bool> readable;
+	while (size > 0) {
+		if (!waitReadable(self, timeoutSeconds, readable)) return false;
+		int received = (int)recv(handle, data, (int)std::min(size, (size_t)1 << 20), 0);
+		if (received <= 0) return false;
+		data += received;
+		size -= received;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Calls send until every byte is written
+bool MessageSocket::writeBytes(const char *data, size_t size) {
+	while (size > 0) {
+		int sent = (int)::send(handle, data, (int)std::min(size, (size_t)1 << 20), SEND_FLAGS);
+		if (sent <= 0) return false;
+		data += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Polls every socket for input (a closed connection also counts as readable)
+bool MessageSocket::waitReadable(const std::vector<SocketHandle> &sockets, double timeoutSeconds, std::vector<bool> &readable) {
+	std::vector<PollEntry> entries(sockets.size());
+	for (size_t i = 0; i < sockets.size(); i++) {
+		entries[i].fd = sockets[i];
+		entries[i].events = POLLIN;
+		entries[i].revents = 0;
+	}
+	int ready = pollSockets(entries.data(), (unsigned long)entries.size(), (int)(timeoutSeconds * 1000));
+	readable.assign(sockets.size(), false);
+	if (ready <= 0) return false;
+	for (size_t i = 0; i < sockets.size(); i++) {
+		readable[i] = (entries[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Binds an IPv4 socket to the address and port and starts listening
+bool ListenSocket::listen(const std::string &address, int port, std::string &error) {
+	close();
+	if (!startSockets()) {
+		error = "could not start sockets";
+		return false;
+	}
+	struct sockaddr_in bound;
+	memset(&bound, 0, sizeof(bound));
+	bound.sin_family = AF_INET;
+	bound.sin_port = htons((uint16_t)port);
+	if (inet_pton(AF_INET, address.c_str(), &bound.sin_addr) != 1) {
+		error = "bad IPv4 address " + address;
+		return false;
+	}
+	SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#ifdef _WIN32
+	if (s == INVALID_SOCKET) {
+#else
+	if (s < 0) {
+#endif
+		error = "could not create a socket";
+		return false;
+	}
+	// allows restarting the coordinator right away on the same port
+	int enabled = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&enabled, sizeof(enabled));
+
+	socklen_t length = sizeof(bound);
+	if (bind(s, (struct sockaddr *)&bound, sizeof(bound)) != 0 || ::listen(s, 64) != 0 ||
+		getsockname(s, (struct sockaddr *)&bound, &length) != 0) {
+		closeSocket(s);
+		error = "could not listen on " + address + ":" + std::to_string(port);
+		return false;
+	}
+	handle = s;
+	open = true;
+	this->port = ntohs(bound.sin_port);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Accepts one pending connection
+bool ListenSocket::accept(MessageSocket &socket) {
+	if (!open) return false;
+	SocketHandle s = ::accept(handle, NULL, NULL);
+#ifdef _WIN32
+	if (s == INVALID_SOCKET) return false;
+#else
+	if (s < 0) return false;
+#endif
+	socket.close();
+	socket.handle = s;
+	socket.open = true;
+	disableNagle(s);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Closes the socket if it is open
+void ListenSocket::close() {
+	if (!open) return;
+	closeSocket(handle);
+	open = false;
+}
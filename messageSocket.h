@@ -0,0 +1,87 @@
+// This file provides the class definitions of MessageSocket and ListenSocket,
+// the TCP connections used by distributed rendering
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+typedef uintptr_t SocketHandle;
+#else
+typedef int SocketHandle;
+#endif
+
+//  TCP connection that sends and receives whole messages
+//  Every message is a 32 bit type and a 32 bit payload length followed by
+//  the payload. Values are sent in the byte order of the host, so both
+//  ends must have the same endianness (true for all of our render nodes).
+//
+class MessageSocket {
+public:
+	// MessageSocket constructor (not connected)
+	MessageSocket() {}
+	// closes the connection
+	~MessageSocket() { close(); }
+	MessageSocket(const MessageSocket &) = delete;
+	MessageSocket &operator=(const MessageSocket &) = delete;
+
+	// connects to host:port; returns false and sets error on failure
+	bool connect(const std::string &host, int port, std::string &error);
+	// sends one message; returns false if the connection failed
+	bool send(uint32_t type, const std::vector<char> &payload);
+	// blocks until a whole message arrived or timeoutSeconds passed without
+	// any data (a negative timeout waits forever); returns false if the
+	// connection closed, failed or timed out
+	bool receive(uint32_t &type, std::vector<char> &payload, double timeoutSeconds);
+	// reads what already arrived without blocking (call it when waitReadable()
+	// reports the socket) and returns true once a whole message is in. Returns
+	// false while the message is incomplete; isOpen() tells that apart from a
+	// closed or failed connection. Do not mix with receive() on one message.
+	bool receiveAvailable(uint32_t &type, std::vector<char> &payload);
+	// closes the connection
+	void close();
+	// returns true while the socket is connected
+	bool isOpen() const { return open; }
+
+	// waits up to timeoutSeconds until one of the sockets has data to read and
+	// sets readable[i] for each socket that does; returns false on timeout
+	static bool waitReadable(const std::vector<SocketHandle> &sockets, double timeoutSeconds, std::vector<bool> &readable);
+
+	SocketHandle handle = 0;	// operating system socket
+	bool open = false;			// true while connected
+
+private:
+	std::vector<char> partial;	// header and payload bytes of the message receiveAvailable() is reading
+
+	// reads exactly size bytes, waiting at most timeoutSeconds for each chunk
+	bool readBytes(char *data, size_t size, double timeoutSeconds);
+	// writes all size bytes
+	bool writeBytes(const char *data, size_t size);
+};
+
+//  TCP socket that accepts MessageSocket connections on a port
+//
+class ListenSocket {
+public:
+	// closes the socket
+	~ListenSocket() { close(); }
+
+	// listens on port of the IPv4 address (127.0.0.1 accepts this machine only,
+	// 0.0.0.0 every interface; port 0 picks a free port); returns false and sets error on failure
+	bool listen(const std::string &address, int port, std::string &error);
+	// accepts a waiting connection into socket; returns false if none could be accepted
+	bool accept(MessageSocket &socket);
+	// closes the socket
+	void close();
+	// returns the port the socket listens on
+	int getPort() const { return port; }
+
+	SocketHandle handle = 0;	// operating system socket
+	bool open = false;			// true while listening
+
+private:
+	int port = 0;				// port the socket is bound to
+};
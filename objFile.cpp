@@ -0,0 +1,284 @@
+// This file provides the implementation of the OBJ file reader shared by
+// meshes and area lights
+// - author: Jared Bechthold
+
+#include "rayTracer.h"
+#include "mappedFile.h"
+#include "threadPool.h"
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+// bytes of the file per parse task at least, so small files are read on the calling thread
+static const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+//  Part of an OBJ file read by one task: whole lines from begin to end,
+//  what the first pass counted in them, and where their vertices and
+//  triangles go in the shared arrays
+//
+struct ObjChunk {
+	const char *begin = NULL;		// first byte of the chunk (start of a line)
+	const char *end = NULL;			// byte after the chunk (after a newline or the end of the file)
+	size_t vertexCount = 0;			// "v" lines of the chunk
+	size_t triangleCount = 0;		// triangles of the chunk's faces after triangulation
+	size_t lineCount = 0;			// lines of the chunk
+	size_t firstVertex = 0;			// vertices of all chunks before this one
+	size_t firstTriangle = 0;		// triangles of all chunks before this one
+	size_t errorLine = 0;			// line of the chunk (from 1) with the first error, 0 if none
+	string error;					// reason of that error
+};
+
+//--------------------------------------------------------------
+// Returns true for the blanks that separate the tokens of a line
+static inline bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+//--------------------------------------------------------------
+// Moves p past blanks, stopping at the end of the line
+static inline void skipBlanks(const char *&p, const char *end) {
+	while (p < end && isBlank(*p)) p++;
+}
+
+//--------------------------------------------------------------
+// Returns the end of the line starting at p (its newline, or end)
+static inline const char *lineEnd(const char *p, const char *end) {
+	const char *newline = (const char *)memchr(p, '\n', end - p);
+	return newline != NULL ? newline : end;
+}
+
+//--------------------------------------------------------------
+// Counts the vertex references of a face line (the tokens after "f")
+static int countFaceVertices(const char *p, const char *end) {
+	int count = 0;
+	while (true) {
+		skipBlanks(p, end);
+		if (p >= end) return count;
+		count++;
+		while (p < end && !isBlank(*p)) p++;
+	}
+}
+
+//--------------------------------------------------------------
+// Reads a decimal number (optional sign, fraction and exponent) without
+// locale lookups or temporary strings; returns false if p holds none
+static bool parseFloat(const char *&p, const char *end, float &value) {
+	static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	skipBlanks(p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+	// up to 18 significant digits are kept exactly, the rest only shift the exponent
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+		if (mantissa < 100000000000000000ull) mantissa = mantissa * 10 + (*p - '0');
+		else exponent++;
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+			if (mantissa < 100000000000000000ull) {
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+		}
+	}
+	if (digits == 0) return false;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char *start = p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+		int e = 0;
+		if (p >= end || *p < '0' || *p > '9') {
+			// not an exponent after all
+			p = start;
+		}
+		else {
+			for (; p < end && *p >= '0' && *p <= '9'; p++) {
+				if (e < 10000) e = e * 10 + (*p - '0');
+			}
+			exponent += negativeExponent ? -e : e;
+		}
+	}
+
+	double result = (double)mantissa;
+	if (exponent >= 0) result *= exponent <= 22 ? POWERS[exponent] : std::pow(10.0, exponent);
+	else result /= -exponent <= 22 ? POWERS[-exponent] : std::pow(10.0, -exponent);
+	value = (float)(negative ? -result : result);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Reads a signed decimal integer; returns false if p holds none
+static bool parseInt(const char *&p, const char *end, long &value) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+	if (p >= end || *p < '0' || *p > '9') return false;
+	long result = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		if (result < 100000000000L) result = result * 10 + (*p - '0');
+	}
+	value = negative ? -result : result;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns the keyword of the line at p ('v' or 'f' followed by a blank, 0
+// for every other statement) and moves p past it
+static inline char lineKeyword(const char *&p, const char *end) {
+	skipBlanks(p, end);
+	if (end - p >= 2 && (p[0] == 'v' || p[0] == 'f') && isBlank(p[1])) {
+		char keyword = p[0];
+		p += 2;
+		return keyword;
+	}
+	if (end - p == 1 && (p[0] == 'v' || p[0] == 'f')) return *p++;
+	return 0;
+}
+
+//--------------------------------------------------------------
+// First pass: counts the vertices, the triangles of the faces (a polygon
+// of n vertices is n - 2 triangles) and the lines of a chunk
+static void countChunk(ObjChunk &chunk) {
+	for (const char *line = chunk.begin; line < chunk.end; ) {
+		const char *end = lineEnd(line, chunk.end);
+		const char *p = line;
+		char keyword = lineKeyword(p, end);
+		if (keyword == 'v') chunk.vertexCount++;
+		else if (keyword == 'f') chunk.triangleCount += std::max(0, countFaceVertices(p, end) - 2);
+		chunk.lineCount++;
+		line = end + 1;
+	}
+}
+
+//--------------------------------------------------------------
+// Second pass: parses the vertices and faces of a chunk into its slots of
+// the shared arrays. Face indices count from 1, or back from the last
+// vertex defined above the face when negative; only the position index of
+// "v/vt/vn" references is used. Polygons are split into a fan of
+// triangles around their first vertex (exact for convex polygons).
+static void parseChunk(ObjChunk &chunk, size_t totalVertices, glm::vec3 *verts, Triangle *triangles) {
+	size_t vertex = chunk.firstVertex;
+	size_t triangle = chunk.firstTriangle;
+	size_t lineNumber = 0;
+	for (const char *line = chunk.begin; line < chunk.end; ) {
+		const char *end = lineEnd(line, chunk.end);
+		const char *p = line;
+		lineNumber++;
+		char keyword = lineKeyword(p, end);
+		if (keyword == 'v') {
+			float x, y, z;
+			if (!parseFloat(p, end, x) || !parseFloat(p, end, y) || !parseFloat(p, end, z)) {
+				chunk.errorLine = lineNumber;
+				chunk.error = "vertex needs 3 coordinates";
+				return;
+			}
+			verts[vertex++] = glm::vec3(x, y, z);
+		}
+		else if (keyword == 'f') {
+			int first = -1, previous = -1;
+			for (int n = 0; ; n++) {
+				skipBlanks(p, end);
+				if (p >= end) break;
+				long index;
+				if (!parseInt(p, end, index) || index == 0) {
+					chunk.errorLine = lineNumber;
+					chunk.error = "bad face index";
+					return;
+				}
+				// skip the texture and normal indices of the reference
+				while (p < end && !isBlank(*p)) p++;
+				long resolved = index > 0 ? index - 1 : (long)vertex + index;
+				if (resolved < 0 || resolved >= (long)totalVertices) {
+					chunk.errorLine = lineNumber;
+					chunk.error = "face index " + std::to_string(index) + " out of range";
+					return;
+				}
+				if (n == 0) first = (int)resolved;
+				else if (n >= 2) triangles[triangle++] = Triangle(first, previous, (int)resolved);
+				previous = (int)resolved;
+			}
+		}
+		line = end + 1;
+	}
+}
+
+//--------------------------------------------------------------
+// Maps the file and reads it in two parallel passes over chunks of whole
+// lines: the first counts what every chunk holds, which places each chunk's
+// vertices and triangles in arrays allocated once, and the second parses
+// the chunks straight from the mapping into their places
+bool loadObj(const string &fileName, vector<glm::vec3> &verts, vector<Triangle> &triangles, string &error) {
+	verts.clear();
+	triangles.clear();
+	MappedFile file;
+	if (!file.open(fileName)) {
+		error = "cannot open " + fileName;
+		return false;
+	}
+
+	// split the file into chunks that end after a newline
+	const char *data = file.data();
+	const char *fileEnd = data + file.size();
+	int chunkCount = (int)std::min((size_t)WorkStealingPool::hardwareThreads() * 4, file.size() / MIN_CHUNK_BYTES);
+	chunkCount = std::max(chunkCount, 1);
+	vector<ObjChunk> chunks(chunkCount);
+	const char *start = data;
+	for (int c = 0; c < chunkCount; c++) {
+		const char *end = c == chunkCount - 1 ? fileEnd : std::max(start, data + file.size() / chunkCount * (c + 1));
+		if (end < fileEnd) end = lineEnd(end, fileEnd);
+		if (end < fileEnd) end++;
+		chunks[c].begin = start;
+		chunks[c].end = end;
+		start = chunks[c].end;
+	}
+
+	// runs a pass over every chunk, on a pool only if there is more than one
+	std::unique_ptr<WorkStealingPool> pool;
+	if (chunkCount > 1) pool.reset(new WorkStealingPool(std::min(chunkCount, WorkStealingPool::hardwareThreads())));
+	auto runPass = [&](const std::function<void(ObjChunk &)> &pass) {
+		if (!pool) pass(chunks[0]);
+		else pool->run(chunkCount, [&](int task, int /*worker*/) { pass(chunks[task]); });
+	};
+
+	runPass(countChunk);
+	size_t vertexCount = 0, triangleCount = 0;
+	for (ObjChunk &chunk : chunks) {
+		chunk.firstVertex = vertexCount;
+		chunk.firstTriangle = triangleCount;
+		vertexCount += chunk.vertexCount;
+		triangleCount += chunk.triangleCount;
+	}
+	if (vertexCount > (size_t)std::numeric_limits<int>::max()) {
+		error = fileName + ": too many vertices";
+		return false;
+	}
+	verts.resize(vertexCount);
+	triangles.resize(triangleCount);
+	runPass([&](ObjChunk &chunk) { parseChunk(chunk, vertexCount, verts.data(), triangles.data()); });
+
+	// report the first error of the file
+	size_t line = 0;
+	for (const ObjChunk &chunk : chunks) {
+		if (chunk.errorLine > 0) {
+			error = fileName + ":" + std::to_string(line + chunk.errorLine) + ": " + chunk.error;
+			verts.clear();
+			triangles.clear();
+			return false;
+		}
+		line += chunk.lineCount;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Reads the OBJ file and prints the reason when it cannot be read
+bool loadObj(string fileName, vector<glm::vec3> &verts, vector<Triangle> &triangles) {
+	string error;
+	if (loadObj(fileName, verts, triangles, error)) return true;
+	cout << error << endl;
+	return false;
+}
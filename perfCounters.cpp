@@ -0,0 +1,112 @@
+// This file provides the implementation of PerfCounters
+// - author: Jared Bechthold
+
+#include "perfCounters.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//--------------------------------------------------------------
+// Opens one counter of the calling thread on any CPU, stopped, counting
+// user space only (which needs the fewest permissions)
+static int openCounter(uint32_t type, uint64_t config) {
+	perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = type;
+	attributes.config = config;
+	attributes.disabled = 1;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+//--------------------------------------------------------------
+// Returns the config of a read miss event of a hardware cache
+static uint64_t cacheReadMiss(uint64_t cache) {
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+//--------------------------------------------------------------
+// Opens the counters one by one, so a CPU (or virtual machine) without
+// one of the events still provides the others
+bool PerfCounters::open(std::string &error) {
+	close();
+	files[0] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	files[1] = openCounter(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D));
+	files[2] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	files[3] = openCounter(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_DTLB));
+	for (int file : files) {
+		if (file >= 0) return true;
+	}
+	error = std::string("perf counters unavailable (") + strerror(errno) + "); see /proc/sys/kernel/perf_event_paranoid";
+	return false;
+}
+
+//--------------------------------------------------------------
+// Closes the open counters
+void PerfCounters::close() {
+	for (int &file : files) {
+		if (file >= 0) ::close(file);
+		file = -1;
+	}
+}
+
+//--------------------------------------------------------------
+// Zeroes and enables the open counters
+void PerfCounters::start() {
+	for (int file : files) {
+		if (file < 0) continue;
+		ioctl(file, PERF_EVENT_IOC_RESET, 0);
+		ioctl(file, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+//--------------------------------------------------------------
+// Stops every counter before reading any, so the reads are not counted
+PerfCounts PerfCounters::stop() {
+	for (int file : files) {
+		if (file >= 0) ioctl(file, PERF_EVENT_IOC_DISABLE, 0);
+	}
+	long long values[COUNTERS];
+	for (int i = 0; i < COUNTERS; i++) {
+		values[i] = -1;
+		long long value;
+		if (files[i] >= 0 && read(files[i], &value, sizeof(value)) == sizeof(value)) values[i] = value;
+	}
+	PerfCounts counts;
+	counts.instructions = values[0];
+	counts.l1Misses = values[1];
+	counts.cacheMisses = values[2];
+	counts.tlbMisses = values[3];
+	return counts;
+}
+
+#else
+
+//--------------------------------------------------------------
+// Other systems have no perf_event_open
+bool PerfCounters::open(std::string &error) {
+	error = "perf counters need Linux";
+	return false;
+}
+
+//--------------------------------------------------------------
+// Nothing is open
+void PerfCounters::close() {}
+
+//--------------------------------------------------------------
+// Nothing to start
+void PerfCounters::start() {}
+
+//--------------------------------------------------------------
+// Every count is unknown
+PerfCounts PerfCounters::stop() { return PerfCounts(); }
+
+#endif
@@ -0,0 +1,42 @@
+// This file provides the class definition of PerfCounters, which reads the
+// CPU's cache miss and instruction counters around a piece of code
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <string>
+
+//  Counts of one measurement; counters the CPU or the system does not
+//  provide are -1
+//
+struct PerfCounts {
+	long long instructions = -1;	// instructions retired
+	long long l1Misses = -1;		// level 1 data cache read misses
+	long long cacheMisses = -1;		// last level cache misses (memory accesses)
+	long long tlbMisses = -1;		// data TLB read misses
+};
+
+//  Hardware counters of the calling thread, read through perf_event_open
+//  Only Linux provides them, and only if perf_event_paranoid allows user
+//  space measurements (2 or lower) or the process may use perf; everywhere
+//  else open() fails and the counts stay -1. Work done on other threads is
+//  not counted, so measure single threaded code.
+//
+class PerfCounters {
+public:
+	// closes the counters
+	~PerfCounters() { close(); }
+
+	// opens every counter the CPU provides; returns false and sets error if none
+	bool open(std::string &error);
+	// closes the counters
+	void close();
+	// zeroes and starts the counters
+	void start();
+	// stops the counters and returns their counts since start()
+	PerfCounts stop();
+
+private:
+	static const int COUNTERS = 4;	// instructions, L1 misses, cache misses and TLB misses
+	int files[COUNTERS] = { -1, -1, -1, -1 };	// file descriptor of each counter (-1 if not open)
+};
@@ -0,0 +1,1554 @@
+// This file provides the implementation of the scene classes and the RayTracer
+// - author: Jared Bechthold
+// - starter files containing Plane::intersect and ViewPlane::toWorld
+// methods provided by Professor Kevin Smith
+
+#include "rayTracer.h"
+#include "integrator.h"
+#include "sceneFile.h"
+#include <cassert>
+#include <chrono>
+
+// Intersect Ray with Plane  (wrapper on glm::intersect*)
+// returns a boolean variable denoting if intersection occurred inside Plane
+bool Plane::intersect(const Ray &ray, glm::vec3 & point, glm::vec3 & normalAtIntersect) {
+	HitRecord hit;
+	if (!intersect(ray, std::numeric_limits<float>::infinity(), hit)) return false;
+	point = hit.point;
+	normalAtIntersect = hit.normal;
+	return true;
+}
+
+// Intersect Ray with Plane closer than tMax (same test as glm::intersectRayPlane)
+// and records the distance, point and normal of the intersection
+bool Plane::intersect(const Ray &ray, float tMax, HitRecord &hit) {
+	// rays parallel to the plane never hit it
+	float denom = glm::dot(ray.d, this->normal);
+	if (glm::abs(denom) <= std::numeric_limits<float>::epsilon()) return false;
+	// measures distance along the ray
+	float dist = glm::dot(position - ray.p, this->normal) / denom;
+	if (dist <= 0 || dist >= tMax) return false;
+	// determines if intersection point was within range of the Plane's dimensions
+	glm::vec3 point = ray.p + dist * ray.d;
+	if (point.x < position.x + width / 2 && point.x > position.x - width / 2 &&
+		point.z < position.z + height / 2 && point.z > position.z - height / 2) {
+		hit.t = dist;
+		hit.point = point;
+		hit.normal = this->normal;
+		hit.object = this;
+		return true;
+	}
+	return false;
+}
+
+// Maps the texture onto Planes facing up, sampling the full resolution
+// level (used where no pixel footprint is known)
+ofColor Plane::getColor(glm::vec3 intersectPt) {
+	// only Planes orthogonal to the positive y axis are textured
+	if (!textureApplied || normal != glm::vec3(0, 1, 0)) return diffuseColor;
+	glm::vec2 uv = textureCoordinates(intersectPt);
+	glm::vec3 color = texture.sample(uv.x, uv.y, textureFilter == TEXTURE_NEAREST ? TEXTURE_NEAREST : TEXTURE_BILINEAR);
+	return ofColor(color.x, color.y, color.z);
+}
+
+// Maps the texture onto Planes facing up, choosing the mip level from the
+// size of the pixel footprint in texture space
+ofColor Plane::getColor(const glm::vec3 &point, const glm::vec3 &dpdx, const glm::vec3 &dpdy) {
+	// only Planes orthogonal to the positive y axis are textured
+	if (!textureApplied || normal != glm::vec3(0, 1, 0)) return diffuseColor;
+	glm::vec2 uv = textureCoordinates(point);
+	// texture coordinates per world unit along x and z
+	glm::vec2 scale(tilesX / width, tilesY / height);
+	float lod = texture.levelOfDetail(glm::vec2(dpdx.x, dpdx.z) * scale, glm::vec2(dpdy.x, dpdy.z) * scale);
+	glm::vec3 color = texture.sample(uv.x, uv.y, textureFilter, lod);
+	return ofColor(color.x, color.y, color.z);
+}
+
+// Returns the bounds of the Plane. Only Planes facing up are limited in
+// all three axes; other orientations are only limited in x and z by intersect
+AABB Plane::getBounds() {
+	glm::vec3 min = glm::vec3(position.x - width / 2, position.y, position.z - height / 2);
+	glm::vec3 max = glm::vec3(position.x + width / 2, position.y, position.z + height / 2);
+	if (normal == glm::vec3(0, 1, 0)) {
+		// give the box a little thickness so rays parallel to the slab still hit it
+		min.y -= 0.0001;
+		max.y += 0.0001;
+	}
+	else {
+		min.y = -std::numeric_limits<float>::infinity();
+		max.y = std::numeric_limits<float>::infinity();
+	}
+	return AABB(min, max);
+}
+
+// Convert (u, v) to (x, y, z) 
+// We assume u,v is in [0, 1]
+//
+glm::vec3 ViewPlane::toWorld(float u, float v) {
+	float w = width();
+	float h = height();
+	return (glm::vec3((u * w) + min.x, (v * h) + min.y, position.z));
+}
+
+// Builds the image window on the focus plane: the ViewPlane window (as
+// seen from position, scaled to the focus distance) without a fov, else a
+// window of the fov and aspect centered on the view direction
+void RenderCam::frame(float aspect, glm::vec3 &corner, glm::vec3 &horizontal, glm::vec3 &vertical) const {
+	if (fov <= 0) {
+		float distance = position.z - view.position.z;
+		float scale = focusDistance > 0 && distance != 0 ? focusDistance / fabs(distance) : 1;
+		corner = scale * glm::vec3(view.min.x - position.x, view.min.y - position.y, -distance);
+		horizontal = scale * glm::vec3(view.width(), 0, 0);
+		vertical = scale * glm::vec3(0, view.height(), 0);
+		return;
+	}
+	// orthonormal basis looking from position at aim (any side direction if up is parallel to it)
+	glm::vec3 forward = aim - position;
+	forward = glm::length(forward) > 0 ? glm::normalize(forward) : glm::vec3(0, 0, -1);
+	glm::vec3 right = glm::cross(forward, up);
+	if (glm::length(right) < 1e-6f) right = glm::cross(forward, fabs(forward.y) < 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0));
+	right = glm::normalize(right);
+	glm::vec3 imageUp = glm::cross(right, forward);
+
+	float distance = focusDistance > 0 ? focusDistance : glm::length(aim - position);
+	if (distance <= 0) distance = 1;
+	float halfHeight = distance * tan(glm::radians(fov) / 2);
+	float halfWidth = halfHeight * aspect;
+	corner = distance * forward - halfWidth * right - halfHeight * imageUp;
+	horizontal = 2 * halfWidth * right;
+	vertical = 2 * halfHeight * imageUp;
+}
+
+// Divides the image window into pixels and the lens radius along its axes
+void RenderCam::prepare(int width, int height) {
+	imageWidth = std::max(width, 1);
+	imageHeight = std::max(height, 1);
+	glm::vec3 horizontal, vertical;
+	frame((float)imageWidth / imageHeight, lowerLeft, horizontal, vertical);
+	pixelDx = horizontal / (float)imageWidth;
+	pixelDy = vertical / (float)imageHeight;
+	float radius = std::max(aperture, 0.0f) / 2;
+	lensU = glm::length(horizontal) > 0 ? radius * glm::normalize(horizontal) : glm::vec3(0);
+	lensV = glm::length(vertical) > 0 ? radius * glm::normalize(vertical) : glm::vec3(0);
+}
+
+// Starts at the center of the tile's first pixel and adds one block step
+// per row and per column
+void RenderCam::tileOffsets(const Tile &tile, int step, vector<glm::vec3> &offsets) const {
+	offsets.clear();
+	glm::vec3 columnStep = (float)step * pixelDx;
+	glm::vec3 rowStep = (float)step * pixelDy;
+	glm::vec3 column = focusOffset(tile.x0 + 0.5f, tile.y0 + 0.5f);
+	for (int i = tile.x0; i < tile.x1; i += step) {
+		glm::vec3 offset = column;
+		for (int j = tile.y0; j < tile.y1; j += step) {
+			offsets.push_back(offset);
+			offset += rowStep;
+		}
+		column += columnStep;
+	}
+}
+
+// Get a ray from a point of the lens (the camera position for a pinhole
+// camera) through the focus plane point at offset from position
+Ray RenderCam::getRay(const glm::vec3 &offset, glm::vec2 lens) const {
+	if (aperture <= 0) return Ray(position, glm::normalize(offset));
+	glm::vec2 disk = concentricDisk(lens);
+	glm::vec3 origin = position + disk.x * lensU + disk.y * lensV;
+	return Ray(origin, glm::normalize(position + offset - origin));
+}
+
+// Outlines the image window and connects its corners to the camera
+void RenderCam::drawFrustum(float aspect) const {
+	glm::vec3 corner, horizontal, vertical;
+	frame(aspect, corner, horizontal, vertical);
+	glm::vec3 corners[4] = { position + corner, position + corner + horizontal,
+		position + corner + horizontal + vertical, position + corner + vertical };
+	for (int k = 0; k < 4; k++) {
+		ofDrawLine(corners[k], corners[(k + 1) % 4]);
+		ofDrawLine(position, corners[k]);
+	}
+}
+
+// Intersects the neighboring rays with the plane through the hit point
+// that is orthogonal to the hit normal
+void RayDifferential::footprint(const HitRecord &hit, glm::vec3 &dpdx, glm::vec3 &dpdy) const {
+	const Ray *rays[2] = { &dx, &dy };
+	glm::vec3 *offsets[2] = { &dpdx, &dpdy };
+	for (int k = 0; k < 2; k++) {
+		float denominator = glm::dot(rays[k]->d, hit.normal);
+		// neighbor rays parallel to the surface give no footprint
+		if (fabs(denominator) < 1e-8f) {
+			*offsets[k] = glm::vec3(0);
+			continue;
+		}
+		float t = glm::dot(hit.point - rays[k]->p, hit.normal) / denominator;
+		*offsets[k] = rays[k]->p + t * rays[k]->d - hit.point;
+	}
+}
+
+// Updates position of area light vertices to move by position
+// of area light
+void AreaLight::updatePosition() {
+	for (int i = 0; i < verts.size(); i++) {
+		verts[i] = glm::vec3(verts[i].x + position.x, verts[i].y + position.y, verts[i].z + position.z);
+	}
+}
+
+// Moves the vertices and the sampling clusters; the triangle areas do not change
+void AreaLight::translate(const glm::vec3 &delta) {
+	position += delta;
+	for (glm::vec3 &v : verts) {
+		v += delta;
+	}
+	for (LightCluster &cluster : clusters) {
+		cluster.bounds = AABB(cluster.bounds.min + delta, cluster.bounds.max + delta);
+	}
+}
+
+// Default closest-hit test for objects that only implement
+// intersect(ray, point, normal)
+bool SceneObject::intersect(const Ray &ray, float tMax, HitRecord &hit) {
+	glm::vec3 point, normal;
+	if (!intersect(ray, point, normal)) return false;
+	float t = glm::dot(point - ray.p, ray.d);
+	if (t >= tMax) return false;
+	hit.t = t;
+	hit.point = point;
+	hit.normal = normal;
+	hit.object = this;
+	return true;
+}
+
+// Intersect Ray with Sphere closer than tMax (same test as glm::intersectRaySphere)
+// and records the distance, point and normal of the intersection
+bool Sphere::intersect(const Ray &ray, float tMax, HitRecord &hit) {
+	glm::vec3 diff = position - ray.p;
+	// distance along the ray to the point closest to the center
+	float t0 = glm::dot(diff, ray.d);
+	// squared distance from the center to the ray
+	float dSquared = glm::dot(diff, diff) - t0 * t0;
+	float rSquared = radius * radius;
+	if (dSquared > rSquared) return false;
+	// half the length of the chord through the sphere
+	float t1 = sqrt(rSquared - dSquared);
+	float t = t0 > t1 + std::numeric_limits<float>::epsilon() ? t0 - t1 : t0 + t1;
+	if (t <= std::numeric_limits<float>::epsilon() || t >= tMax) return false;
+	hit.t = t;
+	hit.point = ray.p + t * ray.d;
+	hit.normal = (hit.point - position) / radius;
+	hit.object = this;
+	return true;
+}
+
+// Copies a sphere into a lane of a packet
+static void setSphereLane(SpherePacket &packet, int lane, const Sphere *sphere, int index) {
+	packet.centerX[lane] = sphere->position.x;
+	packet.centerY[lane] = sphere->position.y;
+	packet.centerZ[lane] = sphere->position.z;
+	packet.radiusSquared[lane] = sphere->radius * sphere->radius;
+	packet.object[lane] = index;
+}
+
+// Copies a plane into a lane of a packet
+static void setPlaneLane(PlanePacket &packet, int lane, const Plane *plane, int index) {
+	packet.centerX[lane] = plane->position.x;
+	packet.centerY[lane] = plane->position.y;
+	packet.centerZ[lane] = plane->position.z;
+	packet.normalX[lane] = plane->normal.x;
+	packet.normalY[lane] = plane->normal.y;
+	packet.normalZ[lane] = plane->normal.z;
+	packet.halfWidth[lane] = plane->width / 2;
+	packet.halfHeight[lane] = plane->height / 2;
+	packet.object[lane] = index;
+}
+
+// Returns the total surface area of the nodes, the part of the SAH cost
+// that changes when objects move
+static float nodeCost(const BVH &bvh) {
+	float cost = 0;
+	for (const BVHNode &node : bvh.nodes) {
+		cost += node.bounds().surfaceArea();
+	}
+	return cost;
+}
+
+// Builds the hierarchy over every object with finite bounds, keeps the
+// remaining objects in the unbounded lists and sorts the objects of every
+// leaf by type: spheres and planes into SIMD packets, meshes into a list
+void SceneBVH::build(const vector<SceneObject *> &sceneObjects) {
+	static std::atomic<unsigned long> builds{ 0 };
+	buildId = ++builds;
+	sourceObjects = sceneObjects;
+	objects.clear();
+	unboundedPlanes.clear();
+	unbounded.clear();
+	leaves.clear();
+	spherePackets.clear();
+	planePackets.clear();
+	meshes.clear();
+	others.clear();
+
+	vector<AABB> bounds;
+	for (SceneObject *object : sceneObjects) {
+		AABB box = object->getBounds();
+		if (box.isFinite()) {
+			objects.push_back(object);
+			bounds.push_back(box);
+		}
+		else if (!box.isEmpty()) {
+			if (object->type == OBJECT_PLANE) unboundedPlanes.push_back(static_cast<Plane *>(object));
+			else unbounded.push_back(object);
+		}
+	}
+	bvh.build(bounds, PACKET_WIDTH);
+
+	// sort the objects of every leaf into packets by type
+	leaves.resize(bvh.nodes.size());
+	for (int n = 0; n < (int)bvh.nodes.size(); n++) {
+		const BVHNode &node = bvh.nodes[n];
+		if (!node.isLeaf()) continue;
+		SceneLeaf &leaf = leaves[n];
+		leaf.firstSpherePacket = (int)spherePackets.size();
+		leaf.firstPlanePacket = (int)planePackets.size();
+		leaf.firstMesh = (int)meshes.size();
+		leaf.firstOther = (int)others.size();
+		int sphereLanes = 0, planeLanes = 0;	// lanes used in the leaf's last packets
+		for (int i = node.offset; i < node.offset + node.count; i++) {
+			int index = bvh.primIndices[i];
+			SceneObject *object = objects[index];
+			switch (object->type) {
+			case OBJECT_SPHERE:
+				if (sphereLanes % PACKET_WIDTH == 0) {
+					spherePackets.emplace_back();
+					spherePackets.back().clear();
+				}
+				setSphereLane(spherePackets.back(), sphereLanes++ % PACKET_WIDTH, static_cast<Sphere *>(object), index);
+				break;
+			case OBJECT_PLANE:
+				if (planeLanes % PACKET_WIDTH == 0) {
+					planePackets.emplace_back();
+					planePackets.back().clear();
+				}
+				setPlaneLane(planePackets.back(), planeLanes++ % PACKET_WIDTH, static_cast<Plane *>(object), index);
+				break;
+			case OBJECT_MESH:
+				meshes.push_back(static_cast<Mesh *>(object));
+				break;
+			default:
+				others.push_back(object);
+				break;
+			}
+		}
+		leaf.spherePacketCount = (int)spherePackets.size() - leaf.firstSpherePacket;
+		leaf.planePacketCount = (int)planePackets.size() - leaf.firstPlanePacket;
+		leaf.meshCount = (int)meshes.size() - leaf.firstMesh;
+		leaf.otherCount = (int)others.size() - leaf.firstOther;
+	}
+	builtCost = nodeCost(bvh);
+}
+
+// Recomputes the bounds from the leaves up (children are stored after
+// their parent, so a backwards pass visits children first) and copies the
+// current sphere and plane data into their packet lanes
+bool SceneBVH::refit(const vector<SceneObject *> &sceneObjects) {
+	if (sceneObjects != sourceObjects) return false;
+	vector<AABB> bounds(objects.size());
+	for (size_t i = 0; i < objects.size(); i++) {
+		bounds[i] = objects[i]->getBounds();
+		if (!bounds[i].isFinite()) return false;
+	}
+	for (int n = (int)bvh.nodes.size() - 1; n >= 0; n--) {
+		BVHNode &node = bvh.nodes[n];
+		AABB box;
+		if (node.isLeaf()) {
+			for (int i = node.offset; i < node.offset + node.count; i++) {
+				box.expand(bounds[bvh.primIndices[i]]);
+			}
+		}
+		else {
+			box.expand(bvh.nodes[n + 1].bounds());
+			box.expand(bvh.nodes[node.offset].bounds());
+		}
+		node.boundsMin = box.min;
+		node.boundsMax = box.max;
+	}
+	for (SpherePacket &packet : spherePackets) {
+		for (int lane = 0; lane < PACKET_WIDTH; lane++) {
+			if (packet.object[lane] >= 0) setSphereLane(packet, lane, static_cast<Sphere *>(objects[packet.object[lane]]), packet.object[lane]);
+		}
+	}
+	for (PlanePacket &packet : planePackets) {
+		for (int lane = 0; lane < PACKET_WIDTH; lane++) {
+			if (packet.object[lane] >= 0) setPlaneLane(packet, lane, static_cast<Plane *>(objects[packet.object[lane]]), packet.object[lane]);
+		}
+	}
+	// objects that moved far apart leave large overlapping nodes behind
+	return nodeCost(bvh) <= 2 * builtCost;
+}
+
+// Tests the packets, meshes and other objects of one leaf against the ray
+// (the meshes are called directly, not through the virtual intersect())
+bool SceneBVH::intersectLeaf(const SceneLeaf &leaf, const Ray &ray, float &tMax, HitRecord &hit, bool anyHit) const {
+	float t;	// distance returned by the kernels
+	for (int p = leaf.firstSpherePacket; p < leaf.firstSpherePacket + leaf.spherePacketCount; p++) {
+		const SpherePacket &packet = spherePackets[p];
+		RT_STAT(spherePackets);
+		int lane = kernels->spheres(packet, ray.p, ray.d, tMax, t);
+		if (lane < 0) continue;
+		assert(packet.object[lane] >= 0 && "padded sphere lane hit");
+		Sphere *sphere = static_cast<Sphere *>(objects[packet.object[lane]]);
+		hit.object = sphere;
+		if (anyHit) return true;
+		tMax = t;
+		hit.t = t;
+		hit.point = ray.p + t * ray.d;
+		hit.normal = (hit.point - sphere->position) / sphere->radius;
+	}
+	for (int p = leaf.firstPlanePacket; p < leaf.firstPlanePacket + leaf.planePacketCount; p++) {
+		const PlanePacket &packet = planePackets[p];
+		RT_STAT(planePackets);
+		int lane = kernels->planes(packet, ray.p, ray.d, tMax, t);
+		if (lane < 0) continue;
+		hit.object = objects[packet.object[lane]];
+		if (anyHit) return true;
+		tMax = t;
+		hit.t = t;
+		hit.point = ray.p + t * ray.d;
+		hit.normal = glm::vec3(packet.normalX[lane], packet.normalY[lane], packet.normalZ[lane]);
+	}
+	for (int i = leaf.firstMesh; i < leaf.firstMesh + leaf.meshCount; i++) {
+		if (anyHit && meshes[i]->occluded(ray, tMax)) {
+			hit.object = meshes[i];
+			return true;
+		}
+		if (!anyHit && meshes[i]->Mesh::intersect(ray, tMax, hit)) tMax = hit.t;
+	}
+	for (int i = leaf.firstOther; i < leaf.firstOther + leaf.otherCount; i++) {
+		RT_STAT(otherObjects);
+		if (others[i]->intersect(ray, tMax, hit)) {
+			if (anyHit) return true;
+			tMax = hit.t;
+		}
+	}
+	return false;
+}
+
+// Finds the closest intersection of the ray among all objects, starting
+// with hit.t as the farthest distance of interest
+bool SceneBVH::intersect(const Ray &ray, HitRecord &hit) const {
+	RT_STAT_ADD(otherObjects, unboundedPlanes.size() + unbounded.size());
+	for (Plane *plane : unboundedPlanes) {
+		plane->Plane::intersect(ray, hit.t, hit);
+	}
+	for (SceneObject *candidate : unbounded) {
+		candidate->intersect(ray, hit.t, hit);
+	}
+	float tMax = hit.t;
+	bvh.traverseLeaves(ray.p, ray.d, tMax, [&](int node, float &tFar) {
+		return intersectLeaf(leaves[node], ray, tFar, hit, false);
+	});
+	return hit.hit();
+}
+
+// Returns true if any object is hit before maxDistance, stopping at the first such hit
+bool SceneBVH::occluded(const Ray &ray, float maxDistance, SceneObject *&occluder) const {
+	occluder = NULL;
+	HitRecord hit;	// scratch record for the objects being tested
+	RT_STAT_ADD(otherObjects, unboundedPlanes.size() + unbounded.size());
+	for (Plane *plane : unboundedPlanes) {
+		if (plane->Plane::intersect(ray, maxDistance, hit)) {
+			occluder = plane;
+			return true;
+		}
+	}
+	for (SceneObject *candidate : unbounded) {
+		if (candidate->intersect(ray, maxDistance, hit)) {
+			occluder = candidate;
+			return true;
+		}
+	}
+	bool blocked = false;
+	float tMax = maxDistance;
+	bvh.traverseLeaves(ray.p, ray.d, tMax, [&](int node, float &tFar) {
+		blocked = intersectLeaf(leaves[node], ray, tFar, hit, true);
+		return blocked;
+	});
+	if (blocked) occluder = hit.object;
+	return blocked;
+}
+
+// Tests a single object, e.g. the cached occluder of a shadow ray
+bool SceneBVH::occludedBy(SceneObject *object, const Ray &ray, float maxDistance) {
+	HitRecord hit;	// scratch record for the object being tested
+	if (object->type != OBJECT_MESH) RT_STAT(otherObjects);
+	switch (object->type) {
+	case OBJECT_SPHERE: return static_cast<Sphere *>(object)->Sphere::intersect(ray, maxDistance, hit);
+	case OBJECT_PLANE: return static_cast<Plane *>(object)->Plane::intersect(ray, maxDistance, hit);
+	case OBJECT_MESH: return static_cast<Mesh *>(object)->occluded(ray, maxDistance);
+	default: return object->intersect(ray, maxDistance, hit);
+	}
+}
+
+//--------------------------------------------------------------
+// Renders with the Whitted integrator until another one is set
+RayTracer::RayTracer() : integrator(new WhittedIntegrator()) {
+}
+
+//--------------------------------------------------------------
+// Stops a background render before the scene is destroyed
+RayTracer::~RayTracer() {
+	cancelRender();
+}
+
+//--------------------------------------------------------------
+// Builds the default scene of the app
+void RayTracer::setupDefaultScene(string textureFile) {
+	// set plane to be used as floor
+	floor = addPlane(glm::vec3(0, -2, 0), glm::vec3(0, 1, 0), ofColor::grey);
+
+	// add SceneObject instances to the scene
+	addSphere(glm::vec3(3, 1, -5), 2.0, ofColor::green);
+	addSphere(glm::vec3(-3, -1, 2), 1.0, ofColor::red);
+	addSphere(glm::vec3(0, 1, 0), 2.0, ofColor::blue);
+
+	// add Light instances to the scene
+	// lights test scene 1
+	addLight(glm::vec3(-4, 1, 4), 100, 0.1);
+	addLight(glm::vec3(-5, 5, 2), 100, 0.1);
+	addLight(glm::vec3(3, 5, -2), 100, 0.1);
+
+	// lights test scene 2
+	//addLight(glm::vec3(0, 8, 0), 100, 0.1);
+	//addLight(glm::vec3(-6, 7, 4), 100, 0.1);
+	//addLight(glm::vec3(8, 8, 4), 100, 0.1);
+
+	// lights test scene 3
+	//addLight(glm::vec3 (5, 2, 0), 100, 0.1);
+	//addLight(glm::vec3 (0, 2, 7), 100, 0.1);
+
+	// Instantiates AreaLight instance
+	areaLight = AreaLight(glm::vec3(0, 9, 2), 100);
+
+	// initializes the planeTexture ofImage instance (pixels only, it is sampled on the CPU)
+	planeTexture.setUseTexture(false);
+	planeTexture.allocate(textureWidth, textureHeight, ofImageType::OF_IMAGE_COLOR);
+	planeTexture.load(textureFile);
+	floor->textureFile = textureFile;
+	//planeTexture.load("textureImg2.jpg");
+	//planeTexture.load("textureImg3.jpg");
+	floor->applyTexture(planeTexture);			// applies planeTexture to floor
+	// set tile sizes of texture
+	//floor->setTiles(20, 25);
+	//floor->setTiles(15, 15);
+	//floor->setTiles(30, 35);
+
+	// initializes the image ofImage instance to be drawn by rayTrace method
+	setImageSize(imageWidth, imageHeight);
+}
+
+//--------------------------------------------------------------
+// Allocates the image for the given resolution. The image keeps no GL
+// texture so it can be written without a window.
+void RayTracer::setImageSize(int width, int height) {
+	imageWidth = width;
+	imageHeight = height;
+	framebuffer.allocate(imageWidth, imageHeight);
+}
+
+//--------------------------------------------------------------
+// Sets the intensity of the point lights and the area light
+void RayTracer::setLightIntensities(float pointIntensity, float areaIntensity) {
+	for (int i = 0; i < lights.size(); i++) {
+		lights[i].setIntensity(pointIntensity);
+	}
+	areaLight.setIntensity(areaIntensity);
+}
+
+//--------------------------------------------------------------
+// Frees the scene so a new one can be built
+void RayTracer::clearScene() {
+	scene.clear();
+	spheres.clear();
+	planes.clear();
+	meshes.clear();
+	materials.assign(1, Material());
+	lights.clear();
+	floor = NULL;
+	areaLight = AreaLight();
+	areaLightFile.clear();
+	meshLights.clear();
+	lightTree = LightTree();
+	sceneBVH = SceneBVH();
+	animation.clear();
+	sceneGeneration++;
+}
+
+//--------------------------------------------------------------
+// Loads a scene file, through its binary cache when it is up to date
+bool RayTracer::loadScene(string fileName) {
+	// the file is read into a separate tracer, so a file that fails halfway
+	// leaves this scene untouched; settings the file omits keep their values
+	RayTracer loaded;
+	loaded.renderCam = renderCam;
+	loaded.background = background;
+	loaded.phongPower = phongPower;
+	loaded.imageWidth = imageWidth;
+	loaded.imageHeight = imageHeight;
+	string error;
+	if (!SceneFile::load(fileName, loaded, error)) {
+		cout << "Scene load failed: " << error << endl;
+		return false;
+	}
+	// the old scene is freed along with loaded
+	swapScene(loaded);
+	sceneGeneration++;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Exchanges the scene with other's; the light tree and BVH point into the
+// old scene, so both are emptied and rebuilt by the next render
+void RayTracer::swapScene(RayTracer &other) {
+	std::swap(scene, other.scene);
+	spheres.swap(other.spheres);
+	planes.swap(other.planes);
+	meshes.swap(other.meshes);
+	std::swap(materials, other.materials);
+	std::swap(floor, other.floor);
+	lights.swap(other.lights);
+	std::swap(areaLight, other.areaLight);
+	std::swap(areaLightFile, other.areaLightFile);
+	meshLights.swap(other.meshLights);
+	std::swap(animation, other.animation);
+	std::swap(renderCam, other.renderCam);
+	std::swap(background, other.background);
+	std::swap(phongPower, other.phongPower);
+	lightTree = LightTree();
+	sceneBVH = SceneBVH();
+	other.lightTree = LightTree();
+	other.sceneBVH = SceneBVH();
+	std::swap(imageWidth, other.imageWidth);
+	std::swap(imageHeight, other.imageHeight);
+	std::swap(framebuffer, other.framebuffer);
+}
+
+//--------------------------------------------------------------
+// uses file io to update area light with verts and triangles
+// of passed in obj file
+bool RayTracer::loadAreaLight(string fileName) {
+	// Clear verts and triangles vectors
+	areaLight.verts.clear();
+	areaLight.triangles.clear();
+	sceneGeneration++;
+
+	// Read the obj file into the area light
+	if (!loadObj(fileName, areaLight.verts, areaLight.triangles)) return false;
+	areaLightFile = fileName;
+
+	// Updates location of triangle verticies relative to area light position
+	areaLight.updatePosition();
+	// Prepares the triangles for sampling
+	areaLight.buildSampling();
+
+	// Print Area Light diagnostic information
+	cout << "Number of Vertices: " << areaLight.verts.size() << endl;
+	cout << "Total Number of Faces: " << areaLight.triangles.size() << endl;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Creates a Sphere in its arena and appends it to the scene
+Sphere *RayTracer::addSphere(glm::vec3 position, float radius, ofColor color) {
+	Sphere *sphere = spheres.create(position, radius, color);
+	scene.push_back(sphere);
+	return sphere;
+}
+
+//--------------------------------------------------------------
+// Creates a Plane in its arena and appends it to the scene
+Plane *RayTracer::addPlane(glm::vec3 position, glm::vec3 normal, ofColor color, float width, float height) {
+	Plane *plane = planes.create(position, normal, color, width, height);
+	scene.push_back(plane);
+	return plane;
+}
+
+//--------------------------------------------------------------
+// Creates an empty Mesh in its arena and appends it to the scene
+Mesh *RayTracer::addMesh(glm::vec3 position, ofColor color) {
+	Mesh *mesh = meshes.create(position, color);
+	scene.push_back(mesh);
+	return mesh;
+}
+
+//--------------------------------------------------------------
+// Loads the Mesh in place in its arena, so its vertices and BVH are never
+// copied, and only appends it to the scene once the file was read
+Mesh *RayTracer::addMesh(const string &fileName, glm::vec3 position, ofColor color) {
+	Mesh *mesh = meshes.create(position, color);
+	if (!mesh->load(fileName)) {
+		meshes.removeLast();
+		return NULL;
+	}
+	scene.push_back(mesh);
+	return mesh;
+}
+
+//--------------------------------------------------------------
+// Appends a Material to the scene's materials
+int RayTracer::addMaterial(const Material &material) {
+	materials.push_back(material);
+	return (int)materials.size() - 1;
+}
+
+//--------------------------------------------------------------
+// Creates a PointLight in its arena
+PointLight *RayTracer::addLight(glm::vec3 position, float intensity, float radius, ofColor color) {
+	return lights.create(position, intensity, radius, color);
+}
+
+//--------------------------------------------------------------
+// Loads the mesh light in place in its arena, moved to position and
+// prepared for sampling like the area light
+AreaLight *RayTracer::addMeshLight(const string &fileName, glm::vec3 position, float intensity) {
+	AreaLight *light = meshLights.create(position, intensity);
+	if (!loadObj(fileName, light->verts, light->triangles)) {
+		meshLights.removeLast();
+		return NULL;
+	}
+	light->updatePosition();
+	light->buildSampling();
+	return light;
+}
+
+//--------------------------------------------------------------
+// loads an obj file as a Mesh at the given position and adds it to the scene
+bool RayTracer::loadMesh(string fileName, glm::vec3 position, ofColor color) {
+	sceneGeneration++;
+	Mesh *mesh = addMesh(fileName, position, color);
+	if (mesh == NULL) return false;
+
+	// Print Mesh diagnostic information
+	cout << "Mesh Vertices: " << mesh->verts.size() << endl;
+	cout << "Mesh Faces: " << mesh->triangles.size() << endl;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Renders the whole image in a single full resolution pass (its tiles run
+// on the tileRenderer's thread pool) and waits until every tile is done; a
+// background render is cancelled first. Then saves the image, and the
+// profile if writeProfile is set, to outputPath.
+void RayTracer::rayTrace()
+{
+	cancelRender();
+	renderPasses(1);
+
+	// save changes to the image
+	saveImage(outputPath);
+	if (writeProfile) saveProfile(outputPath);
+}
+
+//--------------------------------------------------------------
+// Renders either way the image can be made, so the two can be compared
+bool RayTracer::renderImage(bool progressive)
+{
+	cancelRender();
+	return renderPasses(progressive ? 1 << (PROGRESSIVE_PASSES - 1) : 1);
+}
+
+//--------------------------------------------------------------
+// Renders the progressive passes on a background thread so the caller
+// (the GUI) can keep drawing the image while it fills in
+void RayTracer::startRender()
+{
+	cancelRender();
+	rendering = true;
+	renderThread = std::thread([this]() {
+		if (renderPasses(1 << (PROGRESSIVE_PASSES - 1))) {
+			saveImage(outputPath);
+			if (writeProfile) saveProfile(outputPath);
+			cout << "done" << endl;
+		}
+		else {
+			cout << "render cancelled" << endl;
+		}
+		rendering = false;
+	});
+}
+
+//--------------------------------------------------------------
+// Asks the tiles of the running render to stop and joins its thread
+void RayTracer::cancelRender()
+{
+	cancelRequested = true;
+	if (renderThread.joinable()) renderThread.join();
+	cancelRequested = false;
+}
+
+//--------------------------------------------------------------
+// Tonemaps the framebuffer under the frame lock so no tile is half written
+void RayTracer::copyFrame(ofPixels &pixels)
+{
+	std::lock_guard<std::mutex> lock(frameMutex);
+	framebuffer.toPixels(pixels, toneMap);
+}
+
+//--------------------------------------------------------------
+// Tonemaps the framebuffer into an image file, or writes its linear
+// colors for .pfm and .exr files
+bool RayTracer::saveImage(const string &path)
+{
+	std::lock_guard<std::mutex> lock(frameMutex);
+	if (!framebuffer.save(path, toneMap)) {
+		cout << "could not save " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// The heatmap is always a PNG, whatever the format of the image
+void RayTracer::saveProfile(const string &imagePath)
+{
+	if (!RENDER_STATS) return;
+	profile.printSummary(cout);
+	string heatmapPath = RenderProfile::siblingPath(imagePath, "_cost.png");
+	string tracePath = RenderProfile::siblingPath(imagePath, "_trace.json");
+	// each file reports on its own, so one failing write does not hide the other
+	cout << (profile.saveHeatmap(heatmapPath) ? "wrote " : "could not save ") << heatmapPath << endl;
+	cout << (profile.saveTrace(tracePath) ? "wrote " : "could not save ") << tracePath << endl;
+}
+
+//--------------------------------------------------------------
+// Builds the acceleration structure and renders the passes from firstStep
+// down to a full resolution pass, followed by the adaptive antialiasing
+// pass when maxPixelSamples > 1, stopping early when cancelled. With
+// useGBuffer, a render whose G-buffer key matches the last complete
+// render only re-shades its G-buffer in place of the passes. With
+// RT_STATS every tile is timed into the profile.
+bool RayTracer::renderPasses(int firstStep)
+{
+	static const char *PASS_NAMES[] = { "pass 1", "pass 2", "pass 3", "pass 4", "pass 5", "pass 6", "pass 7", "pass 8" };
+	renderPass = 0;
+	profile.start(imageWidth, imageHeight);
+	bool record = useGBuffer && integrator->name() == "whitted";
+	uint64_t key = record ? gBufferKey() : 0;
+	if (record && gBuffer.matches(key, imageWidth, imageHeight)) {
+		// the objects did not move, so the acceleration structure of the last render still
+		// holds for the shadow rays the G-buffer lacks; only the light powers changed
+		buildLightTree();
+		renderCam.prepare(imageWidth, imageHeight);
+		tileRenderer.setThreadCount(renderThreads);
+		tileRenderer.setDeterministic(deterministicRender);
+		tileRenderer.setOrder(pixelOrder);
+		renderPass = PROGRESSIVE_PASSES;
+		tileRenderer.render(imageWidth, imageHeight, [&](const Tile &tile, int worker) {
+			if (!cancelRequested) profile.timeTile(tile, worker, "reshade", [&]() { reshadeTile(tile, background); });
+		});
+		if (cancelRequested) return false;
+	}
+	else {
+		// build the acceleration structure over the current scene and render all tiles of each pass
+		prepareRender();
+		if (record) gBuffer.allocate(imageWidth, imageHeight, (int)lights.size(), areaLightCount());
+		else gBuffer.clear();
+		for (int step = firstStep; step >= 1; step /= 2) {
+			renderPass++;
+			bool refine = step < firstStep;
+			const char *pass = PASS_NAMES[std::min((int)renderPass, 8) - 1];
+			tileRenderer.render(imageWidth, imageHeight, [&](const Tile &tile, int worker) {
+				if (!cancelRequested) profile.timeTile(tile, worker, pass, [&]() { renderTile(tile, background, step, refine); });
+			});
+			// a partly recorded G-buffer is of no use
+			if (cancelRequested) {
+				gBuffer.clear();
+				return false;
+			}
+		}
+		if (record) gBuffer.finish(key);
+	}
+	if (maxPixelSamples <= 1) {
+		profile.finish();
+		return true;
+	}
+
+	// the contrast of every tile is measured on a snapshot of the one sample
+	// image, so tiles refined first do not change the decisions of the others
+	renderPass++;
+	snapshotLuminance(Tile(0, 0, imageWidth, imageHeight));
+	adaptivePixels = 0;
+	adaptiveSamples = 0;
+	tileRenderer.render(imageWidth, imageHeight, [&](const Tile &tile, int worker) {
+		if (!cancelRequested) profile.timeTile(tile, worker, "antialiasing", [&]() { renderAdaptiveTile(tile, background, luminanceSnapshot); });
+	});
+	if (cancelRequested) return false;
+	profile.finish();
+	long pixels = (long)imageWidth * imageHeight;
+	cout << "antialiasing refined " << adaptivePixels << " of " << pixels << " pixels, "
+		<< (double)(pixels + adaptiveSamples) / pixels << " samples per pixel on average" << endl;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Builds the acceleration structure and applies the thread settings
+void RayTracer::prepareRender()
+{
+	if (!refitBVH || !sceneBVH.refit(scene)) sceneBVH.build(scene);
+	buildLightTree();
+	renderCam.prepare(imageWidth, imageHeight);
+	tileRenderer.setThreadCount(renderThreads);
+	tileRenderer.setDeterministic(deterministicRender);
+	tileRenderer.setOrder(pixelOrder);
+}
+
+//--------------------------------------------------------------
+// Rebuilds the light tree every render, since lights may have moved
+void RayTracer::buildLightTree()
+{
+	vector<const AreaLight *> areaLights;
+	for (int i = 0; i < areaLightCount(); i++) {
+		areaLights.push_back(&areaLightAt(i));
+	}
+	lightTree.build(lights, areaLights);
+}
+
+//--------------------------------------------------------------
+// Renders the region at full resolution with a one pixel border, so the
+// antialiasing pass sees the same neighborhoods as in a whole image
+// render, then refines the pixels of the region
+void RayTracer::renderRegion(const Tile &region)
+{
+	Tile border(std::max(region.x0 - 1, 0), std::max(region.y0 - 1, 0),
+		std::min(region.x1 + 1, imageWidth), std::min(region.y1 + 1, imageHeight));
+	tileRenderer.render(maxPixelSamples > 1 ? border : region, [&](const Tile &tile, int /*worker*/) {
+		renderTile(tile, background);
+	});
+	if (maxPixelSamples <= 1) return;
+	snapshotLuminance(border);
+	tileRenderer.render(region, [&](const Tile &tile, int /*worker*/) {
+		renderAdaptiveTile(tile, background, luminanceSnapshot);
+	});
+}
+
+//--------------------------------------------------------------
+// Stores the luminance of the area's pixels (y grows up) in the snapshot,
+// which is indexed by framebuffer rows from the top
+void RayTracer::snapshotLuminance(const Tile &area)
+{
+	luminanceSnapshot.resize((size_t)imageWidth * imageHeight);
+	for (int row = imageHeight - area.y1; row < imageHeight - area.y0; row++) {
+		for (int x = area.x0; x < area.x1; x++) {
+			luminanceSnapshot[(size_t)row * imageWidth + x] = luminance(framebuffer.getPixel(x, row));
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Returns the lens sample of a pixel's center sample, scattered over the
+// lens by a hash of the pixel; the antialiasing samples are rotated by it
+static glm::vec2 pixelLens(int x, int y) {
+	uint32_t hash = hashUint((uint32_t)x ^ hashUint((uint32_t)y + 0x9e3779b9u));
+	return glm::vec2((hash & 0xffff) / 65536.0f, (hash >> 16) / 65536.0f);
+}
+
+//--------------------------------------------------------------
+// Traces the camera ray through a point of the focus plane and hands its
+// closest hit to the integrator
+glm::vec3 RayTracer::tracePixel(const glm::vec3 &offset, glm::vec2 lens, float footprint, const glm::vec3 &backgroundColor,
+	PixelSampler &sampler, vector<SecondaryRay> *deferred, int pixel)
+{
+	RT_STAT(primaryRays);
+	Ray ray = renderCam.getRay(offset, lens);
+	// find the closest SceneObject hit by the ray in a single pass
+	HitRecord hit;
+	if (!sceneBVH.intersect(ray, hit)) return integrator->radiance(*this, ray, hit, NULL, backgroundColor, sampler, deferred, pixel);
+	// the neighbors are one footprint away so textures are filtered over it
+	RayDifferential differential = renderCam.getRayDifferential(ray, offset, footprint);
+	return integrator->radiance(*this, ray, hit, &differential, backgroundColor, sampler, deferred, pixel);
+}
+
+//--------------------------------------------------------------
+// Iterates through the pixels of the given tile and draws a color at
+// each pixel given by the closest SceneObject viewed by the RenderCam
+// at that position. The pixels are visited along pixelOrder, so
+// consecutive camera and shadow rays start close together and touch the
+// same BVH nodes and texels. The reflections and refractions of all pixels
+// of the tile are traced together after the primary rays, so every bounce
+// is a batch of rays sorted by material and direction. All per-ray state is local so tiles
+// can be rendered concurrently; the finished tile is copied to the image
+// under the frame lock so the preview never shows a torn tile.
+void RayTracer::renderTile(const Tile &tile, const ofColor &background, int step, bool refine)
+{
+	glm::vec3 backgroundColor = linearColor(background);
+	int tileWidth = tile.x1 - tile.x0;
+	int firstRow = imageHeight - tile.y1;		// top image row of the tile (v grows up, rows grow down)
+	vector<glm::vec3> colors(tile.pixelCount());	// colors of the tile, row by row from the top
+	static thread_local vector<glm::vec3> offsets;	// focus plane offsets of the shaded pixels
+	static thread_local vector<glm::vec3> shaded;	// linear colors of the shaded pixels, in offset order
+	static thread_local vector<SecondaryRay> secondary;	// reflected and refracted rays of the tile
+	static thread_local vector<float> costs;		// seconds spent on the shaded pixels, in offset order (RT_STATS)
+	static thread_local CurveOrder curve;			// visiting order of the shaded pixels
+	PixelSampler sampler(samplerType);				// samples of the integrator
+	renderCam.tileOffsets(tile, step, offsets);
+	shaded.resize(offsets.size());
+	secondary.clear();
+	if (RENDER_STATS) costs.assign(offsets.size(), 0);
+	int rows = (tile.y1 - tile.y0 + step - 1) / step;	// shaded pixels per column
+	const vector<int> &order = curve.cells((tile.x1 - tile.x0 + step - 1) / step, rows, pixelOrder);
+
+	// for each shaded pixel in the tile (one per step x step block); k indexes the
+	// offsets, which are listed column by column whatever the order
+	for (int n = 0; n < (int)order.size(); n++) {
+		// stop every few pixels when the render is cancelled
+		if (n % 32 == 0 && cancelRequested) return;
+		int k = order[n];
+		int i = tile.x0 + k / rows * step;
+		int j = tile.y0 + k % rows * step;
+		if (refine && (i - tile.x0) % (2 * step) == 0 && (j - tile.y0) % (2 * step) == 0) {
+			// pixel was already shaded exactly by the previous pass
+			shaded[k] = framebuffer.getPixel(i, imageHeight - 1 - j);
+		}
+		else {
+			// shade the pixel center as the full resolution pass would, since later passes
+			// keep it; only its block fill is coarse
+			double begin = statClock();
+			sampler.start(i, j, 0);
+			if (gBuffer.recording()) shaded[k] = recordPixel(offsets[k], pixelLens(i, j), 1, backgroundColor, i, j, &secondary, k);
+			else shaded[k] = tracePixel(offsets[k], pixelLens(i, j), 1, backgroundColor, sampler, &secondary, k);
+			if (RENDER_STATS) costs[k] += (float)(statClock() - begin);
+		}
+	}
+	if (!secondary.empty()) traceSecondary(secondary, shaded.data(), backgroundColor, RENDER_STATS ? costs.data() : NULL);
+
+	// fill the block of each shaded pixel with its color (the cost goes to the shaded pixel)
+	int k = 0;
+	for (int i = tile.x0; i < tile.x1; i += step) {
+		for (int j = tile.y0; j < tile.y1; j += step, k++) {
+			if (RENDER_STATS) profile.addPixelCost(i, imageHeight - 1 - j, costs[k]);
+			for (int x = i; x < std::min(i + step, tile.x1); x++) {
+				for (int y = j; y < std::min(j + step, tile.y1); y++) {
+					colors[(imageHeight - 1 - y - firstRow) * tileWidth + (x - tile.x0)] = shaded[k];
+				}
+			}
+		}
+	}
+
+	// writes the rows of the tile to the framebuffer
+	std::lock_guard<std::mutex> lock(frameMutex);
+	for (int row = 0; row < tile.y1 - tile.y0; row++) {
+		framebuffer.setRow(firstRow + row, tile.x0, &colors[row * tileWidth], tileWidth);
+	}
+	frameVersion++;
+}
+
+//--------------------------------------------------------------
+// Finds the tile pixels on edges or in noisy regions from the contrast of
+// their neighborhood, then adds samples to each of them in batches at
+// Halton positions (evenly spread however early sampling stops) until the
+// standard error of the pixel's luminance is small relative to its
+// brightness. The pixel center sample of the full resolution pass stays in
+// the framebuffer and counts as the first sample.
+void RayTracer::renderAdaptiveTile(const Tile &tile, const ofColor &background, const vector<float> &luminance)
+{
+	const int BATCH = 4;					// samples taken between two noise estimates
+	const float DARK = 0.02f;				// keeps contrast and noise in near black pixels from counting
+	glm::vec3 backgroundColor = linearColor(background);
+	int tileWidth = tile.x1 - tile.x0;
+	int firstRow = imageHeight - tile.y1;		// top image row of the tile
+	int extraSamples = maxPixelSamples - 1;		// samples a pixel can get on top of its center sample
+	float footprint = 1.0f / sqrt((float)maxPixelSamples);	// spacing of the samples for texture filtering
+	vector<glm::vec4> samples(tile.pixelCount(), glm::vec4(0));	// added samples, row by row from the top
+	PixelSampler sampler(samplerType);			// samples of the integrator
+	long pixels = 0;
+	long sampleCount = 0;
+
+	for (int row = firstRow; row < firstRow + (tile.y1 - tile.y0); row++) {
+		// stop between rows when the render is cancelled
+		if (cancelRequested) return;
+		for (int x = tile.x0; x < tile.x1; x++) {
+			// contrast of the 3x3 neighborhood in the one sample image
+			float minimum = luminance[(size_t)row * imageWidth + x];
+			float maximum = minimum;
+			for (int ny = std::max(row - 1, 0); ny <= std::min(row + 1, imageHeight - 1); ny++) {
+				for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, imageWidth - 1); nx++) {
+					float l = luminance[(size_t)ny * imageWidth + nx];
+					minimum = std::min(minimum, l);
+					maximum = std::max(maximum, l);
+				}
+			}
+			if ((maximum - minimum) / (maximum + minimum + DARK) <= aaThreshold) continue;
+			double begin = statClock();
+
+			// running mean and squared deviations of the luminance (Welford), starting with the center sample
+			int n = 1;
+			float mean = luminance[(size_t)row * imageWidth + x];
+			float m2 = 0;
+			// rotates the sample set per pixel so neighbors do not share a pattern
+			uint32_t hash = hashUint((uint32_t)(row * imageWidth + x));
+			glm::vec2 rotation((hash & 0xffff) / 65536.0f, (hash >> 16) / 65536.0f);
+			glm::vec4 &sum = samples[(row - firstRow) * tileWidth + (x - tile.x0)];
+			int y = imageHeight - 1 - row;
+			// lens points continue the center sample's (sequence point 0) in bases 5 and 7
+			glm::vec2 lensRotation = pixelLens(x, y);
+			for (int k = 0; k < extraSamples; k++) {
+				glm::vec2 offset = halton(k);
+				glm::vec2 lens(wrapSample(radicalInverse(k + 1, 5) + lensRotation.x), wrapSample(radicalInverse(k + 1, 7) + lensRotation.y));
+				sampler.start(x, y, k + 1);
+				glm::vec3 color = tracePixel(renderCam.focusOffset(x + wrapSample(offset.x + rotation.x), y + wrapSample(offset.y + rotation.y)),
+					lens, footprint, backgroundColor, sampler);
+				sum += glm::vec4(color, 1);
+				n++;
+				float l = ::luminance(color);
+				float delta = l - mean;
+				mean += delta / n;
+				m2 += delta * (l - mean);
+				// stop once the standard error of the mean is below the threshold
+				if (n % BATCH == 1 && sqrt(m2 / (n - 1) / n) <= aaThreshold * (mean + DARK)) break;
+			}
+			pixels++;
+			sampleCount += n - 1;
+			if (RENDER_STATS) profile.addPixelCost(x, row, (float)(statClock() - begin));
+		}
+	}
+
+	// adds the samples of the tile to the framebuffer
+	std::lock_guard<std::mutex> lock(frameMutex);
+	for (int row = 0; row < tile.y1 - tile.y0; row++) {
+		framebuffer.addSamples(firstRow + row, tile.x0, &samples[row * tileWidth], tileWidth);
+	}
+	adaptivePixels += pixels;
+	adaptiveSamples += sampleCount;
+	frameVersion++;
+}
+
+//--------------------------------------------------------------
+// Shades the closest hit of a ray with the point lights and the area light
+// (the direct light only; see scatter() for reflections and refractions)
+glm::vec3 RayTracer::shade(const Ray &ray, const HitRecord &hit, const RayDifferential *differential)
+{
+	// assign color of closest object to objColor (use texture for plane if applied,
+	// filtered over the pixel footprint when it is known)
+	ofColor objColor;
+	if (differential != NULL) {
+		glm::vec3 dpdx, dpdy;
+		differential->footprint(hit, dpdx, dpdy);
+		objColor = hit.object->getColor(hit.point, dpdx, dpdy);
+	}
+	else {
+		objColor = hit.object->getColor(hit.point);
+	}
+	return shadeSurface(ray, hit, linearColor(objColor));
+}
+
+//--------------------------------------------------------------
+// Lights the surface color of a hit by its material, from every light or
+// from the lights picked by the light tree
+glm::vec3 RayTracer::shadeSurface(const Ray &ray, const HitRecord &hit, glm::vec3 diffuse, LightVisibility *visibility)
+{
+	const Material &material = materials[hit.object->material];
+	glm::vec3 specular = linearColor(material.specularColor);
+	if (material.scatters()) {
+		// the inside of a transmissive object is only lit through its surface
+		float cosine = -glm::dot(ray.d, glm::normalize(hit.normal));
+		if (material.transmission > 0 && cosine < 0) return glm::vec3(0);
+		// light that is mirrored or refracted is not reflected diffusely
+		diffuse *= (1 - material.fresnel(std::fabs(cosine))) * (1 - material.transmission);
+	}
+
+	// Shades the current pixel with ambient and lambert shading
+	//return lambert(ray, hit.point, hit.normal, diffuse);
+	// Shades the current pixel from a few lights picked by importance in scenes of many lights
+	if (usesLightTree()) return phongLightTree(ray, hit.point, hit.normal, diffuse, specular, phongPower, visibility);
+	// Shades the current pixel with ambient, lambert and phong shading
+	glm::vec3 color = phong(ray, hit.point, hit.normal, diffuse, specular, phongPower, visibility);
+	// Shades the current pixel with ambient, lambert and phong shading using the area and mesh lights
+	color += phongAreaLight(ray, hit.point, hit.normal, diffuse, specular, phongPower, visibility);
+	return color;
+}
+
+//--------------------------------------------------------------
+// Splits the light leaving the hit toward the ray between a mirrored and a
+// refracted ray by the Fresnel term of the material. The samples for
+// glossy spread and Russian roulette come from a hash of the hit, so
+// renders are reproducible on any number of threads.
+void RayTracer::scatter(const Ray &ray, const HitRecord &hit, const glm::vec3 &weight, int pixel, int depth, vector<SecondaryRay> &rays)
+{
+	if (depth > maxRayDepth) return;
+	const Material &material = materials[hit.object->material];
+	if (!material.scatters()) return;
+
+	// turn the normal toward the ray; rays leaving a transmissive object refract from ior to 1
+	glm::vec3 normal = glm::normalize(hit.normal);
+	float cosine = -glm::dot(ray.d, normal);
+	bool entering = cosine >= 0;
+	if (!entering) {
+		normal = -normal;
+		cosine = -cosine;
+	}
+	float mirrored = material.fresnel(cosine);
+	float refracted = (1 - mirrored) * material.transmission;
+	glm::vec3 refractedDirection;
+	if (refracted > 0) {
+		refractedDirection = glm::refract(ray.d, normal, entering ? 1 / material.ior : material.ior);
+		// total internal reflection mirrors the light that would have been refracted
+		if (glm::dot(refractedDirection, refractedDirection) == 0) {
+			mirrored += refracted;
+			refracted = 0;
+		}
+	}
+	glm::vec3 mirrorWeight = weight * mirrored * linearColor(material.specularColor);
+	glm::vec3 refractWeight = weight * refracted;
+
+	// Russian roulette: rays carrying little light rarely survive, but the survivors carry more
+	glm::vec2 u = hashPoint(hit.point);
+	if (depth > rouletteDepth) {
+		glm::vec3 total = mirrorWeight + refractWeight;
+		float survival = std::min(1.0f, std::max(total.x, std::max(total.y, total.z)));
+		float roulette = wrapSample(u.x + u.y + radicalInverse2((uint32_t)depth));
+		if (roulette >= survival) return;
+		mirrorWeight /= survival;
+		refractWeight /= survival;
+	}
+
+	int batch = 2 * hit.object->material;
+	if (mirrored > 0 && mirrorWeight != glm::vec3(0)) {
+		glm::vec3 direction = glm::reflect(ray.d, normal);
+		// a glossy ray spread below the surface falls back to the mirror direction
+		if (material.gloss > 0) {
+			glm::vec3 spread = spreadDirection(direction, material.gloss, u);
+			if (glm::dot(spread, normal) > 0) direction = spread;
+		}
+		rays.push_back({ Ray(hit.point + 0.0001f * normal, direction), mirrorWeight, pixel, batch });
+	}
+	if (refracted > 0) {
+		glm::vec3 direction = glm::normalize(refractedDirection);
+		if (material.gloss > 0) {
+			glm::vec3 spread = spreadDirection(direction, material.gloss, glm::vec2(u.y, u.x));
+			if (glm::dot(spread, normal) < 0) direction = spread;
+		}
+		rays.push_back({ Ray(hit.point - 0.0001f * normal, direction), refractWeight, pixel, batch + 1 });
+	}
+}
+
+//--------------------------------------------------------------
+// Returns the octant of a direction (one bit per negative component)
+static inline int directionOctant(const glm::vec3 &d) {
+	return (d.x < 0) | ((d.y < 0) << 1) | ((d.z < 0) << 2);
+}
+
+//--------------------------------------------------------------
+// Traces the secondary rays one bounce at a time. Each bounce is sorted
+// by the material that spawned the rays and then by the octant of their
+// direction (stable, so pixels keep their order along the tile's curve),
+// so the rays of a packet start on the same surfaces, head the same way
+// through the BVH (same near child at every node) and shade with the
+// same material.
+void RayTracer::traceSecondary(vector<SecondaryRay> &rays, glm::vec3 *colors, const glm::vec3 &backgroundColor, float *costs)
+{
+	static thread_local vector<SecondaryRay> next;	// rays of the next bounce
+	for (int depth = 1; !rays.empty(); depth++) {
+		std::stable_sort(rays.begin(), rays.end(), [](const SecondaryRay &a, const SecondaryRay &b) {
+			if (a.batch != b.batch) return a.batch < b.batch;
+			return directionOctant(a.ray.d) < directionOctant(b.ray.d);
+		});
+		next.clear();
+		for (const SecondaryRay &secondary : rays) {
+			RT_STAT(secondaryRays);
+			double begin = costs != NULL ? statClock() : 0;
+			HitRecord hit;
+			if (!sceneBVH.intersect(secondary.ray, hit)) {
+				colors[secondary.pixel] += secondary.weight * backgroundColor;
+			}
+			else {
+				colors[secondary.pixel] += secondary.weight * shade(secondary.ray, hit);
+				scatter(secondary.ray, hit, secondary.weight, secondary.pixel, depth + 1, next);
+			}
+			if (costs != NULL) costs[secondary.pixel] += (float)(statClock() - begin);
+		}
+		rays.swap(next);
+	}
+	next.clear();
+}
+
+//--------------------------------------------------------------
+// Adds lambert shading to given pixel in the scene
+glm::vec3 RayTracer::lambert(Ray ray, const glm::vec3 & point, const glm::vec3 & normal, const glm::vec3 & diffuse)
+{
+	// Sets ambient shading
+	glm::vec3 result = 0.25f * diffuse;			// ambient shading value to not make image completely dark
+	// Variables used in checking for shadows
+	glm::vec3 norm = glm::normalize(normal);	// normal at point
+	glm::vec3 shadowRayPt = point + 0.0001f * norm;	// point where shadow rays start (+ small value towards normal)
+	// Variables used in calculating the light
+	glm::vec3 directionToLight;					// vector from point to light
+	float illumination;							// light intensity/(distance to light)^2
+	float dotProdNormLight;						// dot product of norm vector and directionToLight vector
+
+
+	// iterates through all lights
+	for (int i = 0; i < lights.size(); i++) {
+		// Gets the distance and the illumination from source, skipping lights too dim to matter
+		glm::vec3 toLight = lights[i].position - point;
+		float distanceSquared = glm::dot(toLight, toLight);
+		illumination = lights[i].intensity / distanceSquared;
+		if (!(illumination >= lightCutoff) || distanceSquared <= 0) continue;
+		float distance = sqrt(distanceSquared);
+		// Sets direction of ray pointing to light from intersection point on SceneObject
+		directionToLight = toLight / distance;
+		// Gets dot product of normal and directionToLight vectors, skipping lights behind the surface
+		dotProdNormLight = glm::dot(norm, directionToLight);
+		if (dotProdNormLight <= 0) continue;
+
+		// Only adds lambert shading to result if point is not blocked from current light
+		if (!shadowCheck(Ray(shadowRayPt, directionToLight), distance, i)) {
+			// Adds lambert shaded color to result
+			result = result + diffuse * illumination * dotProdNormLight;
+		}
+	}
+	return result;
+}
+
+//--------------------------------------------------------------
+// Adds phong shading to given pixel in the scene
+glm::vec3 RayTracer::phong(Ray ray, const glm::vec3 & point, const glm::vec3 & normal, const glm::vec3 & diffuse, const glm::vec3 & specular, float power,
+	LightVisibility *visibility)
+{
+	// Sets ambient shading
+	glm::vec3 result = 0.15f * diffuse;			// ambient shading value to not make image completely dark
+	// Variables used in checking for shadows
+	glm::vec3 norm = glm::normalize(normal);	// normal at point
+	glm::vec3 shadowRayPt = point + 0.0001f * norm;	// point where shadow rays start (+ small value towards normal)
+	// Variables used in calculating the diffuse and phong shading
+	glm::vec3 directionToCam = -glm::normalize(ray.d);	// vector from point back along the ray (to the camera for primary rays)
+	glm::vec3 directionToLight;					// vector from point to light
+	float illumination;							// light intensity/(distance to light)^2
+	float dotProdNormLight;						// dot product of norm vector and directionToLight vector
+	float dotProdNormBis;						// dot product of norm vector and the vector bisecting directionToLight and directionToCam
+
+
+	// iterates through all lights
+	for (int i = 0; i < lights.size(); i++) {
+		const PointLight &light = lights[i];
+		// Gets the distance and the illumination from source, skipping lights too dim to matter
+		glm::vec3 toLight = light.position - point;
+		float distanceSquared = glm::dot(toLight, toLight);
+		illumination = light.intensity / distanceSquared;
+		if (!(illumination >= lightCutoff) || distanceSquared <= 0) continue;
+		float distance = sqrt(distanceSquared);
+		// Sets direction of ray pointing to light from intersection point on SceneObject
+		directionToLight = toLight / distance;
+
+		// skip the shadow ray if the light can add no shading
+		dotProdNormLight = glm::max(0.0f, glm::dot(norm, directionToLight));
+		dotProdNormBis = glm::max(0.0f, glm::dot(norm, glm::normalize(directionToCam + directionToLight)));
+		if (dotProdNormLight <= 0 && dotProdNormBis <= 0) continue;
+
+		// Only adds lambert and phong shading to result if point is not blocked from current light
+		if (!shadowCheck(Ray(shadowRayPt, directionToLight), distance, i, visibility, 0)) {
+			// Calculate and add diffuse shading to result
+			result += diffuse * illumination * dotProdNormLight;
+			// Adds phong shaded color to result
+			result += specular * illumination * (float)pow(dotProdNormBis, power);
+		}
+	}
+	return result;
+}
+
+//--------------------------------------------------------------
+// Adds phong shading from the area light and the mesh lights to given pixel
+glm::vec3 RayTracer::phongAreaLight(Ray ray, const glm::vec3 & point, const glm::vec3 & normal, const glm::vec3 & diffuse, const glm::vec3 & specular, float power,
+	LightVisibility *visibility)
+{
+	glm::vec3 result(0);
+	for (int i = 0; i < areaLightCount(); i++) {
+		result += phongAreaLight(areaLightAt(i), (int)lights.size() + i, ray, point, normal, diffuse, specular, power, visibility);
+	}
+	return result;
+}
+
+//--------------------------------------------------------------
+// Adds phong shading from one area light to given pixel. The light's
+// intensity is spread evenly over its surface, and the integral over the
+// surface is estimated with areaLightSamples points from a Hammersley set
+// rotated per shaded point. Each sample is weighted by 1 / pdf, so the
+// result converges to the same image whether the triangles are picked by
+// area or by cluster importance.
+glm::vec3 RayTracer::phongAreaLight(const AreaLight &areaLight, int slot, const Ray &ray, const glm::vec3 &point, const glm::vec3 &normal,
+	const glm::vec3 &diffuse, const glm::vec3 &specular, float power, LightVisibility *visibility)
+{
+	// Lights without triangles add no shading, and neither do lights too far
+	// away for even their nearest point to reach lightCutoff
+	if (areaLight.triangles.empty() || areaLight.area <= 0) return glm::vec3(0);
+	if (!(areaLight.intensity >= lightCutoff * areaLight.nearestDistanceSquared(point))) return glm::vec3(0);
+
+	// Variables used in checking for shadows
+	glm::vec3 norm = glm::normalize(normal);	// normal at point
+	glm::vec3 shadowRayPt = point + 0.0001f * norm;	// point where shadow rays start (+ small value towards normal)
+	// Variables used in calculating the diffuse and phong shading
+	glm::vec3 directionToCam = -glm::normalize(ray.d);	// vector from point back along the ray (to the camera for primary rays)
+	glm::vec3 lightPoint;						// current sample on the area light
+	glm::vec3 directionToLight;					// vector from point to the current sample
+	float pdf;									// density of the current sample per unit area
+	float diffuseSum = 0;						// sum of the lambert terms of all samples
+	float specularSum = 0;						// sum of the phong terms of all samples
+
+	// chooses clusters by importance if enabled (one table per shaded point)
+	static thread_local vector<float> clusterCdf;
+	if (areaLightImportance) areaLight.clusterImportance(point, clusterCdf);
+
+	int samples = std::max(1, areaLightSamples);
+	glm::vec2 rotation = hashPoint(point);
+	for (int i = 0; i < samples; i++) {
+		// stratified point on the light
+		glm::vec2 u = hammersley(i, samples);
+		u = glm::vec2(wrapSample(u.x + rotation.x), wrapSample(u.y + rotation.y));
+		lightPoint = areaLightImportance ? areaLight.samplePoint(u, clusterCdf, pdf) : areaLight.samplePoint(u, pdf);
+
+		// Sets direction of ray pointing to the sample from intersection point on SceneObject
+		glm::vec3 toLight = lightPoint - point;
+		float distanceSquared = glm::dot(toLight, toLight);
+		if (distanceSquared <= 0 || pdf <= 0) continue;
+		float distance = sqrt(distanceSquared);
+		directionToLight = toLight / distance;
+
+		// skip the shadow ray if the sample can add no shading
+		float dotProdNormLight = glm::max(0.0f, glm::dot(norm, directionToLight));
+		float dotProdNormBis = glm::max(0.0f, glm::dot(norm, glm::normalize(directionToCam + directionToLight)));
+		if (dotProdNormLight <= 0 && dotProdNormBis <= 0) continue;
+
+		// Only adds lambert and phong shading if point is not blocked from the sample
+		if (!shadowCheck(Ray(shadowRayPt, directionToLight), distance, slot, visibility, i)) {
+			// illumination of the sample's share of the surface
+			float illumination = areaLight.intensity / (areaLight.area * pdf * distanceSquared);
+			diffuseSum += illumination * dotProdNormLight;
+			specularSum += illumination * (float)pow(dotProdNormBis, power);
+		}
+	}
+	return diffuse * (diffuseSum / samples) + specular * (specularSum / samples);
+}
+
+//--------------------------------------------------------------
+// Adds phong shading from lightTreeSamples lights picked from the light
+// tree. Each pick takes a stratified sample rotated per shaded point, and
+// picks of an area light cluster shade one point of the cluster chosen
+// with the rest of the sample. Every pick is weighted by one over the
+// chance it was made with, so the result converges to the shading of
+// every light while costing the same in a scene of ten or ten thousand.
+glm::vec3 RayTracer::phongLightTree(Ray ray, const glm::vec3 & point, const glm::vec3 & normal, const glm::vec3 & diffuse, const glm::vec3 & specular, float power,
+	LightVisibility *visibility)
+{
+	// Sets ambient shading
+	glm::vec3 result = 0.15f * diffuse;			// ambient shading value to not make image completely dark
+	// Variables used in checking for shadows
+	glm::vec3 norm = glm::normalize(normal);	// normal at point
+	glm::vec3 shadowRayPt = point + 0.0001f * norm;	// point where shadow rays start (+ small value towards normal)
+	// Variables used in calculating the diffuse and phong shading
+	glm::vec3 directionToCam = -glm::normalize(ray.d);	// vector from point back along the ray (to the camera for primary rays)
+	float diffuseSum = 0;						// sum of the lambert terms of all picks
+	float specularSum = 0;						// sum of the phong terms of all picks
+
+	int samples = std::max(1, lightTreeSamples);
+	glm::vec2 rotation = hashPoint(point);
+	for (int i = 0; i < samples; i++) {
+		// stratified sample; x picks the light and what is left of it the point on a cluster
+		glm::vec2 u = hammersley(i, samples);
+		u = glm::vec2(wrapSample(u.x + rotation.x), wrapSample(u.y + rotation.y));
+		float probability;
+		int picked = lightTree.pick(point, u.x, probability);
+		if (picked < 0 || probability <= 0) continue;
+		const LightPrimitive &emitter = lightTree.primitives[picked];
+
+		// point on the light, its unshadowed illumination and shadow cache slot
+		glm::vec3 lightPoint;
+		float illumination;
+		int slot;
+		if (emitter.cluster < 0) {
+			lightPoint = lights[emitter.light].position;
+			illumination = lights[emitter.light].intensity;
+			slot = emitter.light;
+		}
+		else {
+			const AreaLight &light = areaLightAt(emitter.light);
+			lightPoint = light.sampleCluster(u, emitter.cluster);
+			// the cluster's share of the light's intensity, spread over the cluster
+			illumination = emitter.power;
+			slot = (int)lights.size() + emitter.light;
+		}
+		glm::vec3 toLight = lightPoint - point;
+		float distanceSquared = glm::dot(toLight, toLight);
+		if (distanceSquared <= 0) continue;
+		illumination /= distanceSquared;
+		if (emitter.cluster < 0 && !(illumination >= lightCutoff)) continue;
+		float distance = sqrt(distanceSquared);
+		glm::vec3 directionToLight = toLight / distance;
+
+		// skip the shadow ray if the light can add no shading
+		float dotProdNormLight = glm::max(0.0f, glm::dot(norm, directionToLight));
+		float dotProdNormBis = glm::max(0.0f, glm::dot(norm, glm::normalize(directionToCam + directionToLight)));
+		if (dotProdNormLight <= 0 && dotProdNormBis <= 0) continue;
+
+		// Only adds lambert and phong shading if point is not blocked from the light. The
+		// point a cluster is sampled at depends on the power of every light, so only the
+		// results of point lights are kept in visibility.
+		if (!shadowCheck(Ray(shadowRayPt, directionToLight), distance, slot, emitter.cluster < 0 ? visibility : NULL, 0)) {
+			diffuseSum += illumination / probability * dotProdNormLight;
+			specularSum += illumination / probability * (float)pow(dotProdNormBis, power);
+		}
+	}
+	return result + diffuse * (diffuseSum / samples) + specular * (specularSum / samples);
+}
+
+//--------------------------------------------------------------
+// Answers the shadow ray from the G-buffer pixel's results when it has the
+// light's sample, so a re-shade only traces the shadow rays it lacks
+bool RayTracer::shadowCheck(const Ray &ray, float distance, int light, LightVisibility *visibility, int sample) {
+	bool blocked;
+	if (visibility != NULL && visibility->lookup(light, sample, blocked)) {
+		RT_STAT(shadowRecalled);
+		return blocked;
+	}
+	blocked = shadowCheck(ray, distance, light);
+	if (visibility != NULL) visibility->record(light, sample, blocked);
+	return blocked;
+}
+
+//--------------------------------------------------------------
+// Checks for intersection between lights and other objects in scene. The
+// object that blocked the light's last shadow ray on this thread is tested
+// first; only when it misses is the SceneBVH searched for any hit
+// (stopping at the first one), whose object becomes the new cached occluder.
+bool RayTracer::shadowCheck(const Ray &ray, float distance, int light) {
+	std::chrono::steady_clock::time_point start;
+	if (stageTimes != NULL) start = std::chrono::steady_clock::now();
+
+	// only return true if an intersection occurs with a surface before ray reaches the light
+	bool blocked;
+	if (useShadowCache) {
+		static thread_local ShadowCache cache;
+		SceneObject *&cached = cache.slot(sceneBVH, light);
+		if (cached != NULL && SceneBVH::occludedBy(cached, ray, distance)) {
+			blocked = true;
+			RT_STAT(shadowCacheHits);
+			if (stageTimes != NULL) stageTimes->shadowCacheHits++;
+		}
+		else {
+			// rays that reach the light keep the old occluder for the next ones
+			SceneObject *occluder;
+			blocked = sceneBVH.occluded(ray, distance, occluder);
+			if (blocked) cached = occluder;
+		}
+	}
+	else {
+		blocked = sceneBVH.occluded(ray, distance);
+	}
+	RT_STAT_SHADOW(light, blocked);
+
+	// timed shadow ray of a single threaded benchmark
+	if (stageTimes != NULL) {
+		stageTimes->shadowRays += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		stageTimes->shadowRayCount++;
+	}
+	return blocked;
+}
+
@@ -0,0 +1,999 @@
+// This file provides the class definitions Ray, SceneObject, Sphere, Mesh,
+// View, ViewPlane, RenderCam, the lights, and RayTracer
+// - author: Jared Bechthold
+// - starter files containing initial class defintions of Ray, SceneObject, Sphere,
+// Mesh, View, ViewPlane, and RenderCam provided by Professor Kevin Smith
+
+#pragma once
+
+#include "ofMain.h"
+#include <glm/gtx/intersect.hpp>
+#include "tileRenderer.h"
+#include "bvh.h"
+#include "simdKernels.h"
+#include "texture.h"
+#include "material.h"
+#include "framebuffer.h"
+#include "gBuffer.h"
+#include "renderStats.h"
+#include "animation.h"
+#include "arena.h"
+#include "sampling.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//  General Purpose Ray class 
+//
+class Ray {
+public:
+	// ray constrcutor
+	Ray(glm::vec3 p, glm::vec3 d) { this->p = p; this->d = d; }
+
+	// default ray constructor
+	Ray() { this->p = glm::vec3(0, 0, 0); this->d = glm::vec3(0, 0, 0); }
+
+	// draws the ray
+	void draw(float t) { ofDrawLine(p, p + t * d); }
+
+	// returns value along the ray for any value of t
+	glm::vec3 evalPoint(float t) {
+		return (p + t * d);
+	}
+
+	// two quantities represent the array
+	//	position where the ray starts in space
+	//	direction where the ray is fired
+	glm::vec3 p, d;
+};
+
+class SceneObject;
+
+//  Result of a ray query: distance along the ray, hit point, surface
+//  normal, and the object that was hit
+//
+class HitRecord {
+public:
+	// returns true if the query hit an object
+	bool hit() const { return object != NULL; }
+
+	float t = std::numeric_limits<float>::infinity();	// distance along the ray to the hit
+	glm::vec3 point;									// point where the ray hit the object
+	glm::vec3 normal;									// surface normal at the hit point
+	SceneObject *object = NULL;							// object that was hit (NULL if none)
+};
+
+//  Rays through the neighboring pixels of a primary ray (one pixel along
+//  the image x and y axes), used to estimate the footprint of a pixel
+//
+class RayDifferential {
+public:
+	// returns the offsets from the hit point to the points where the neighboring
+	// rays cross the tangent plane of the hit
+	void footprint(const HitRecord &hit, glm::vec3 &dpdx, glm::vec3 &dpdy) const;
+
+	Ray dx, dy;		// rays through the neighboring pixels
+};
+
+//  Reflected or refracted ray waiting to be traced, with the pixel it adds
+//  its radiance to and the share of that radiance the pixel receives
+//
+struct SecondaryRay {
+	Ray ray;			// ray leaving the surface (normalized direction)
+	glm::vec3 weight;	// share of the ray's radiance that reaches the pixel
+	int pixel;			// index of the color the radiance is added to
+	int batch;			// material and kind (mirrored or refracted) of the ray; rays
+						//  of the same batch are traced together
+};
+
+// concrete classes of SceneObject, which the SceneBVH intersects without a virtual call
+enum ObjectType : uint8_t {
+	OBJECT_OTHER = 0,	// any other class (intersected through the virtual intersect())
+	OBJECT_SPHERE = 1,	// Sphere
+	OBJECT_PLANE = 2,	// Plane
+	OBJECT_MESH = 3		// Mesh
+};
+
+//  Base class for any renderable object in the scene
+//	(AKA SurfaceObject)
+class SceneObject {
+public:
+	virtual ~SceneObject() {}
+	// every SceneObject has draw() and intersect() methods to be overloaded
+	virtual void draw() = 0;    // pure virtual funcs - must be overloaded
+	virtual bool intersect(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) { cout << "SceneObject::intersect" << endl; return false; }
+	// tests for an intersection closer than tMax and fills in hit in a single pass
+	// (the ray direction must be normalized so t is a distance)
+	virtual bool intersect(const Ray &ray, float tMax, HitRecord &hit);
+	// returns the color of the scene object
+	virtual ofColor getColor(glm::vec3 intersectPt) { return diffuseColor; }
+	// returns the color of the scene object filtered over a pixel footprint given by
+	// the offsets dpdx and dpdy to the points seen by the neighboring pixels
+	virtual ofColor getColor(const glm::vec3 &point, const glm::vec3 &dpdx, const glm::vec3 &dpdy) { return getColor(point); }
+	// returns the axis aligned bounds of the object (empty if it can never be hit)
+	virtual AABB getBounds() { return AABB(); }
+
+	// any data common to all scene objects goes here
+	glm::vec3 position = glm::vec3(0, 0, 0);
+	// concrete class of the object, set by its constructors
+	ObjectType type = OBJECT_OTHER;
+
+	// surface properties: the diffuse color (textures may replace it) and the
+	// index of the object's Material in RayTracer::materials
+	//
+	ofColor diffuseColor = ofColor::grey;    // default colors - can be changed.
+	uint16_t material = 0;
+};
+
+//  General purpose sphere  (assume parametric)
+//
+class Sphere : public SceneObject {
+public:
+	// Sphere constructor that sets the position, raidus, and color of the Sphere
+	Sphere(glm::vec3 p, float r, ofColor diffuse = ofColor::lightGray) { type = OBJECT_SPHERE; position = p; radius = r; diffuseColor = diffuse; }
+	// Default Sphere constructor
+	Sphere() { type = OBJECT_SPHERE; }
+
+	// tests for intersection of the Sphere with a Ray
+	bool intersect(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) {
+		return (glm::intersectRaySphere(ray.p, ray.d, position, radius, point, normal));
+	}
+	// tests for intersection of the Sphere with a Ray closer than tMax
+	bool intersect(const Ray &ray, float tMax, HitRecord &hit);
+	// returns the box enclosing the Sphere
+	AABB getBounds() { return AABB(position - glm::vec3(radius), position + glm::vec3(radius)); }
+	// draws the Sphere
+	void draw() {
+		ofFill();
+		ofSetColor(diffuseColor);
+		ofDrawSphere(position, radius);
+	}
+
+	// radius of the Sphere
+	float radius = 1.0;
+};
+
+// triangle class
+//
+class Triangle {
+public:
+	// default Triangle constructor (all indices 0)
+	Triangle() { vertInd[0] = vertInd[1] = vertInd[2] = 0; }
+	// adds vertex indices to vertInd integer array
+	Triangle(int i1, int i2, int i3) {
+		vertInd[0] = i1;
+		vertInd[1] = i2;
+		vertInd[2] = i3;
+	}
+
+	int vertInd[3];	// Holds three vertices of triangle
+};
+
+//  Triangle mesh loaded from an OBJ file
+//  Triangles are kept in the order of the mesh's BVH leaves so a traversal
+//  reads them sequentially.
+//
+class Mesh : public SceneObject {
+public:
+	// Mesh constructor that sets the position (offset of every vertex) and color of the Mesh
+	Mesh(glm::vec3 p, ofColor diffuse = ofColor::lightGray) { type = OBJECT_MESH; position = p; diffuseColor = diffuse; }
+	// Default Mesh constructor
+	Mesh() { type = OBJECT_MESH; }
+
+	// loads the vertices and triangles of an OBJ file and builds the Mesh's BVH
+	// returns false if the file could not be read
+	bool load(string fileName);
+	// builds the BVH over the current verts and triangles (call after editing them)
+	void build();
+	// refreshes the mesh used for drawing from verts and triangles
+	// (build() calls it; call it directly after restoring a prebuilt BVH)
+	void updateDrawMesh();
+	// moves the Mesh by delta, shifting its vertices and BVH instead of rebuilding it
+	void translate(const glm::vec3 &delta);
+
+	// tests for intersection of the Mesh with a Ray (closest triangle)
+	bool intersect(const Ray &ray, glm::vec3 &point, glm::vec3 &normal);
+	// tests for intersection of the Mesh with a Ray closer than tMax
+	bool intersect(const Ray &ray, float tMax, HitRecord &hit);
+	// returns true as soon as any triangle is hit closer than maxDistance (for shadow rays)
+	bool occluded(const Ray &ray, float maxDistance) const;
+	// returns the bounds of all triangles
+	AABB getBounds() { return bvh.bounds(); }
+	// draws the Mesh's triangles
+	void draw() {
+		ofSetColor(diffuseColor);
+		drawMesh.draw();
+	}
+
+	vector<glm::vec3> verts;	// vertex positions (already offset by position)
+	vector<Triangle> triangles;	// triangles of the Mesh in BVH order
+	BVH bvh;					// hierarchy over the triangles
+	string sourceFile;			// OBJ file the Mesh was loaded from
+
+private:
+	ofMesh drawMesh;			// copy of the triangles used for drawing
+};
+
+//  General purpose plane 
+//
+class Plane : public SceneObject {
+public:
+	// Plane constructor that sets point, normal, color, height, and width
+	Plane(glm::vec3 p, glm::vec3 n, ofColor diffuse = ofColor::darkOliveGreen, float w = 20, float h = 20) {
+		type = OBJECT_PLANE;
+		position = p; normal = n;
+		width = w;
+		height = h;
+		diffuseColor = diffuse;
+		if (normal == glm::vec3(0, 1, 0)) plane.rotateDeg(90, 1, 0, 0);
+	}
+	// default Plane constructor
+	Plane() {
+		type = OBJECT_PLANE;
+		normal = glm::vec3(0, 1, 0);
+		plane.rotateDeg(90, 1, 0, 0);
+	}
+
+	// applies texture image to the plane (converted to a mipmapped Texture)
+	void applyTexture(const ofImage &textureToApply) {
+		texture.build(textureToApply.getPixels());
+		textureApplied = !texture.empty();
+		textureVersion++;
+	}
+
+	// sets amount of tiles in x and y direction for texture mapping
+	void setTiles(int x, int y) {
+		tilesX = x;
+		tilesY = y;
+	}
+
+	// overrdes getColor to handle textureMapping (bilinear, without a footprint)
+	ofColor getColor(glm::vec3 intersectPt);
+	// samples the texture over the pixel footprint with textureFilter
+	ofColor getColor(const glm::vec3 &point, const glm::vec3 &dpdx, const glm::vec3 &dpdy);
+	// returns the texture coordinates of a point; the texture repeats tilesX
+	// times across the width and tilesY times across the height
+	glm::vec2 textureCoordinates(const glm::vec3 &point) const {
+		return glm::vec2((point.x - (position.x - width / 2)) / width * tilesX, (point.z - (position.z - height / 2)) / height * tilesY);
+	}
+
+	// tests for intersection of Plane with a Ray
+	bool intersect(const Ray &ray, glm::vec3 & point, glm::vec3 & normal);
+	// tests for intersection of Plane with a Ray closer than tMax
+	bool intersect(const Ray &ray, float tMax, HitRecord &hit);
+	// returns the bounds of the Plane's width x height area
+	AABB getBounds();
+	float sdf(const glm::vec3 &p);
+	// returns the Plane's normal
+	glm::vec3 getNormal(const glm::vec3 &p) { return this->normal; }
+	// draws the Plane
+	void draw() {
+		ofSetColor(diffuseColor);
+		plane.setPosition(position);
+		plane.setWidth(width);
+		plane.setHeight(height);
+		plane.setResolution(4, 4);
+		plane.drawFaces();
+	}
+
+	// used for drawing the Plane
+	ofPlanePrimitive plane;
+	// holds vector normal to the Plane
+	glm::vec3 normal;
+	// dimensions of the Plane
+	float width = 20;
+	float height = 20;
+	// detects if a texture has been applied to the plane (initialized false)
+	bool textureApplied = false;
+	// holds texture image (if applied)
+	Texture texture;
+	// filter used when sampling the texture
+	TextureFilter textureFilter = TEXTURE_TRILINEAR;
+	// file the texture image was loaded from (used when saving scenes)
+	string textureFile;
+	// counts the textures applied, so a new image from the same file is told apart
+	int textureVersion = 0;
+	// holds amount of tiles used in texture mapping in x and y direction
+	//  default to 10 each
+	int tilesX = 10;
+	int tilesY = 10;
+};
+
+// view plane for render camera
+// 
+class  ViewPlane : public Plane {
+public:
+	// constructor for ViewPlane defining p0 as bottom left corner
+	// and p1 as top right corner
+	ViewPlane(glm::vec2 p0, glm::vec2 p1) { min = p0; max = p1; }
+	// default constructor for ViewPlane create reasonable defaults (6x4 aspect)
+	ViewPlane() {
+		min = glm::vec2(-3, -2);
+		max = glm::vec2(3, 2);
+		position = glm::vec3(0, 0, 5);
+		normal = glm::vec3(0, 0, 1);      // ViewPlane currently limited to Z axis orientation
+	}
+
+	// sets the min and max points of the ViewPlane
+	void setSize(glm::vec2 min, glm::vec2 max) { this->min = min; this->max = max; }
+	// returns the width and height of the ViewPlane
+	float getAspect() { return width() / height(); }
+	// converts coordinates on ViewPlane to 3D world space
+	glm::vec3 toWorld(float u, float v);   //   (u, v) --> (x, y, z) [ world space ]
+	// draws the ViewPlane
+	void draw() {
+		ofDrawRectangle(glm::vec3(min.x, min.y, position.z), width(), height());
+	}
+	// returns the width and height of the ViewPlane
+	float width() const {
+		return (max.x - min.x);
+	}
+	float height() const {
+		return (max.y - min.y);
+	}
+	// returns the corners of the ViewPlane
+	glm::vec2 topLeft() { return glm::vec2(min.x, max.y); }
+	glm::vec2 topRight() { return max; }
+	glm::vec2 bottomLeft() { return min; }
+	glm::vec2 bottomRight() { return glm::vec2(max.x, min.y); }
+
+
+	glm::vec2 min, max;	// defines the boundaries of the ViewPlane
+};
+
+
+//  Render camera: a look-at camera with a field of view and a thin lens
+//  With fov = 0 the image is the z aligned ViewPlane window seen from
+//  position (the original camera model, which scene files without a fov
+//  still use). prepare() turns the settings into the offsets from the
+//  camera to the lower left image corner on the focus plane and the steps
+//  of one pixel along x and y, so the ray of every pixel is a sum instead
+//  of a per pixel projection. With an aperture, rays start on a disk of
+//  that diameter around position and meet on the focus plane, so only
+//  points at the focus distance are sharp.
+//
+class RenderCam : public SceneObject {
+public:
+	// default Constructor for the RenderCam
+	RenderCam() {
+		position = glm::vec3(0, 0, 10);
+		aim = glm::vec3(0, 0, -1);
+		boxDimension = 1.0;
+		prepare(1, 1);
+	}
+
+	// computes the per pixel steps and lens axes of an image of width x height
+	// pixels from the settings below (call after changing them, before getRay())
+	void prepare(int width, int height);
+	// returns the offset from position to the point of the focus plane seen
+	// through image position (x, y) in pixels (y grows up)
+	glm::vec3 focusOffset(float x, float y) const { return lowerLeft + x * pixelDx + y * pixelDy; }
+	// fills offsets with the focusOffset() of the center of one pixel per step x step
+	// block of a tile, column by column, stepping from pixel to pixel by addition
+	void tileOffsets(const Tile &tile, int step, vector<glm::vec3> &offsets) const;
+	// returns the Ray through a focus plane offset from the lens point picked by
+	// lens in [0, 1)^2 (the center is (0.5, 0.5); ignored without an aperture)
+	Ray getRay(const glm::vec3 &offset, glm::vec2 lens) const;
+	// returns the Rays from the origin of ray through the focus plane points
+	// footprint pixels to the right of and above offset
+	RayDifferential getRayDifferential(const Ray &ray, const glm::vec3 &offset, float footprint) const {
+		RayDifferential differential;
+		differential.dx = Ray(ray.p, glm::normalize(position + offset + footprint * pixelDx - ray.p));
+		differential.dy = Ray(ray.p, glm::normalize(position + offset + footprint * pixelDy - ray.p));
+		return differential;
+	}
+	// returns a Ray from the lens center to the (u, v) position of the image ([0, 1]^2)
+	Ray getRay(float u, float v) const { return getRay(focusOffset(u * imageWidth, v * imageHeight), glm::vec2(0.5f)); }
+	// returns the Rays to (u + du, v) and (u, v + dv), the neighbors of the Ray to (u, v)
+	RayDifferential getRayDifferential(float u, float v, float du, float dv) const {
+		RayDifferential differential;
+		differential.dx = getRay(u + du, v);
+		differential.dy = getRay(u, v + dv);
+		return differential;
+	}
+	// returns true if the lens blurs points off the focus plane
+	bool hasLens() const { return aperture > 0; }
+	// draws the RenderCam
+	void draw() { ofDrawBox(position, boxDimension); };
+	// draws the image window on the focus plane for an image of the given aspect
+	// ratio and the lines connecting the camera to its corners
+	void drawFrustum(float aspect) const;
+
+	float boxDimension;					// defines the width, length, and height of the RenderCam
+	glm::vec3 aim;						// the position that the RenderCam aims at
+	glm::vec3 up = glm::vec3(0, 1, 0);	// direction that is up in the image (with a fov)
+	float fov = 0;						// vertical field of view in degrees (0 uses the ViewPlane)
+	float aperture = 0;					// diameter of the lens (0 is a pinhole camera)
+	float focusDistance = 0;			// distance along the view direction that is in focus
+										//  (0 focuses on aim, or on the ViewPlane without a fov)
+	ViewPlane view;						// The camera viewplane, this is the view that we will render without a fov
+
+private:
+	// computes the offsets from position to the lower left image corner on the
+	// focus plane and the vectors along the image width and height
+	void frame(float aspect, glm::vec3 &corner, glm::vec3 &horizontal, glm::vec3 &vertical) const;
+
+	// set by prepare()
+	int imageWidth = 1;					// width of the image in pixels
+	int imageHeight = 1;				// height of the image in pixels
+	glm::vec3 lowerLeft;				// offset to the lower left image corner on the focus plane
+	glm::vec3 pixelDx, pixelDy;			// offsets between neighboring pixels on the focus plane
+	glm::vec3 lensU, lensV;				// lens radius along the image x and y axes
+};
+
+// base light class
+//
+class Light : public SceneObject {
+public:
+	// sets intensity of light
+	void setIntensity(float newIntensity) {
+		intensity = newIntensity;
+	}
+
+	// tracks light intensity
+	float intensity = 0;
+};
+
+// point light class
+//
+class PointLight : public Light {
+public:
+	// PointLight constructor
+	PointLight(glm::vec3 position, float intensity, float radius, ofColor diffuse = ofColor::white) {
+		this->position = position;
+		this->intensity = intensity;
+		this->radius = radius;
+		this->diffuseColor = diffuse;
+	}
+
+	// draws the Sphere representing the light
+	void draw() {
+		ofNoFill();
+		ofSetColor(diffuseColor);
+		ofDrawSphere(position, radius);
+	}
+
+	// tracks size of drawble light
+	float radius;
+};
+
+//  Group of nearby triangles of an area light
+//
+struct LightCluster {
+	AABB bounds;			// bounds of the triangles
+	float area = 0;			// total area of the triangles
+	int firstTriangle = 0;	// index of the first triangle of the cluster
+	int triangleCount = 0;	// number of triangles in the cluster
+};
+
+// area light class
+//  Emits its intensity uniformly over the surface of its triangles, so
+//  brightness does not depend on how finely the light is tessellated.
+//
+class AreaLight : public Light {
+public:
+	// AreaLight constructor
+	AreaLight(glm::vec3 position, float intensity) {
+		this->position = position;
+		this->intensity = intensity;
+	}
+
+	// Default AreaLight constructor
+	AreaLight() {}
+
+	// Methods
+	// Iterates through and draws all triangles of the AreaLight
+	void draw()
+	{
+		// Set color and no fill for Triangle
+		ofSetColor(ofColor::white);
+		ofNoFill();
+
+		// Integer variables to hold vertices of Triangle
+		int v1, v2, v3;
+
+		// Iterates through and draw each Triangle in area light
+		for (Triangle t : triangles) {
+			// Record indices of vertices of triangle
+			v1 = t.vertInd[0];
+			v2 = t.vertInd[1];
+			v3 = t.vertInd[2];
+			// Draw triangle using record vertices
+			ofDrawTriangle(verts[v1], verts[v2], verts[v3]);
+		}
+	}
+
+	void updatePosition();	// updates the position 
+	// moves the light and its sampling clusters by delta
+	void translate(const glm::vec3 &delta);
+	// groups the triangles into clusters and builds the area tables used for
+	// sampling (call after the verts or triangles change; reorders triangles)
+	void buildSampling();
+	// returns a point on the light for u in [0, 1)^2, chosen with probability
+	// proportional to area; pdf is the density per unit area (1 / area)
+	glm::vec3 samplePoint(glm::vec2 u, float &pdf) const;
+	// fills cdf with the running sum of each cluster's importance seen from point
+	// (its area over the squared distance to its bounds)
+	void clusterImportance(const glm::vec3 &point, vector<float> &cdf) const;
+	// returns the squared distance from point to the nearest cluster bounds (0
+	// inside one), which bounds the illumination of the light at the point
+	float nearestDistanceSquared(const glm::vec3 &point) const;
+	// returns a point on the light for u in [0, 1)^2, choosing the cluster by
+	// the importance cdf and the triangle by area; pdf is the density per unit area
+	glm::vec3 samplePoint(glm::vec2 u, const vector<float> &cdf, float &pdf) const;
+	// returns a point chosen by area like samplePoint(u, pdf) and the unit normal of its triangle
+	glm::vec3 samplePoint(glm::vec2 u, float &pdf, glm::vec3 &normal) const;
+	// tests the triangles for the closest hit of a ray before tMax, setting t and
+	// the unit normal of the triangle hit (each triangle is tested, so this is meant
+	// for lights of a few triangles)
+	bool intersect(const Ray &ray, float tMax, float &t, glm::vec3 &normal) const;
+	// tests the triangles of one cluster, lowering tMax to the closest hit and
+	// setting the unit normal of its triangle; returns false if none is hit
+	bool intersectCluster(const Ray &ray, int cluster, float &tMax, glm::vec3 &normal) const;
+	// returns a point of one cluster chosen by area for u in [0, 1)^2 (density
+	// 1 / cluster area) and, when normal is given, the unit normal of its triangle
+	glm::vec3 sampleCluster(glm::vec2 u, int cluster, glm::vec3 *normal = NULL) const;
+
+	// Fields
+	vector<glm::vec3> verts;	// holds all vertex values of area light
+	vector<Triangle> triangles;	// holds all triangles of the area light
+	vector<float> triangleCdf;	// running sum of triangle areas, in triangle order
+	vector<LightCluster> clusters;	// nearby triangles grouped for importance sampling
+	float area = 0;				// total area of the triangles
+
+private:
+	// returns an area-weighted point in triangles [first, first + count)
+	// (and the normal of its triangle when normal is given)
+	glm::vec3 sampleTriangles(glm::vec2 u, int first, int count, glm::vec3 *normal = NULL) const;
+};
+
+//  Emitter of a LightTree: a point light, or one cluster of an area light
+//
+struct LightPrimitive {
+	AABB bounds;		// bounds of the emitter (a single point for point lights)
+	float power = 0;	// intensity of the emitter; area lights split theirs over their clusters by area
+	int light = 0;		// index of the point light, or of the area light (see RayTracer::areaLightAt)
+	int cluster = -1;	// cluster of the area light, -1 for point lights
+};
+
+//  Bounding volume hierarchy over every light of a scene, for scenes with
+//  too many lights to shade each one at every point
+//  Each node knows the power of the emitters below it. A shaded point
+//  walks from the root to one emitter, choosing each child with probability
+//  proportional to its power over the squared distance to its bounds, so
+//  picking a light costs O(log n) and nearby bright lights are picked most.
+//  The hierarchy is the same BVH used for objects and triangles.
+//
+class LightTree {
+public:
+	// builds the tree over the point lights and the clusters of the area lights
+	// (the area lights must stay in place until the next build)
+	void build(const Arena<PointLight, 64> &pointLights, const vector<const AreaLight *> &lights);
+	// returns true if the scene has no light to pick
+	bool empty() const { return bvh.empty(); }
+	// picks an emitter for point with u in [0, 1), returning its index in primitives
+	// (-1 if no light reaches the point) and the probability it was picked with;
+	// u is rescaled to [0, 1) within the choice so it can be reused
+	int pick(const glm::vec3 &point, float &u, float &probability) const;
+	// returns the probability that pick() chooses the given emitter for point
+	float probability(const glm::vec3 &point, int primitive) const;
+	// finds the closest area light triangle hit by the ray before tMax, setting
+	// its distance t, unit normal and emitter; point lights are never hit
+	bool intersect(const Ray &ray, float tMax, float &t, glm::vec3 &normal, int &primitive) const;
+
+	vector<LightPrimitive> primitives;		// emitters indexed by the hierarchy
+	vector<const AreaLight *> areaLights;	// area lights the clusters belong to
+	BVH bvh;								// hierarchy over the emitter bounds
+	vector<float> nodePower;				// total power below each node
+	vector<int> parents;					// parent of each node (-1 for the root)
+	vector<int> primitiveNodes;				// leaf node holding each emitter
+
+private:
+	// returns the importance of an emitter or node of the given power and bounds for point
+	static float importance(const glm::vec3 &point, const AABB &bounds, float power);
+};
+
+//  Primitives of one leaf of the SceneBVH: spheres and planes packed into
+//  SIMD packets, meshes, and the remaining objects tested through intersect()
+//
+struct SceneLeaf {
+	int firstSpherePacket = 0;	// index of the leaf's first SpherePacket
+	int spherePacketCount = 0;	// number of SpherePackets in the leaf
+	int firstPlanePacket = 0;	// index of the leaf's first PlanePacket
+	int planePacketCount = 0;	// number of PlanePackets in the leaf
+	int firstMesh = 0;			// index of the leaf's first Mesh
+	int meshCount = 0;			// number of Meshes in the leaf
+	int firstOther = 0;			// index of the leaf's first other object
+	int otherCount = 0;			// number of other objects in the leaf
+};
+
+//  Bounding volume hierarchy over the SceneObjects of a scene
+//  Leaves hold up to 8 objects; their spheres and planes are stored as
+//  structure of arrays so one ray is tested against a whole leaf with a
+//  single SIMD kernel call, and their meshes in a list of their own, so
+//  every object is intersected by a call chosen by its ObjectType rather
+//  than a virtual call. Objects that cannot be bounded are kept aside and
+//  tested by every query. Distances are measured along the ray, so ray
+//  directions must be normalized.
+//
+class SceneBVH {
+public:
+	// builds the hierarchy and the leaf packets over the given objects
+	void build(const vector<SceneObject *> &sceneObjects);
+	// updates the node bounds and leaf packets to the current positions and sizes
+	// of the objects it was built over, keeping the tree. Returns false, leaving
+	// the hierarchy unusable until the next build(), if the object list changed,
+	// an object became unbounded, or the refit tree got much worse than a new one.
+	bool refit(const vector<SceneObject *> &sceneObjects);
+	// finds the closest object hit by the ray before hit.t; returns false if nothing is hit
+	bool intersect(const Ray &ray, HitRecord &hit) const;
+	// returns true as soon as any object is hit closer than maxDistance (for shadow rays)
+	bool occluded(const Ray &ray, float maxDistance) const { SceneObject *occluder; return occluded(ray, maxDistance, occluder); }
+	// same query, also returning the object that blocked the ray in occluder
+	bool occluded(const Ray &ray, float maxDistance, SceneObject *&occluder) const;
+	// returns true if one object is hit closer than maxDistance, calling its
+	// class's intersection test directly for the known ObjectTypes
+	static bool occludedBy(SceneObject *object, const Ray &ray, float maxDistance);
+
+	BVH bvh;							// hierarchy over the bounded objects
+	vector<SceneObject *> objects;		// objects indexed by the hierarchy
+	vector<Plane *> unboundedPlanes;	// planes tested linearly (not horizontal)
+	vector<SceneObject *> unbounded;	// other objects tested linearly
+	vector<SceneLeaf> leaves;			// per node leaf contents (only used for leaf nodes)
+	vector<SpherePacket> spherePackets;	// spheres of all leaves
+	vector<PlanePacket> planePackets;	// planes of all leaves
+	vector<Mesh *> meshes;				// meshes of all leaves
+	vector<SceneObject *> others;		// objects of all leaves of no known ObjectType
+	const SimdKernels *kernels = &simdKernels();	// packet kernels used by the queries
+	vector<SceneObject *> sourceObjects;	// object list the hierarchy was built from
+	float builtCost = 0;					// total surface area of the nodes when built
+	unsigned long buildId = 0;				// unique number of the last build(), so caches of
+											//  object pointers (see ShadowCache) notice new scenes
+
+private:
+	// tests one leaf, lowering tMax and filling hit on closer hits
+	// in anyHit mode returns true at the first hit closer than tMax
+	bool intersectLeaf(const SceneLeaf &leaf, const Ray &ray, float &tMax, HitRecord &hit, bool anyHit) const;
+};
+
+//  Object that last blocked the shadow rays of each light, kept per render
+//  thread. Neighboring points are mostly shadowed by the same object, so
+//  testing it first answers most blocked shadow rays without traversing
+//  the SceneBVH. The cache empties itself when the SceneBVH is rebuilt.
+//
+class ShadowCache {
+public:
+	// returns the occluder slot of a light, emptying the cache if bvh was rebuilt since it was filled
+	SceneObject *&slot(const SceneBVH &bvh, int light) {
+		if (buildId != bvh.buildId) {
+			occluders.clear();
+			buildId = bvh.buildId;
+		}
+		if (light >= (int)occluders.size()) occluders.resize(light + 1, NULL);
+		return occluders[light];
+	}
+
+private:
+	unsigned long buildId = 0;			// SceneBVH::buildId the occluders belong to
+	vector<SceneObject *> occluders;	// last occluder per light (NULL if none)
+};
+
+// reads the vertices and faces of an OBJ file (see objFile.cpp), splitting
+// polygons into triangles; returns false and sets error (with the line of a
+// bad statement) if the file cannot be read
+bool loadObj(const string &fileName, vector<glm::vec3> &verts, vector<Triangle> &triangles, string &error);
+// reads an OBJ file like above, printing the error instead
+bool loadObj(string fileName, vector<glm::vec3> &verts, vector<Triangle> &triangles);
+
+//  Time spent in each stage of a render, measured by RayTracer::measureStages()
+//
+struct RenderStageTimes {
+	double bvhBuild = 0;		// building the SceneBVH
+	double rayGeneration = 0;	// creating the primary rays
+	double intersection = 0;	// closest-hit queries of the primary rays
+	double shading = 0;			// shading the hits, without the shadow rays
+	double shadowRays = 0;		// occlusion queries of the shadow rays
+	double imageWrite = 0;		// encoding and saving the image
+	long primaryRays = 0;		// number of primary rays
+	long shadowRayCount = 0;	// number of shadow rays
+	long shadowCacheHits = 0;	// shadow rays blocked by the cached occluder (no BVH traversal)
+};
+
+class Integrator;
+
+//  Scene, render camera, and ray tracing renderer of the app
+//  Holds no window or GL state, so it also renders headless (see renderCli.h)
+//
+class RayTracer {
+public:
+	// RayTracer constructor (empty scene, Whitted integrator)
+	RayTracer();
+	// stops a background render before the scene is destroyed
+	~RayTracer();
+
+	// builds the default scene: textured floor, three spheres, three point lights
+	// and an area light without vertices (textureFile is mapped onto the floor)
+	void setupDefaultScene(string textureFile = "textureImg.jpg");
+	// sets the resolution of the rendered image and allocates it
+	void setImageSize(int width, int height);
+	// sets the intensity of every point light and of the area light
+	void setLightIntensities(float pointIntensity, float areaIntensity);
+	// destroys every SceneObject and light, the mesh lights, and empties the area light
+	void clearScene();
+	// creates a Sphere in the scene and returns it
+	Sphere *addSphere(glm::vec3 position, float radius, ofColor color = ofColor::lightGray);
+	// creates a Plane in the scene and returns it
+	Plane *addPlane(glm::vec3 position, glm::vec3 normal, ofColor color = ofColor::darkOliveGreen, float width = 20, float height = 20);
+	// creates an empty Mesh in the scene and returns it (fill in its verts,
+	// triangles and BVH, e.g. from a cache)
+	Mesh *addMesh(glm::vec3 position, ofColor color = ofColor::lightGray);
+	// loads an OBJ file as a Mesh in the scene and returns it; returns NULL,
+	// leaving the scene as it was, if the file cannot be read
+	Mesh *addMesh(const string &fileName, glm::vec3 position, ofColor color = ofColor::lightGray);
+	// adds a Material to the scene and returns its index (for SceneObject::material)
+	int addMaterial(const Material &material);
+	// creates a PointLight in the scene and returns it
+	PointLight *addLight(glm::vec3 position, float intensity, float radius, ofColor color = ofColor::white);
+	// loads an OBJ file as an emissive mesh light at position and returns it;
+	// returns NULL, leaving the scene as it was, if the file cannot be read
+	AreaLight *addMeshLight(const string &fileName, glm::vec3 position, float intensity);
+	// returns the number of area lights: the area light, then every mesh light
+	int areaLightCount() const { return 1 + (int)meshLights.size(); }
+	// returns area light i (0 is areaLight, i > 0 is meshLights[i - 1])
+	const AreaLight &areaLightAt(int i) const { return i == 0 ? areaLight : meshLights[i - 1]; }
+	// returns true if the scene has more lights than lightTreeThreshold, so shaded
+	// points pick their lights from lightTree instead of shading every light
+	bool usesLightTree() const { return (int)lights.size() + areaLightCount() > lightTreeThreshold; }
+	// replaces the scene with the one described by a scene file (see sceneFile.h)
+	// returns false and prints the reason if the file cannot be loaded, leaving
+	// the current scene as it was
+	bool loadScene(string fileName);
+	// exchanges the scene (objects, materials, lights, animation, camera and
+	// the settings a scene file sets) with other's, along with the image
+	void swapScene(RayTracer &other);
+	// Loads obj file into the area light; returns false if it cannot be opened
+	bool loadAreaLight(string fileName);
+	// Loads obj file as a Mesh and adds it to the scene; returns false if it cannot be opened
+	bool loadMesh(string fileName, glm::vec3 position = glm::vec3(0, 0, 0), ofColor color = ofColor::lightGray);
+	// Adds phong shading to given pixel in scene; shadow ray results are taken
+	// from and recorded in visibility when given (see GBuffer)
+	glm::vec3 phong(Ray ray, const glm::vec3 & point, const glm::vec3 & normal, const glm::vec3 & diffuse, const glm::vec3 & specular, float power,
+		LightVisibility *visibility = NULL);
+	// adds lambert shading to given pixel in scene
+	glm::vec3 lambert(Ray ray, const glm::vec3 &point, const glm::vec3 &normal, const glm::vec3 &diffuse);
+	// adds phong shading to given pixel from the area light and every mesh light, each
+	// estimated from areaLightSamples shadow rays to stratified points on its triangles
+	glm::vec3 phongAreaLight(Ray ray, const glm::vec3 & point, const glm::vec3 & normal, const glm::vec3 & diffuse, const glm::vec3 & specular, float power,
+		LightVisibility *visibility = NULL);
+	// adds ambient and phong shading to given pixel from lightTreeSamples lights
+	// picked from lightTree, instead of from every light (see usesLightTree())
+	glm::vec3 phongLightTree(Ray ray, const glm::vec3 & point, const glm::vec3 & normal, const glm::vec3 & diffuse, const glm::vec3 & specular, float power,
+		LightVisibility *visibility = NULL);
+	// returns the linear color of the closest hit of a ray (point lights and area light);
+	// the ray differential, if given, sets the footprint for texture filtering
+	glm::vec3 shade(const Ray &ray, const HitRecord &hit, const RayDifferential *differential = NULL);
+	// returns the direct light of a hit whose object has the given linear base color
+	// (see SceneObject::getColor); only the direction of the ray is used. Shadow ray
+	// results are taken from and recorded in visibility when given.
+	glm::vec3 shadeSurface(const Ray &ray, const HitRecord &hit, glm::vec3 diffuse, LightVisibility *visibility = NULL);
+	// adds the mirrored and refracted rays of a hit to rays, if its material
+	// scatters and depth (the bounce the new rays make) is within maxRayDepth.
+	// Past rouletteDepth bounces rays survive with a probability that falls
+	// with their weight, and survivors are weighted up to keep the image unbiased.
+	void scatter(const Ray &ray, const HitRecord &hit, const glm::vec3 &weight, int pixel, int depth, vector<SecondaryRay> &rays);
+	// traces the secondary rays of a group of pixels one bounce at a time, sorted
+	// into batches by material, adding their radiance to colors[pixel]; empties rays.
+	// With costs, the time spent on each ray is added to costs[pixel] (see RT_STATS).
+	void traceSecondary(vector<SecondaryRay> &rays, glm::vec3 *colors, const glm::vec3 &backgroundColor, float *costs = NULL);
+	// returns true if any SceneObject blocks ray before distance (the distance to
+	// the light). light is the index of the point light, or lights.size() plus
+	// the index of the area light (see areaLightAt), and selects the thread's
+	// shadow cache entry
+	bool shadowCheck(const Ray &ray, float distance, int light);
+	// same check for sample of the light, answered from visibility if it holds the
+	// result and recorded in it otherwise (visibility may be NULL)
+	bool shadowCheck(const Ray &ray, float distance, int light, LightVisibility *visibility, int sample);
+	// renders the RenderCam view in one pass, waiting for it, and saves it to outputPath
+	void rayTrace();
+	// renders the framebuffer on the calling thread without saving it, in the
+	// passes of startRender() when progressive; returns false if cancelled
+	bool renderImage(bool progressive);
+	// starts a progressive render on a background thread and returns at once
+	// (cancels a render that is still running). Each pass shades one pixel per
+	// step x step block, halving the step from 8 down to 1, and the image is
+	// saved to outputPath after the last pass. The scene and shading settings
+	// must not change until the render finishes or is cancelled.
+	void startRender();
+	// stops the background render and waits for its thread to exit
+	void cancelRender();
+	// returns true while a render started by startRender() is running
+	bool isRendering() const { return rendering; }
+	// returns the pass the background render is on (1 to PROGRESSIVE_PASSES, then
+	// PROGRESSIVE_PASSES + 1 for the antialiasing pass)
+	int getRenderPass() const { return renderPass; }
+	// returns a counter that changes every time a tile is written to the image
+	unsigned long getFrameVersion() const { return frameVersion; }
+	// tonemaps the image as rendered so far into pixels (safe while a render is running)
+	void copyFrame(ofPixels &pixels);
+	// writes the framebuffer to an image file (see Framebuffer::save); returns false on failure
+	bool saveImage(const string &path);
+	// prints the statistics of the last render and writes its cost heatmap and tile
+	// schedule next to imagePath (newImage_cost.png and newImage_trace.json for
+	// newImage.png); does nothing in builds without RT_STATS
+	void saveProfile(const string &imagePath);
+	// draws the pixels of one tile of the RenderCam view to the image. With step > 1
+	// only one pixel per step x step block is shaded and fills its block; refine
+	// reuses the pixels already shaded by the previous pass (step * 2).
+	void renderTile(const Tile &tile, const ofColor &background, int step = 1, bool refine = false);
+	// adds antialiasing samples to the pixels of one tile whose 3x3 neighborhood in
+	// luminance (the resolved framebuffer, row by row from the top) has a contrast
+	// above aaThreshold, until their noise drops below it or maxPixelSamples is reached
+	void renderAdaptiveTile(const Tile &tile, const ofColor &background, const vector<float> &luminance);
+	// builds the acceleration structure over the scene (or refits it with refitBVH)
+	// and the light tree, and applies the thread settings; call once before renderRegion()
+	void prepareRender();
+	// builds lightTree over the current point, area and mesh lights
+	void buildLightTree();
+	// returns a hash of everything the G-buffer depends on: the image size, camera,
+	// scene generation, objects and their textures, materials other than their
+	// specular color, light positions and shapes and light sampling settings, but
+	// not the light intensities or Phong power
+	uint64_t gBufferKey() const;
+	// renders one region of the image into the framebuffer on the tile renderer,
+	// including the antialiasing pass (used by distributed render workers)
+	void renderRegion(const Tile &region);
+	// times the SceneBVH closest-hit render against the original renderer and
+	// against a brute force loop that tests every object and shades after every
+	// hit with the same shading, on the current scene
+	void benchmarkClosestHit();
+	// renders the current scene single threaded once per PixelOrder and prints the
+	// time and the cache and TLB misses of each (see PerfCounters) against the
+	// column order
+	void benchmarkPixelOrder();
+	// renders the current scene single threaded one stage at a time (all rays, then
+	// all intersections, then all shading) and saves the image to imagePath,
+	// returning the time spent in each stage (see benchmarkSuite.h)
+	RenderStageTimes measureStages(const string &imagePath);
+	// renders the current scene repeats times on the tile renderer without saving it;
+	// returns the fastest time in seconds
+	double timeRender(int repeats);
+
+	// set up one render camera to render image
+	RenderCam renderCam;
+	// linear float image the renders write to
+	Framebuffer framebuffer;
+	// turns the framebuffer into 8-bit images for the preview and saved files
+	ToneMap toneMap;
+	// path the rendered image is saved to
+	string outputPath = "newImage.png";
+	// color of pixels where no object is hit
+	ofColor background = ofColor::black;
+	// holds image to map to plane
+	ofImage planeTexture;
+	// every object of the scene in the order it was added (owned by the arenas below)
+	vector<SceneObject *> scene;
+	// storage of the scene's objects, one arena per type so objects of a type
+	// are contiguous in memory and all of them are freed with the scene
+	Arena<Sphere, 1024> spheres;
+	Arena<Plane, 16> planes;
+	Arena<Mesh, 16> meshes;
+	// materials of the scene, referred to by index (material 0 is the default)
+	vector<Material> materials = vector<Material>(1);
+	// floor of scene
+	Plane* floor = NULL;
+	// point lights of the scene
+	Arena<PointLight, 64> lights;
+	// Holds AreaLight instance;
+	AreaLight areaLight;
+	// obj file the area light was loaded from (empty if it has no vertices)
+	string areaLightFile;
+	// emissive meshes of the scene, shaded like the area light; they light the
+	// scene but are not SceneObjects, so they cast no shadows
+	Arena<AreaLight, 16> meshLights;
+	// every point light and area light cluster, rebuilt at the start of each render
+	LightTree lightTree;
+	// dimensions of the image to be rendered
+	int imageWidth = 1200;
+	int imageHeight = 800;
+	// dimensions of the textureImage
+	int textureWidth = 1000;
+	int textureHeight = 1000;
+	// acceleration structure over the scene, rebuilt at the start of each render
+	SceneBVH sceneBVH;
+	// refits sceneBVH to moved objects at the start of a render instead of
+	// rebuilding it, as long as no object was added or removed (sequence renders)
+	bool refitBVH = false;
+	// keyframed parameters of the scene (see sceneFile.h)
+	Animation animation;
+	// computes the light of the camera rays (see integrator.h); set before a render
+	std::unique_ptr<Integrator> integrator;
+	// low-discrepancy sequence of the samples integrators draw per pixel
+	SamplerType samplerType = SAMPLER_SOBOL;
+	// splits the image into tiles and renders them on a thread pool
+	TileRenderer tileRenderer;
+	// number of render threads (0 uses all hardware cores, 1 renders single threaded)
+	int renderThreads = 0;
+	// renders every tile on the same thread each time (for regression tests)
+	bool deterministicRender = false;
+	// order of the tiles of a render and of the pixels of a tile (see PixelOrder)
+	PixelOrder pixelOrder = PIXEL_ORDER_HILBERT;
+	// power of phong shading
+	float phongPower = 20;
+	// shadow rays per shaded point spent on the area light
+	int areaLightSamples = 16;
+	// picks area light clusters by their importance to the shaded point
+	// instead of by area alone (fewer samples wasted on far away triangles)
+	bool areaLightImportance = false;
+	// records the primary hits and shadow rays of each render (Whitted integrator
+	// only), so the next render re-shades them when only shading changed (see GBuffer)
+	bool useGBuffer = false;
+	// primary hits and shadow ray results of the last render
+	GBuffer gBuffer;
+	// scenes with more point, area and mesh lights than this pick their lights
+	// from lightTree, so the cost per shaded point stops growing with the light count
+	int lightTreeThreshold = 16;
+	// lights picked from lightTree per shaded point by the Whitted integrator
+	// (the path tracer picks one per bounce)
+	int lightTreeSamples = 8;
+	// lights whose unshadowed illumination (intensity / distance^2) at a shaded
+	// point is below this are skipped along with their shadow rays
+	float lightCutoff = 0.001f;
+	// tests the object that last blocked a light's shadow rays on this thread
+	// before traversing the scene (see ShadowCache)
+	bool useShadowCache = true;
+	// bounces of reflected and refracted rays at most (0 shades direct light only),
+	// which is also the number of bounces of the path tracer
+	int maxRayDepth = 5;
+	// bounces after which secondary rays are terminated by Russian roulette
+	int rouletteDepth = 2;
+	// samples per pixel at most in the adaptive antialiasing pass (1 turns the pass off)
+	int maxPixelSamples = 1;
+	// relative luminance contrast above which a pixel gets more samples, and
+	// relative standard error at which its sampling stops
+	float aaThreshold = 0.1f;
+	// when set, shadowCheck() times every shadow ray into it (single threaded benchmarks only)
+	RenderStageTimes *stageTimes = NULL;
+	// counters, pixel costs and tile schedule of the last render (builds with RT_STATS only)
+	RenderProfile profile;
+	// saves the profile next to the image after every render (see saveProfile())
+	bool writeProfile = false;
+	// number of passes of a progressive render (block sizes 8, 4, 2 and 1)
+	static const int PROGRESSIVE_PASSES = 4;
+
+private:
+	// renders every pass from firstStep down to 1; returns false if cancelled
+	bool renderPasses(int firstStep);
+	// returns the linear color seen through the focus plane point at offset from
+	// the camera (see RenderCam::focusOffset) from the lens point lens, computed by
+	// the integrator with samples from sampler; footprint is the pixel spacing used
+	// for texture filtering. With deferred, secondary rays may be added to it for
+	// pixel instead of being traced (see Integrator::radiance).
+	glm::vec3 tracePixel(const glm::vec3 &offset, glm::vec2 lens, float footprint, const glm::vec3 &backgroundColor,
+		PixelSampler &sampler, vector<SecondaryRay> *deferred = NULL, int pixel = 0);
+	// returns the color of a pixel's center sample like tracePixel() with the Whitted
+	// integrator, recording its hit and shadow rays in the G-buffer at pixel (x, y)
+	glm::vec3 recordPixel(const glm::vec3 &offset, glm::vec2 lens, float footprint, const glm::vec3 &backgroundColor,
+		int x, int y, vector<SecondaryRay> *deferred, int pixel);
+	// shades the pixels of one tile again from the G-buffer, tracing only the
+	// pixels whose hits spawn secondary rays and the shadow rays it lacks
+	void reshadeTile(const Tile &tile, const ofColor &background);
+	// copies the luminance of an area of the framebuffer into luminanceSnapshot
+	void snapshotLuminance(const Tile &area);
+	// adds phong shading from one area light, whose shadow rays use the given
+	// shadow cache slot (see shadowCheck)
+	glm::vec3 phongAreaLight(const AreaLight &light, int slot, const Ray &ray, const glm::vec3 &point, const glm::vec3 &normal,
+		const glm::vec3 &diffuse, const glm::vec3 &specular, float power, LightVisibility *visibility);
+
+	std::thread renderThread;					// runs the render started by startRender()
+	std::atomic<bool> rendering{ false };		// true while renderThread is rendering
+	std::atomic<bool> cancelRequested{ false };	// asks the tiles of the current render to stop
+	std::atomic<int> renderPass{ 0 };			// pass the current render is on
+	std::atomic<unsigned long> frameVersion{ 0 };	// incremented after every tile written to the image
+	vector<float> luminanceSnapshot;			// one sample image seen by the antialiasing pass
+	std::atomic<long> adaptivePixels{ 0 };		// pixels refined by the last antialiasing pass
+	std::atomic<long> adaptiveSamples{ 0 };		// samples added by the last antialiasing pass
+	unsigned long sceneGeneration = 0;			// incremented whenever a scene, mesh or area light is
+												//  loaded or the scene is cleared (see gBufferKey())
+	std::mutex frameMutex;						// guards framebuffer pixels between tile writes and copyFrame()
+};
@@ -0,0 +1,500 @@
+// This file provides the implementation of the headless render command line
+// - author: Jared Bechthold
+
+#include "renderCli.h"
+#include "sceneFile.h"
+#include "benchmarkSuite.h"
+#include "selfTest.h"
+#include "distributedRender.h"
+#include "integrator.h"
+#include <chrono>
+
+//--------------------------------------------------------------
+// Prints the options understood by parseRenderOptions
+void printRenderUsage(const char *program) {
+	cout << "usage: " << program << " [options]" << endl
+		<< "  --width <pixels>         image width (default 1200)" << endl
+		<< "  --height <pixels>        image height (default 800)" << endl
+		<< "  --scene <file>           scene file, or an .obj mesh added to the default scene" << endl
+		<< "  --no-cache               parse the scene file even if its cache is up to date" << endl
+		<< "  --area-light <file.obj>  area light mesh" << endl
+		<< "  --texture <image>        floor texture (default textureImg.jpg)" << endl
+		<< "  --output <image>         output file (default newImage.png); .pfm and .exr keep linear floats" << endl
+		<< "  --tonemap <operator>     clamp, reinhard or aces (default clamp)" << endl
+		<< "  --exposure <stops>       exposure applied before the tonemap (default 0)" << endl
+		<< "  --gamma <value>          encoding gamma of 8-bit images (default 1)" << endl
+		<< "  --threads <count>        render threads, 0 = all cores (default 0)" << endl
+		<< "  --deterministic          render every tile on the same thread each time" << endl
+		<< "  --fov <degrees>          vertical field of view of the camera, between 0 and 180 (default: the scene's)" << endl
+		<< "  --power <value>          Phong power (default 20)" << endl
+		<< "  --intensity <value>      point light intensity (default 10)" << endl
+		<< "  --area-intensity <value> area light intensity (default 500)" << endl
+		<< "  --area-samples <count>   shadow rays per shaded point for the area light (default 16)" << endl
+		<< "  --light-importance       pick area light clusters by importance instead of area" << endl
+		<< "  --light-cutoff <value>   skip lights whose illumination at a point is below value (default 0.001)" << endl
+		<< "  --no-shadow-cache        trace every shadow ray through the BVH without testing the last occluder" << endl
+		<< "  --light-tree <count>     scenes with more lights than count pick them from a light tree (default 16)" << endl
+		<< "  --light-picks <count>    lights picked from the light tree per shaded point (default 8)" << endl
+		<< "  --pixel-order <name>     order of tiles and pixels: hilbert, morton or columns (default hilbert)" << endl
+		<< "  --integrator <name>      whitted (Phong, mirrors and glass) or path (path tracing) (default whitted)" << endl
+		<< "  --sampler <name>         samples of the path tracer: sobol or bluenoise (default sobol)" << endl
+		<< "  --max-depth <count>      bounces of reflected and refracted rays at most (default 5)" << endl
+		<< "  --roulette-depth <count> bounces after which Russian roulette ends rays (default 2)" << endl
+		<< "  --aa-samples <count>     samples per pixel at most with adaptive antialiasing (default 1 = off)" << endl
+		<< "  --aa-threshold <value>   relative contrast that gets a pixel more samples (default 0.1)" << endl
+		<< "  --stats                  print ray and intersection counts and write <output>_cost.png (time per" << endl
+		<< "                           pixel) and <output>_trace.json (tile schedule); needs a build with RT_STATS" << endl
+		<< "  --frame <number>         frame of the scene's animation to render (default 0)" << endl
+		<< "  --frames <count>         frames of the sequence to render (default: up to the scene's last frame);" << endl
+		<< "                           '#' in --output is the frame number, '#' in --scene loads a file per frame" << endl
+		<< "distributed rendering:" << endl
+		<< "  --coordinator <port>     hand tiles to workers that connect to port (0 = any free port)" << endl
+		<< "  --bind <address>         IPv4 address the coordinator listens on (default 127.0.0.1, this machine" << endl
+		<< "                           only; 0.0.0.0 lets workers on other machines connect)" << endl
+		<< "  --workers <count>        start count worker processes on this machine" << endl
+		<< "  --worker <host:port>     render tiles for the coordinator at host:port" << endl
+		<< "benchmark suite:" << endl
+		<< "  --benchmark              render the reference scenes and report timings" << endl
+		<< "  --benchmark-json <file>  JSON report (default benchmark.json)" << endl
+		<< "  --assets <dir>           directory holding texture_images/ and area_lights/ (default .)" << endl
+		<< "  --repeat <count>         timed renders per scene (default 3)" << endl
+		<< "  --filter <text>          only scenes whose name contains text" << endl
+		<< "  --benchmark-order        render the scene single threaded in every pixel order and compare their" << endl
+		<< "                           times and cache misses (hardware counters on Linux)" << endl
+		<< "  --benchmark-closest-hit  render the scene single threaded with the original renderer, brute force" << endl
+		<< "                           over every object (today's shading) and the BVH closest-hit query, and compare" << endl
+		<< "self tests:" << endl
+		<< "  --self-test              run the parser and render self tests (--filter selects them by name);" << endl
+		<< "                           the exit code is the number of failures" << endl;
+}
+
+//--------------------------------------------------------------
+// Reads "--name value" pairs and flags from the command line
+bool parseRenderOptions(int argc, char *argv[], RenderOptions &options, string &error) {
+	options.program = argv[0];
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		// flags without a value
+		if (arg == "--deterministic") {
+			options.deterministic = true;
+			continue;
+		}
+		if (arg == "--benchmark") {
+			options.benchmark = true;
+			continue;
+		}
+		if (arg == "--light-importance") {
+			options.lightImportance = true;
+			continue;
+		}
+		if (arg == "--no-cache") {
+			options.useCache = false;
+			continue;
+		}
+		if (arg == "--no-shadow-cache") {
+			options.shadowCache = false;
+			continue;
+		}
+		if (arg == "--stats") {
+			options.stats = true;
+			continue;
+		}
+		if (arg == "--benchmark-order") {
+			options.orderBenchmark = true;
+			continue;
+		}
+		if (arg == "--benchmark-closest-hit") {
+			options.closestHitBenchmark = true;
+			continue;
+		}
+		if (arg == "--self-test") {
+			options.selfTest = true;
+			continue;
+		}
+		if (arg == "--headless") continue;
+
+		// every other option takes a value
+		if (i + 1 >= argc) {
+			error = "missing value for " + arg;
+			return false;
+		}
+		string value = argv[++i];
+		try {
+			if (arg == "--width") options.width = stoi(value);
+			else if (arg == "--height") options.height = stoi(value);
+			else if (arg == "--scene") options.scenePath = value;
+			else if (arg == "--area-light") options.areaLightPath = value;
+			else if (arg == "--texture") options.texturePath = value;
+			else if (arg == "--output" || arg == "-o") options.outputPath = value;
+			else if (arg == "--threads") options.threads = stoi(value);
+			else if (arg == "--fov") {
+				options.fov = stof(value);
+				if (!(options.fov > 0 && options.fov < 180)) {
+					error = "fov must be between 0 and 180 degrees";
+					return false;
+				}
+			}
+			else if (arg == "--power") options.phongPower = stof(value);
+			else if (arg == "--intensity") options.pointIntensity = stof(value);
+			else if (arg == "--area-intensity") options.areaIntensity = stof(value);
+			else if (arg == "--area-samples") options.areaSamples = stoi(value);
+			else if (arg == "--light-cutoff") options.lightCutoff = stof(value);
+			else if (arg == "--integrator") options.integrator = value;
+			else if (arg == "--sampler") options.sampler = value;
+			else if (arg == "--light-tree") options.lightTreeThreshold = stoi(value);
+			else if (arg == "--light-picks") options.lightTreeSamples = stoi(value);
+			else if (arg == "--pixel-order") options.pixelOrder = value;
+			else if (arg == "--max-depth") options.maxDepth = stoi(value);
+			else if (arg == "--roulette-depth") options.rouletteDepth = stoi(value);
+			else if (arg == "--aa-samples") options.pixelSamples = stoi(value);
+			else if (arg == "--aa-threshold") options.aaThreshold = stof(value);
+			else if (arg == "--frame") options.frame = stoi(value);
+			else if (arg == "--frames") options.frames = stoi(value);
+			else if (arg == "--coordinator") options.coordinatorPort = stoi(value);
+			else if (arg == "--bind") options.bindAddress = value;
+			else if (arg == "--workers") options.localWorkers = stoi(value);
+			else if (arg == "--worker") options.workerAddress = value;
+			else if (arg == "--tonemap") options.toneMap = value;
+			else if (arg == "--exposure") options.exposure = stof(value);
+			else if (arg == "--gamma") options.gamma = stof(value);
+			else if (arg == "--benchmark-json") options.benchmarkJson = value;
+			else if (arg == "--assets") options.assetsPath = value;
+			else if (arg == "--repeat") options.benchmarkRepeats = stoi(value);
+			else if (arg == "--filter") options.benchmarkFilter = value;
+			else {
+				error = "unknown option " + arg;
+				return false;
+			}
+		}
+		catch (const std::exception &) {
+			error = "invalid value '" + value + "' for " + arg;
+			return false;
+		}
+	}
+	ToneMapOperator op;
+	if (!ToneMap::parseOperator(options.toneMap, op)) {
+		error = "unknown tonemap " + options.toneMap;
+		return false;
+	}
+	if (options.gamma <= 0) {
+		error = "gamma must be positive";
+		return false;
+	}
+	if (options.pixelSamples < 1 || options.aaThreshold <= 0) {
+		error = "antialiasing needs at least 1 sample and a positive threshold";
+		return false;
+	}
+	if (options.frame < 0 || options.frames < 0) {
+		error = "frame numbers must be positive";
+		return false;
+	}
+	if (options.lightCutoff < 0) {
+		error = "light cutoff must not be negative";
+		return false;
+	}
+	std::unique_ptr<Integrator> integrator(createIntegrator(options.integrator));
+	if (!integrator) {
+		error = "unknown integrator " + options.integrator;
+		return false;
+	}
+	if (options.sampler != "sobol" && options.sampler != "bluenoise") {
+		error = "unknown sampler " + options.sampler;
+		return false;
+	}
+	PixelOrder order;
+	if (!parsePixelOrder(options.pixelOrder, order)) {
+		error = "unknown pixel order " + options.pixelOrder;
+		return false;
+	}
+	if (options.stats && !RENDER_STATS) {
+		error = "--stats needs a build with RT_STATS defined";
+		return false;
+	}
+	if (options.lightTreeThreshold < 0 || options.lightTreeSamples < 1) {
+		error = "light tree threshold must not be negative and picks must be positive";
+		return false;
+	}
+	if (options.maxDepth < 0 || options.rouletteDepth < 0) {
+		error = "ray depths must not be negative";
+		return false;
+	}
+	if (options.width < 0 || options.height < 0) {
+		error = "image size must be positive";
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Replaces every '#' of a path with the frame number padded to 4 digits
+static string framePath(const string &pattern, int frame) {
+	string number = ofToString(frame, 4, '0');
+	string path;
+	for (char c : pattern) {
+		if (c == '#') path += number;
+		else path += c;
+	}
+	return path;
+}
+
+//--------------------------------------------------------------
+// Adds "_#" before the extension of an output path without a frame number
+static string sequencePath(const string &path) {
+	if (path.find('#') != string::npos) return path;
+	size_t dot = path.rfind('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == string::npos || (slash != string::npos && dot < slash)) return path + "_#";
+	return path.substr(0, dot) + "_#" + path.substr(dot);
+}
+
+//--------------------------------------------------------------
+// Builds the scene and applies the render settings. Paths given on the
+// command line are relative to the working directory, not the data folder.
+bool setupHeadlessScene(const RenderOptions &options, RayTracer &rayTracer, string &error) {
+	// scene setup: scene files bring their own settings, which the command
+	// line only overrides when an option is given
+	string scenePath = options.scenePath.empty() ? "" : ofFilePath::getAbsolutePath(options.scenePath, false);
+	if (!scenePath.empty() && ofToLower(ofFilePath::getFileExt(scenePath)) != "obj") {
+		if (!SceneFile::load(scenePath, rayTracer, error, options.useCache)) {
+			error = "could not load scene " + error;
+			return false;
+		}
+		for (PointLight &light : rayTracer.lights) {
+			if (options.pointIntensity >= 0) light.setIntensity(options.pointIntensity);
+		}
+		if (options.areaIntensity >= 0) rayTracer.areaLight.setIntensity(options.areaIntensity);
+	}
+	else {
+		if (options.texturePath.empty()) rayTracer.setupDefaultScene();
+		else rayTracer.setupDefaultScene(ofFilePath::getAbsolutePath(options.texturePath, false));
+		if (!scenePath.empty() && !rayTracer.loadMesh(scenePath)) {
+			error = "could not open scene " + options.scenePath;
+			return false;
+		}
+		rayTracer.setLightIntensities(options.pointIntensity >= 0 ? options.pointIntensity : 10,
+			options.areaIntensity >= 0 ? options.areaIntensity : 500);
+		rayTracer.phongPower = 20;
+	}
+	if (!options.areaLightPath.empty() && !rayTracer.loadAreaLight(ofFilePath::getAbsolutePath(options.areaLightPath, false))) {
+		error = "could not open area light " + options.areaLightPath;
+		return false;
+	}
+	if (options.phongPower >= 0) rayTracer.phongPower = options.phongPower;
+	if (options.fov > 0) rayTracer.renderCam.fov = options.fov;
+	ToneMap::parseOperator(options.toneMap, rayTracer.toneMap.op);
+	rayTracer.toneMap.exposure = options.exposure;
+	rayTracer.toneMap.gamma = options.gamma;
+	rayTracer.areaLightSamples = options.areaSamples;
+	rayTracer.areaLightImportance = options.lightImportance;
+	rayTracer.lightCutoff = options.lightCutoff;
+	rayTracer.useShadowCache = options.shadowCache;
+	rayTracer.lightTreeThreshold = options.lightTreeThreshold;
+	rayTracer.lightTreeSamples = options.lightTreeSamples;
+	rayTracer.integrator.reset(createIntegrator(options.integrator));
+	rayTracer.samplerType = options.sampler == "bluenoise" ? SAMPLER_BLUE_NOISE : SAMPLER_SOBOL;
+	rayTracer.maxRayDepth = options.maxDepth;
+	rayTracer.rouletteDepth = options.rouletteDepth;
+	rayTracer.maxPixelSamples = options.pixelSamples;
+	rayTracer.aaThreshold = options.aaThreshold;
+	rayTracer.writeProfile = options.stats;
+	parsePixelOrder(options.pixelOrder, rayTracer.pixelOrder);
+	if (options.width > 0 || options.height > 0) {
+		rayTracer.setImageSize(options.width > 0 ? options.width : rayTracer.imageWidth,
+			options.height > 0 ? options.height : rayTracer.imageHeight);
+	}
+	rayTracer.renderThreads = options.threads;
+	rayTracer.tileRenderer.setThreadCount(options.threads);
+	rayTracer.deterministicRender = options.deterministic;
+	rayTracer.outputPath = ofFilePath::getAbsolutePath(options.outputPath, false);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Only the animation moves between frames of the same scene, so the
+// meshes, textures and BVH of the previous frame are kept and the BVH is
+// refit instead of rebuilt
+bool setupFrame(const RenderOptions &options, FrameScene &scene, string &error) {
+	vector<string> arguments = sceneArguments(options);
+	if (!scene.rayTracer || scene.arguments != arguments) {
+		scene.rayTracer.reset(new RayTracer());
+		if (!setupHeadlessScene(options, *scene.rayTracer, error)) {
+			scene.rayTracer.reset();
+			return false;
+		}
+		scene.arguments = arguments;
+		scene.rayTracer->refitBVH = true;
+	}
+	scene.rayTracer->animation.apply(*scene.rayTracer, options.frame);
+	scene.rayTracer->outputPath = ofFilePath::getAbsolutePath(options.outputPath, false);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns the options that affect the rendered samples as command line
+// arguments, with absolute paths, so a worker can rebuild the same scene
+vector<string> sceneArguments(const RenderOptions &options) {
+	vector<string> arguments;
+	auto add = [&](const string &name, const string &value) {
+		arguments.push_back(name);
+		arguments.push_back(value);
+	};
+	if (options.width > 0) add("--width", ofToString(options.width));
+	if (options.height > 0) add("--height", ofToString(options.height));
+	if (!options.scenePath.empty()) add("--scene", ofFilePath::getAbsolutePath(options.scenePath, false));
+	if (!options.useCache) arguments.push_back("--no-cache");
+	if (!options.areaLightPath.empty()) add("--area-light", ofFilePath::getAbsolutePath(options.areaLightPath, false));
+	if (!options.texturePath.empty()) add("--texture", ofFilePath::getAbsolutePath(options.texturePath, false));
+	if (options.fov > 0) add("--fov", ofToString(options.fov));
+	if (options.phongPower >= 0) add("--power", ofToString(options.phongPower));
+	if (options.pointIntensity >= 0) add("--intensity", ofToString(options.pointIntensity));
+	if (options.areaIntensity >= 0) add("--area-intensity", ofToString(options.areaIntensity));
+	add("--area-samples", ofToString(options.areaSamples));
+	if (options.lightImportance) arguments.push_back("--light-importance");
+	add("--light-cutoff", ofToString(options.lightCutoff));
+	add("--light-tree", ofToString(options.lightTreeThreshold));
+	add("--light-picks", ofToString(options.lightTreeSamples));
+	add("--pixel-order", options.pixelOrder);
+	add("--integrator", options.integrator);
+	add("--sampler", options.sampler);
+	add("--max-depth", ofToString(options.maxDepth));
+	add("--roulette-depth", ofToString(options.rouletteDepth));
+	add("--aa-samples", ofToString(options.pixelSamples));
+	add("--aa-threshold", ofToString(options.aaThreshold));
+	return arguments;
+}
+
+//--------------------------------------------------------------
+// Builds the scene of the first frame, then for every frame moves it to
+// the frame, renders it, on this machine or on the workers of a
+// RenderCoordinator, and writes the image
+int runHeadlessRender(const RenderOptions &options) {
+	typedef std::chrono::steady_clock Clock;
+	bool distributed = options.coordinatorPort >= 0 || options.localWorkers > 0;
+	RenderCoordinator coordinator;
+	if (distributed) {
+		DistributedOptions settings;
+		settings.port = std::max(options.coordinatorPort, 0);
+		settings.bindAddress = options.bindAddress;
+		settings.localWorkers = options.localWorkers;
+		settings.workerProgram = options.program;
+		string error;
+		if (!coordinator.start(settings, error)) {
+			cerr << error << endl;
+			return 1;
+		}
+	}
+
+	FrameScene scene;
+	int frames = options.frames;
+	string outputPattern = options.outputPath;
+	for (int i = 0; frames == 0 || i < frames; i++) {
+		// '#' in the scene and output paths stands for the frame number
+		RenderOptions frameOptions = options;
+		frameOptions.frame = options.frame + i;
+		frameOptions.scenePath = framePath(options.scenePath, frameOptions.frame);
+		frameOptions.outputPath = framePath(outputPattern, frameOptions.frame);
+		string error;
+		if (!setupFrame(frameOptions, scene, error)) {
+			cerr << error << endl;
+			return 1;
+		}
+		RayTracer &rayTracer = *scene.rayTracer;
+		if (frames == 0) {
+			// the length of the sequence comes from the scene
+			frames = std::max(rayTracer.animation.frameCount - options.frame, 1);
+			if (frames > 1) {
+				outputPattern = sequencePath(options.outputPath);
+				rayTracer.outputPath = ofFilePath::getAbsolutePath(framePath(outputPattern, frameOptions.frame), false);
+			}
+		}
+		if (frames > 1) cout << "frame " << frameOptions.frame << ": ";
+
+		// render and save
+		cout << "rendering " << rayTracer.imageWidth << "x" << rayTracer.imageHeight;
+		if (distributed) cout << " on the workers..." << endl;
+		else cout << " on " << rayTracer.tileRenderer.getThreadCount() << " threads..." << endl;
+		Clock::time_point start = Clock::now();
+		if (distributed) {
+			vector<string> job = sceneArguments(frameOptions);
+			job.push_back("--frame");
+			job.push_back(ofToString(frameOptions.frame));
+			coordinator.renderFrame(rayTracer, job);
+			if (!rayTracer.saveImage(rayTracer.outputPath)) return 1;
+		}
+		else {
+			rayTracer.rayTrace();
+		}
+		cout << "done in " << std::chrono::duration<double>(Clock::now() - start).count() << " s, wrote "
+			<< rayTracer.outputPath << endl;
+	}
+	return 0;
+}
+
+//--------------------------------------------------------------
+// Connects to the coordinator given by "--worker host:port" and builds the
+// scene of each job with the same code as a local render
+static int runWorker(const RenderOptions &options) {
+	size_t colon = options.workerAddress.rfind(':');
+	int port = colon == string::npos ? 0 : atoi(options.workerAddress.c_str() + colon + 1);
+	if (port <= 0) {
+		cerr << "--worker needs host:port" << endl;
+		return 2;
+	}
+	// consecutive frames of a sequence reuse the scene
+	FrameScene scene;
+	return runRenderWorker(options.workerAddress.substr(0, colon), port, options.threads,
+		[&scene](const vector<string> &job, string &error) -> RayTracer * {
+			vector<char *> argv(1, (char *)"worker");
+			for (const string &argument : job) argv.push_back((char *)argument.c_str());
+			RenderOptions jobOptions;
+			if (!parseRenderOptions((int)argv.size(), argv.data(), jobOptions, error) ||
+				!setupFrame(jobOptions, scene, error)) return NULL;
+			return scene.rayTracer.get();
+		});
+}
+
+//--------------------------------------------------------------
+// Entry point of the headless renderer
+int runRenderCli(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]) == "--help" || string(argv[i]) == "-h") {
+			printRenderUsage(argv[0]);
+			return 0;
+		}
+	}
+	RenderOptions options;
+	string error;
+	if (!parseRenderOptions(argc, argv, options, error)) {
+		cerr << error << endl;
+		printRenderUsage(argv[0]);
+		return 2;
+	}
+	// initializes openFrameworks' file and image utilities without opening a window
+	ofInit();
+	if (options.selfTest) return runSelfTests(options.benchmarkFilter);
+	if (options.benchmark) {
+		BenchmarkOptions benchmark;
+		if (options.width > 0) benchmark.width = options.width;
+		if (options.height > 0) benchmark.height = options.height;
+		benchmark.threads = options.threads;
+		benchmark.repeats = options.benchmarkRepeats;
+		benchmark.assetsPath = ofFilePath::getAbsolutePath(options.assetsPath, false);
+		benchmark.jsonPath = options.benchmarkJson.empty() ? "" : ofFilePath::getAbsolutePath(options.benchmarkJson, false);
+		benchmark.imageDirectory = ofFilePath::getAbsolutePath("benchmark", false);
+		benchmark.filter = options.benchmarkFilter;
+		return runBenchmarkSuite(benchmark);
+	}
+	if (options.orderBenchmark || options.closestHitBenchmark) {
+		// the scene of the other options, at the first frame
+		FrameScene scene;
+		if (!setupFrame(options, scene, error)) {
+			cerr << error << endl;
+			return 1;
+		}
+		if (options.orderBenchmark) scene.rayTracer->benchmarkPixelOrder();
+		if (options.closestHitBenchmark) scene.rayTracer->benchmarkClosestHit();
+		return 0;
+	}
+	if (!options.workerAddress.empty()) return runWorker(options);
+	return runHeadlessRender(options);
+}
@@ -0,0 +1,87 @@
+// This file provides the command line interface of the headless renderer,
+// which renders a scene to an image file without a window or GL context
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "rayTracer.h"
+#include <memory>
+
+//  Settings of a headless render, filled in from the command line
+//
+class RenderOptions {
+public:
+	int width = 0;							// width of the rendered image (0 keeps the scene's, 1200 by default)
+	int height = 0;							// height of the rendered image (0 keeps the scene's, 800 by default)
+	string scenePath;						// scene file, or OBJ mesh added to the default scene (optional)
+	string areaLightPath;					// OBJ file used as the area light (optional)
+	string texturePath;						// floor texture (empty uses textureImg.jpg from the data folder)
+	string outputPath = "newImage.png";		// image file written after the render
+	int threads = 0;						// render threads (0 = all cores)
+	bool deterministic = false;				// renders every tile on the same thread each time
+	bool useCache = true;					// reads and writes the binary cache of scene files
+	float fov = 0;							// vertical field of view in degrees of the camera (0 keeps the scene's)
+	float phongPower = -1;					// negative values keep the scene's settings; the default
+	float pointIntensity = -1;				//  scene uses the GUI slider defaults (20, 10 and 500)
+	float areaIntensity = -1;
+	int areaSamples = 16;					// shadow rays per shaded point for the area light
+	bool lightImportance = false;			// picks area light clusters by importance
+	float lightCutoff = 0.001f;				// illumination below which a light is skipped at a point
+	bool shadowCache = true;				// tests the last occluder of each light first
+	int lightTreeThreshold = 16;			// light count above which lights are picked from the light tree
+	int lightTreeSamples = 8;				// lights picked per shaded point from the light tree
+	string pixelOrder = "hilbert";			// order of the tiles and of the pixels of a tile (see PixelOrder)
+	string integrator = "whitted";			// integrator of the render (see createIntegrator)
+	string sampler = "sobol";				// sequence of the integrator's samples: sobol or bluenoise
+	int maxDepth = 5;						// bounces of reflected and refracted rays (or path vertices) at most
+	int rouletteDepth = 2;					// bounces after which Russian roulette ends rays
+	int pixelSamples = 1;					// samples per pixel at most with adaptive antialiasing (1 = off)
+	float aaThreshold = 0.1f;				// contrast and noise threshold of adaptive antialiasing
+	bool stats = false;						// writes the render statistics, cost heatmap and tile trace (RT_STATS builds)
+	string toneMap = "clamp";				// tonemap operator: clamp, reinhard or aces
+	float exposure = 0;						// exposure in stops applied before the tonemap
+	float gamma = 1;						// encoding gamma of 8-bit output
+	int frame = 0;							// first (or only) frame of the scene's animation rendered
+	int frames = 0;							// frames rendered (0 = the rest of the scene's sequence); '#' in
+											//  the output path is the frame number, '#' in the scene path
+											//  loads one scene file per frame
+	int coordinatorPort = -1;				// port the coordinator listens on (negative renders locally)
+	string bindAddress = "127.0.0.1";		// address the coordinator listens on (0.0.0.0 accepts remote workers)
+	int localWorkers = 0;					// worker processes started by the coordinator
+	string workerAddress;					// host:port of the coordinator this process works for
+	string program;							// path of the renderer (argv[0]), run for local workers
+	bool benchmark = false;					// runs the benchmark suite instead of rendering
+	string benchmarkJson = "benchmark.json";	// JSON report of the benchmark suite
+	string assetsPath = ".";				// directory holding texture_images/ and area_lights/
+	int benchmarkRepeats = 3;				// timed renders per benchmark scene
+	string benchmarkFilter;					// only benchmark scenes whose name contains this text
+	bool orderBenchmark = false;			// compares the pixel orders on the scene instead of rendering
+	bool closestHitBenchmark = false;		// compares the BVH closest hits with brute force and the original renderer instead of rendering
+	bool selfTest = false;					// runs the self tests (filtered by benchmarkFilter) instead of rendering
+};
+
+// parses the command line into options; returns false and sets error on bad arguments
+bool parseRenderOptions(int argc, char *argv[], RenderOptions &options, string &error);
+// prints the command line usage
+void printRenderUsage(const char *program);
+// builds the scene described by options into rayTracer and applies the render
+// settings; returns false and sets error if a file cannot be loaded
+bool setupHeadlessScene(const RenderOptions &options, RayTracer &rayTracer, string &error);
+// returns the command line arguments that rebuild the scene and sampling
+// settings of options (used as the job of distributed render workers)
+vector<string> sceneArguments(const RenderOptions &options);
+// renders with the given options; returns the process exit code
+int runHeadlessRender(const RenderOptions &options);
+//  Scene of a sequence, kept from one frame to the next
+//
+struct FrameScene {
+	std::unique_ptr<RayTracer> rayTracer;	// scene of the last frame (NULL before the first)
+	vector<string> arguments;				// sceneArguments() it was built from
+};
+
+// builds the scene of options into scene, reusing the one it holds if it was
+// built from the same scene arguments (only the frame differs), and moves it
+// to options.frame; returns false and sets error on failure
+bool setupFrame(const RenderOptions &options, FrameScene &scene, string &error);
+// parses the command line and renders; returns the process exit code
+int runRenderCli(int argc, char *argv[]);
@@ -0,0 +1,192 @@
+// This file provides the implementation of the render instrumentation
+// - author: Jared Bechthold
+
+#include "renderStats.h"
+#include "ofMain.h"
+#include <algorithm>
+
+// counters of every thread that counted something; a deque keeps their addresses
+// stable, and threads that exit leave theirs behind to be summed
+static std::mutex registryMutex;
+static std::deque<RenderCounters> registry;
+
+//--------------------------------------------------------------
+// Adds every count, growing the per-light counts to the longer list
+void RenderCounters::add(const RenderCounters &other) {
+	primaryRays += other.primaryRays;
+	secondaryRays += other.secondaryRays;
+	pathRays += other.pathRays;
+	shadowRays += other.shadowRays;
+	shadowBlocked += other.shadowBlocked;
+	shadowCacheHits += other.shadowCacheHits;
+	shadowRecalled += other.shadowRecalled;
+	spherePackets += other.spherePackets;
+	planePackets += other.planePackets;
+	triangles += other.triangles;
+	otherObjects += other.otherObjects;
+	bvhNodes += other.bvhNodes;
+	bvhLeaves += other.bvhLeaves;
+	if (other.lightShadowRays.size() > lightShadowRays.size()) {
+		lightShadowRays.resize(other.lightShadowRays.size(), 0);
+		lightBlocked.resize(other.lightBlocked.size(), 0);
+	}
+	for (size_t i = 0; i < other.lightShadowRays.size(); i++) {
+		lightShadowRays[i] += other.lightShadowRays[i];
+		lightBlocked[i] += other.lightBlocked[i];
+	}
+}
+
+//--------------------------------------------------------------
+// Called once per thread, the first time it counts
+RenderCounters *registerThreadCounters() {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	registry.emplace_back();
+	return &registry.back();
+}
+
+//--------------------------------------------------------------
+// The render threads are idle between renders, and the pool hands their
+// finished tasks over under its lock, so their counts are visible here
+RenderCounters totalCounters() {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	RenderCounters total;
+	for (const RenderCounters &counters : registry) {
+		total.add(counters);
+	}
+	return total;
+}
+
+//--------------------------------------------------------------
+// Replaces every thread's counters with zeroes in place
+void resetCounters() {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (RenderCounters &counters : registry) {
+		counters = RenderCounters();
+	}
+}
+
+//--------------------------------------------------------------
+// Clears the costs and the schedule and zeroes the counters
+void RenderProfile::start(int width, int height) {
+	if (!RENDER_STATS) return;
+	this->width = width;
+	this->height = height;
+	pixelCosts.assign((size_t)width * height, 0);
+	tiles.clear();
+	resetCounters();
+	counters = RenderCounters();
+	startTime = statClock();
+	endTime = startTime;
+}
+
+//--------------------------------------------------------------
+// Takes the counts of the render's threads
+void RenderProfile::finish() {
+	if (!RENDER_STATS) return;
+	counters = totalCounters();
+	endTime = statClock();
+}
+
+//--------------------------------------------------------------
+// Maps cost to color on a ramp from black over purple, red and orange to
+// white. The scale ends at the 99th percentile, so a few very slow pixels
+// do not turn the rest of the image black.
+bool RenderProfile::saveHeatmap(const std::string &path) const {
+	static const glm::vec3 RAMP[] = { glm::vec3(0, 0, 0), glm::vec3(0.34f, 0.06f, 0.43f), glm::vec3(0.87f, 0.32f, 0.23f),
+		glm::vec3(0.99f, 0.75f, 0.15f), glm::vec3(1, 1, 1) };
+	static const int STOPS = sizeof(RAMP) / sizeof(RAMP[0]);
+	if (pixelCosts.empty()) return false;
+
+	vector<float> sorted(pixelCosts);
+	size_t percentile = (sorted.size() - 1) * 99 / 100;
+	std::nth_element(sorted.begin(), sorted.begin() + percentile, sorted.end());
+	float scale = sorted[percentile] > 0 ? sorted[percentile] : 1;
+
+	ofPixels pixels;
+	pixels.allocate(width, height, OF_PIXELS_RGB);
+	unsigned char *data = pixels.getData();
+	for (size_t i = 0; i < pixelCosts.size(); i++) {
+		float position = std::min(pixelCosts[i] / scale, 1.0f) * (STOPS - 1);
+		int stop = std::min((int)position, STOPS - 2);
+		glm::vec3 color = glm::mix(RAMP[stop], RAMP[stop + 1], position - stop) * 255.0f + glm::vec3(0.5f);
+		data[3 * i] = (unsigned char)color.x;
+		data[3 * i + 1] = (unsigned char)color.y;
+		data[3 * i + 2] = (unsigned char)color.z;
+	}
+	return ofSaveImage(pixels, path);
+}
+
+//--------------------------------------------------------------
+// Writes complete ("X") events in microseconds from the start of the
+// render, with the tile bounds as arguments and a named row per worker
+bool RenderProfile::saveTrace(const std::string &path) const {
+	ofstream file(path);
+	if (!file) return false;
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	int workers = 0;
+	bool first = true;
+	for (const TileEvent &tile : tiles) {
+		file << (first ? "\n" : ",\n") << "{\"name\": \"tile " << tile.x0 << "," << tile.y0 << "\", \"cat\": \"" << tile.pass
+			<< "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tile.worker
+			<< ", \"ts\": " << (long long)((tile.begin - startTime) * 1e6)
+			<< ", \"dur\": " << std::max((long long)((tile.end - tile.begin) * 1e6), 1LL)
+			<< ", \"args\": {\"x0\": " << tile.x0 << ", \"y0\": " << tile.y0 << ", \"x1\": " << tile.x1 << ", \"y1\": " << tile.y1
+			<< ", \"pixels\": " << (tile.x1 - tile.x0) * (tile.y1 - tile.y0) << "}}";
+		workers = std::max(workers, tile.worker + 1);
+		first = false;
+	}
+	for (int w = 0; w < workers; w++) {
+		file << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << w
+			<< ", \"args\": {\"name\": \"worker " << w << "\"}}";
+		first = false;
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
+
+//--------------------------------------------------------------
+// Lights are listed by shadow cache slot: point lights first, then the area
+// light and the mesh lights (see RayTracer::shadowCheck)
+void RenderProfile::printSummary(std::ostream &out) const {
+	const RenderCounters &c = counters;
+	double seconds = endTime - startTime;
+	long rays = c.primaryRays + c.secondaryRays + c.pathRays + c.shadowRays;
+	out << "render statistics (" << seconds << " s, " << (seconds > 0 ? rays / seconds / 1e6 : 0) << " Mrays/s):" << endl
+		<< "  rays: " << c.primaryRays << " primary, " << c.secondaryRays << " reflected/refracted, "
+		<< c.pathRays << " path bounces, " << c.shadowRays << " shadow" << endl
+		<< "  shadow rays: " << c.shadowBlocked << " blocked (" << (c.shadowRays > 0 ? 100.0 * c.shadowBlocked / c.shadowRays : 0)
+		<< "%), " << c.shadowCacheHits << " by the cached occluder, " << c.shadowRecalled << " taken from the G-buffer" << endl
+		<< "  intersection tests: " << c.spherePackets << " sphere packets, " << c.planePackets << " plane packets, "
+		<< c.triangles << " triangles, " << c.otherObjects << " other objects" << endl
+		<< "  BVH nodes visited: " << c.bvhNodes << " (" << c.bvhLeaves << " leaves)" << endl;
+
+	// the lights that cost the most shadow rays
+	vector<int> order;
+	for (int i = 0; i < (int)c.lightShadowRays.size(); i++) {
+		if (c.lightShadowRays[i] > 0) order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return c.lightShadowRays[a] > c.lightShadowRays[b]; });
+	if (order.size() > 5) order.resize(5);
+	for (int light : order) {
+		out << "  light slot " << light << ": " << c.lightShadowRays[light] << " shadow rays, "
+			<< 100.0 * c.lightBlocked[light] / c.lightShadowRays[light] << "% blocked" << endl;
+	}
+
+	// the slowest pixel points at the most expensive object
+	if (!pixelCosts.empty()) {
+		size_t slowest = std::max_element(pixelCosts.begin(), pixelCosts.end()) - pixelCosts.begin();
+		double total = 0;
+		for (float cost : pixelCosts) total += cost;
+		out << "  pixel time: " << total / pixelCosts.size() * 1e6 << " us on average, " << pixelCosts[slowest] * 1e6
+			<< " us at most (pixel " << slowest % width << ", row " << slowest / width << " from the top)" << endl;
+	}
+}
+
+//--------------------------------------------------------------
+// "out/newImage.png" with suffix "_cost.png" becomes "out/newImage_cost.png"
+std::string RenderProfile::siblingPath(const std::string &path, const std::string &suffix) {
+	size_t slash = path.find_last_of("/\\");
+	size_t dot = path.rfind('.');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path + suffix;
+	return path.substr(0, dot) + suffix;
+}
@@ -0,0 +1,154 @@
+// This file provides the render instrumentation: RenderCounters, the
+// per-thread counters of the hot paths, and RenderProfile, the per-pixel
+// cost and tile schedule of one render
+// - author: Jared Bechthold
+//
+// The instrumentation is compiled in only when RT_STATS is defined (add it to
+// PROJECT_DEFINES in config.make, or pass -DRT_STATS to the compiler). Without
+// it RT_STAT() expands to nothing and every timing branch tests the constant
+// RENDER_STATS, so a normal build pays nothing for it.
+
+#pragma once
+
+#include "tileRenderer.h"
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef RT_STATS
+static const bool RENDER_STATS = true;
+// adds one to a counter of the calling thread
+#define RT_STAT(counter) (threadCounters().counter++)
+// adds amount to a counter of the calling thread
+#define RT_STAT_ADD(counter, amount) (threadCounters().counter += (amount))
+// counts a shadow ray of a light (shadow cache slot, see RayTracer::shadowCheck)
+#define RT_STAT_SHADOW(light, blocked) (threadCounters().shadowRay(light, blocked))
+#else
+static const bool RENDER_STATS = false;
+#define RT_STAT(counter) ((void)0)
+#define RT_STAT_ADD(counter, amount) ((void)0)
+#define RT_STAT_SHADOW(light, blocked) ((void)0)
+#endif
+
+//  Work counted by one render thread
+//  Every thread counts into its own instance (see threadCounters()), so the
+//  counters need no atomics; RenderProfile sums them after a render.
+//
+struct RenderCounters {
+	long primaryRays = 0;		// camera rays, antialiasing samples included
+	long secondaryRays = 0;		// reflected and refracted rays of the Whitted integrator
+	long pathRays = 0;			// bounce rays of the path tracer
+	long shadowRays = 0;		// shadow rays traced (through the shadow cache or the SceneBVH)
+	long shadowBlocked = 0;		// shadow rays that hit an object before the light
+	long shadowCacheHits = 0;	// shadow rays blocked by the cached occluder
+	long shadowRecalled = 0;	// shadow ray results taken from the G-buffer instead of traced
+	long spherePackets = 0;		// SIMD tests of a ray against a packet of 8 spheres
+	long planePackets = 0;		// SIMD tests of a ray against a packet of 8 planes
+	long triangles = 0;			// ray triangle tests of meshes
+	long otherObjects = 0;		// single object tests: unbounded objects, objects of no
+								//  known type and cached occluders that are not meshes
+	long bvhNodes = 0;			// BVH nodes visited by the traversals (scene, meshes and light tree)
+	long bvhLeaves = 0;			// BVH leaves among them
+	std::vector<long> lightShadowRays;	// shadow rays per light (shadow cache slot)
+	std::vector<long> lightBlocked;		// blocked shadow rays per light
+
+	// counts a shadow ray of a light
+	void shadowRay(int light, bool blocked) {
+		if (light >= (int)lightShadowRays.size()) {
+			lightShadowRays.resize(light + 1, 0);
+			lightBlocked.resize(light + 1, 0);
+		}
+		lightShadowRays[light]++;
+		shadowRays++;
+		if (blocked) {
+			lightBlocked[light]++;
+			shadowBlocked++;
+		}
+	}
+	// adds the counts of another thread
+	void add(const RenderCounters &other);
+};
+
+// returns a new set of counters owned by the registry of all threads' counters
+RenderCounters *registerThreadCounters();
+// returns the sum of the counters of every thread
+RenderCounters totalCounters();
+// zeroes the counters of every thread (only while no render is running)
+void resetCounters();
+
+// returns the counters of the calling thread
+inline RenderCounters &threadCounters() {
+	static thread_local RenderCounters *counters = NULL;
+	if (counters == NULL) counters = registerThreadCounters();
+	return *counters;
+}
+
+// returns a steady clock time in seconds for measuring costs (0 without RT_STATS)
+inline double statClock() {
+	if (!RENDER_STATS) return 0;
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//  One tile rendered by a worker, as shown in the tile schedule
+//
+struct TileEvent {
+	int x0, y0, x1, y1;		// bounds of the tile
+	int worker;				// worker thread that rendered it
+	const char *pass;		// pass the tile belongs to
+	double begin;			// statClock() when the tile started
+	double end;				// statClock() when the tile was done
+};
+
+//  Cost of one render: time spent per pixel, the tiles every worker rendered
+//  and the counters of all threads. Written as a false color heatmap and a
+//  Chrome trace (chrome://tracing or ui.perfetto.dev) to find the objects
+//  and lights that make a scene slow. Collects nothing without RT_STATS.
+//
+class RenderProfile {
+public:
+	// forgets the last render and starts measuring one of width x height pixels
+	void start(int width, int height);
+	// sums the counters of the render's threads into counters
+	void finish();
+	// adds time spent on a pixel (row counts from the top, like the framebuffer)
+	void addPixelCost(int x, int row, float seconds) {
+		if (RENDER_STATS && x >= 0 && x < width && row >= 0 && row < height) pixelCosts[(size_t)row * width + x] += seconds;
+	}
+	// runs render(), recording the tile in the schedule with RT_STATS
+	template <class Render>
+	void timeTile(const Tile &tile, int worker, const char *pass, Render render) {
+		if (!RENDER_STATS) {
+			render();
+			return;
+		}
+		double begin = statClock();
+		render();
+		TileEvent event = { tile.x0, tile.y0, tile.x1, tile.y1, worker, pass, begin, statClock() };
+		std::lock_guard<std::mutex> lock(tileMutex);
+		tiles.push_back(event);
+	}
+
+	// writes the pixel costs as a false color image (black is cheap, white is the
+	// 99th percentile and above); returns false on failure
+	bool saveHeatmap(const std::string &path) const;
+	// writes the tile schedule as Chrome trace events, one row per worker
+	bool saveTrace(const std::string &path) const;
+	// prints the counters, the shadow ray hit rate and the lights with the most shadow rays
+	void printSummary(std::ostream &out) const;
+	// returns path without its extension followed by suffix
+	static std::string siblingPath(const std::string &path, const std::string &suffix);
+
+	RenderCounters counters;			// counters of the last render (after finish())
+	std::vector<float> pixelCosts;		// seconds per pixel, row by row from the top
+	std::deque<TileEvent> tiles;		// tiles in the order they finished
+	int width = 0;						// width of the render in pixels
+	int height = 0;						// height of the render in pixels
+	double startTime = 0;				// statClock() at start()
+	double endTime = 0;					// statClock() at finish()
+
+private:
+	std::mutex tileMutex;				// guards tiles between workers
+};
@@ -0,0 +1,201 @@
+// This file provides the low-discrepancy sample sequences and hashing
+// helpers used to place light samples, and the PixelSampler of the path
+// tracer
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+// returns the bits of i in reverse order
+inline uint32_t reverseBits(uint32_t i) {
+	i = (i << 16) | (i >> 16);
+	i = ((i & 0x00ff00ffu) << 8) | ((i & 0xff00ff00u) >> 8);
+	i = ((i & 0x0f0f0f0fu) << 4) | ((i & 0xf0f0f0f0u) >> 4);
+	i = ((i & 0x33333333u) << 2) | ((i & 0xccccccccu) >> 2);
+	i = ((i & 0x55555555u) << 1) | ((i & 0xaaaaaaaau) >> 1);
+	return i;
+}
+
+// returns the base 2 radical inverse of i (van der Corput sequence) in [0, 1)
+inline float radicalInverse2(uint32_t i) {
+	return (float)(reverseBits(i) * 2.3283064365386963e-10);
+}
+
+// returns the base 3 radical inverse of i in [0, 1)
+inline float radicalInverse3(uint32_t i) {
+	float inverse = 0;
+	float scale = 1.0f / 3;
+	for (; i > 0; i /= 3, scale /= 3) {
+		inverse += (i % 3) * scale;
+	}
+	return std::min(inverse, 0.99999994f);
+}
+
+// returns the radical inverse of i in any base in [0, 1) (used for the
+// sequence dimensions after the first two)
+inline float radicalInverse(uint32_t i, uint32_t base) {
+	float inverse = 0;
+	float scale = 1.0f / base;
+	for (; i > 0; i /= base, scale /= base) {
+		inverse += (i % base) * scale;
+	}
+	return std::min(inverse, 0.99999994f);
+}
+
+// returns point i of the Halton sequence in bases 2 and 3; unlike the
+// Hammersley set the number of points need not be known in advance, and
+// every prefix of the sequence covers [0, 1)^2 evenly
+inline glm::vec2 halton(int i) {
+	return glm::vec2(radicalInverse2((uint32_t)i), radicalInverse3((uint32_t)i));
+}
+
+// returns point i of the n point Hammersley set in [0, 1)^2. The first
+// coordinate is stratified into n strata and the second into the power
+// of two strata below n, so every prefix of the set is well distributed.
+inline glm::vec2 hammersley(int i, int n) {
+	return glm::vec2((float)i / n, radicalInverse2((uint32_t)i));
+}
+
+// mixes the bits of x (integer hash of Chris Wellons' lowbias32)
+inline uint32_t hashUint(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// returns two numbers in [0, 1) derived from the bits of a point; used as a
+// per shading point rotation of a sample set so neighboring pixels do not
+// share the same sample pattern, while renders stay reproducible
+inline glm::vec2 hashPoint(const glm::vec3 &p) {
+	uint32_t bits[3];
+	memcpy(bits, &p, sizeof(bits));
+	uint32_t h = hashUint(bits[0] ^ hashUint(bits[1] ^ hashUint(bits[2])));
+	return glm::vec2((h & 0xffff) / 65536.0f, (h >> 16) / 65536.0f);
+}
+
+// maps u in [0, 1)^2 to the unit disk with the concentric map of Shirley
+// and Chiu, which keeps neighboring samples neighbors (lens sampling)
+inline glm::vec2 concentricDisk(glm::vec2 u) {
+	glm::vec2 p = 2.0f * u - glm::vec2(1);
+	if (p.x == 0 && p.y == 0) return glm::vec2(0);
+	const float QUARTER_PI = 0.78539816f;
+	if (std::fabs(p.x) > std::fabs(p.y)) {
+		float angle = QUARTER_PI * (p.y / p.x);
+		return p.x * glm::vec2(std::cos(angle), std::sin(angle));
+	}
+	float angle = 2 * QUARTER_PI - QUARTER_PI * (p.x / p.y);
+	return p.y * glm::vec2(std::cos(angle), std::sin(angle));
+}
+
+// wraps a sample coordinate shifted by a rotation back into [0, 1)
+inline float wrapSample(float x) {
+	x -= std::floor(x);
+	return x < 1.0f ? x : 0.0f;
+}
+
+// returns a cosine weighted direction about +z for u in [0, 1)^2 (density cos / pi)
+inline glm::vec3 cosineHemisphere(glm::vec2 u) {
+	glm::vec2 d = concentricDisk(u);
+	return glm::vec3(d.x, d.y, std::sqrt(std::max(0.0f, 1 - d.x * d.x - d.y * d.y)));
+}
+
+// returns two unit vectors that form a right handed frame with the unit vector axis
+inline void tangentFrame(const glm::vec3 &axis, glm::vec3 &tangent, glm::vec3 &bitangent) {
+	tangent = glm::normalize(glm::cross(std::fabs(axis.x) > 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0), axis));
+	bitangent = glm::cross(axis, tangent);
+}
+
+// turns a unit direction into one within a cone of the given spread around it,
+// from the sample u (glossy reflection and refraction)
+inline glm::vec3 spreadDirection(const glm::vec3 &direction, float spread, glm::vec2 u) {
+	glm::vec3 tangent, bitangent;
+	tangentFrame(direction, tangent, bitangent);
+	glm::vec2 disk = spread * concentricDisk(u);
+	return glm::normalize(direction + disk.x * tangent + disk.y * bitangent);
+}
+
+// returns the second dimension of the Sobol sequence at i as 32 fixed point bits
+// (the first is reverseBits(i))
+inline uint32_t sobol1(uint32_t i) {
+	uint32_t bits = 0;
+	for (uint32_t v = 1u << 31; i != 0; i >>= 1, v ^= v >> 1) {
+		if (i & 1) bits ^= v;
+	}
+	return bits;
+}
+
+// applies a random Owen scramble selected by seed to 32 fixed point bits: every
+// bit is flipped depending on the bits above it (hash of Laine and Karras as
+// improved by Burley), which keeps the points of a (0, 2) sequence stratified
+inline uint32_t owenScramble(uint32_t x, uint32_t seed) {
+	x = reverseBits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return reverseBits(x);
+}
+
+// returns point i of the 2D Sobol (0, 2) sequence, shuffled and Owen scrambled by seed, in [0, 1)^2
+inline glm::vec2 scrambledSobol(uint32_t i, uint32_t seed) {
+	uint32_t index = owenScramble(i, hashUint(seed));
+	uint32_t x = owenScramble(reverseBits(index), hashUint(seed ^ 0xa511e9b3u));
+	uint32_t y = owenScramble(sobol1(index), hashUint(seed ^ 0x63d83595u));
+	return glm::vec2((x >> 8) * 5.9604645e-8f, (y >> 8) * 5.9604645e-8f);
+}
+
+// sequences a PixelSampler draws from
+enum SamplerType {
+	SAMPLER_SOBOL,		// Sobol points Owen scrambled per pixel: pixels are independent
+	SAMPLER_BLUE_NOISE	// Sobol points shared by all pixels, shifted per pixel by a blue noise
+						//  mask so the error of neighboring pixels is spread at high frequency
+};
+
+//  Samples of one pixel sample: a low-discrepancy 2D point per dimension
+//  pair, from the sample's index in a sequence of its own per dimension
+//  pair, so the samples of a pixel are stratified in every pair and
+//  neighboring pixels and dimensions do not correlate. The sequence only
+//  depends on the pixel and sample index, never on the thread.
+//
+class PixelSampler {
+public:
+	// PixelSampler constructor that sets the sequence
+	PixelSampler(SamplerType type = SAMPLER_SOBOL) { this->type = type; }
+
+	// starts the sample with the given index (0 for the first sample) of pixel (x, y)
+	void start(int x, int y, uint32_t index) {
+		this->x = x;
+		this->y = y;
+		this->index = index;
+		pixelSeed = hashUint((uint32_t)x ^ hashUint((uint32_t)y + 0x9e3779b9u));
+		dimension = 0;
+	}
+	// returns the next 2D point of the sample
+	glm::vec2 next2D() {
+		uint32_t dimensionSeed = hashUint(dimension++ * 0x9e3779b9u + 0x85ebca6bu);
+		if (type == SAMPLER_SOBOL) return scrambledSobol(index, pixelSeed ^ dimensionSeed);
+		// R2 dither masks (Roberts) are close to blue noise over the pixels; every
+		// dimension pair shifts them by a multiple of the golden ratio
+		glm::vec2 point = scrambledSobol(index, dimensionSeed);
+		float mask = 0.7548776662f * x + 0.5698402910f * y;
+		float shift = 0.6180339887f * dimension;
+		return glm::vec2(wrapSample(point.x + mask + shift), wrapSample(point.y + 0.5698402910f * x + 0.7548776662f * y + shift));
+	}
+
+	SamplerType type;		// sequence of the samples
+
+private:
+	int x = 0, y = 0;			// pixel of the sample
+	uint32_t index = 0;			// index of the sample in the pixel's sequence
+	uint32_t pixelSeed = 0;		// hash of the pixel
+	uint32_t dimension = 0;		// dimension pairs used so far
+};
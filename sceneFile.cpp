@@ -0,0 +1,755 @@
+// This file provides the implementation of the scene file parser and the
+// binary scene cache
+// - author: Jared Bechthold
+
+#include "sceneFile.h"
+#include "mappedFile.h"
+#include "binaryIO.h"
+#include <cstring>
+#include <map>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// identifies scene cache files and the layout version they were written with
+static const char CACHE_MAGIC[4] = { 'R', 'T', 'S', 'C' };
+static const uint32_t CACHE_VERSION = 5;
+
+// object types stored in the cache
+enum CachedObjectType : uint8_t { CACHED_SPHERE = 0, CACHED_PLANE = 1, CACHED_MESH = 2 };
+
+//--------------------------------------------------------------
+// Reads the size and modification time of a file
+static bool fileStamp(const string &path, uint64_t &size, int64_t &modified) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) return false;
+	size = (uint64_t)info.st_size;
+	modified = (int64_t)info.st_mtime;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns the directory part of a path ("" if it has none)
+static string directoryOf(const string &path) {
+	size_t slash = path.find_last_of("/\\");
+	return slash == string::npos ? "" : path.substr(0, slash);
+}
+
+//--------------------------------------------------------------
+// Resolves a file name from a scene file against the scene's directory
+static string resolvePath(const string &directory, const string &name) {
+	bool absolute = !name.empty() && (name[0] == '/' || name[0] == '\\' || (name.size() > 1 && name[1] == ':'));
+	if (absolute || directory.empty()) return name;
+	return directory + "/" + name;
+}
+
+//--------------------------------------------------------------
+// Loads an image file as the texture of a plane (pixels only, no GL texture)
+static bool loadPlaneTexture(Plane *plane, const string &path) {
+	ofImage texture;
+	texture.setUseTexture(false);
+	if (!texture.load(path)) return false;
+	plane->applyTexture(texture);
+	plane->textureFile = path;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Parses the arguments of one statement. Arguments are "name value..."
+// pairs; the reader functions look an argument up by name.
+//
+class Statement {
+public:
+	// splits a line into whitespace separated tokens, dropping comments
+	Statement(const string &line) {
+		std::istringstream stream(line.substr(0, line.find('#')));
+		string token;
+		while (stream >> token) tokens.push_back(token);
+	}
+
+	// returns the keyword of the statement ("" for empty lines)
+	string keyword() const { return tokens.empty() ? "" : tokens[0]; }
+	// returns true if the argument is present
+	bool has(const string &name) const { return find(name) > 0; }
+
+	// reads count numbers following the named argument into values
+	bool numbers(const string &name, int count, float *values, string &error) const {
+		int at = find(name);
+		if (at <= 0) {
+			error = "missing '" + name + "'";
+			return false;
+		}
+		if (at + count >= (int)tokens.size()) {
+			error = "'" + name + "' needs " + ofToString(count) + " values";
+			return false;
+		}
+		for (int i = 0; i < count; i++) {
+			try {
+				values[i] = stof(tokens[at + 1 + i]);
+			}
+			catch (const std::exception &) {
+				error = "bad number '" + tokens[at + 1 + i] + "' for '" + name + "'";
+				return false;
+			}
+		}
+		return true;
+	}
+	// reads a number, vector or color argument; optional arguments keep their value when absent
+	bool number(const string &name, float &value, string &error, bool required = false) const {
+		if (!required && !has(name)) return true;
+		return numbers(name, 1, &value, error);
+	}
+	bool vec2(const string &name, glm::vec2 &value, string &error, bool required = false) const {
+		float v[2];
+		if (!required && !has(name)) return true;
+		if (!numbers(name, 2, v, error)) return false;
+		value = glm::vec2(v[0], v[1]);
+		return true;
+	}
+	bool vec3(const string &name, glm::vec3 &value, string &error, bool required = false) const {
+		float v[3];
+		if (!required && !has(name)) return true;
+		if (!numbers(name, 3, v, error)) return false;
+		value = glm::vec3(v[0], v[1], v[2]);
+		return true;
+	}
+	bool color(const string &name, ofColor &value, string &error) const {
+		float v[3];
+		if (!has(name)) return true;
+		if (!numbers(name, 3, v, error)) return false;
+		value = ofColor(v[0], v[1], v[2]);
+		return true;
+	}
+	// reads a single word argument (file names)
+	bool word(const string &name, string &value, string &error, bool required = false) const {
+		int at = find(name);
+		if (at <= 0) {
+			if (required) error = "missing '" + name + "'";
+			return !required;
+		}
+		if (at + 1 >= (int)tokens.size()) {
+			error = "'" + name + "' needs a value";
+			return false;
+		}
+		value = tokens[at + 1];
+		return true;
+	}
+
+	vector<string> tokens;	// keyword followed by its arguments
+
+private:
+	// returns the index of the named argument, or -1
+	int find(const string &name) const {
+		for (int i = 1; i < (int)tokens.size(); i++) {
+			if (tokens[i] == name) return i;
+		}
+		return -1;
+	}
+};
+
+//--------------------------------------------------------------
+// Returns the name argument of a statement, or a name no key can refer to
+static string nameOf(const Statement &statement, const string &keyword) {
+	string name, error;
+	statement.word("name", name, error);
+	return name.empty() ? " " + keyword : name;
+}
+
+//--------------------------------------------------------------
+// Reads the optional material argument of an object statement, which names
+// a material defined above, into the object
+static bool readMaterial(const Statement &statement, const std::map<string, int> &materials, SceneObject *object, string &error) {
+	string name;
+	if (!statement.word("material", name, error)) return false;
+	if (name.empty()) return true;
+	auto material = materials.find(name);
+	if (material == materials.end()) {
+		error = "unknown material '" + name + "'";
+		return false;
+	}
+	object->material = (uint16_t)material->second;
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns true if every triangle indexes one of vertexCount vertices
+static bool validTriangles(const vector<Triangle> &triangles, size_t vertexCount) {
+	for (const Triangle &triangle : triangles) {
+		for (int v : triangle.vertInd) {
+			if (v < 0 || (size_t)v >= vertexCount) return false;
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns true if the nodes of a cached BVH form a tree BVH::traverseLeaves
+// can walk: children come after their parent, the tree is shallow enough for
+// the traversal stack and every leaf range holds primitives below primitiveCount
+static bool validBVH(const BVH &bvh, size_t primitiveCount) {
+	for (int primitive : bvh.primIndices) {
+		if (primitive < 0 || (size_t)primitive >= primitiveCount) return false;
+	}
+	int nodeCount = (int)bvh.nodes.size();
+	vector<int> depth(nodeCount, 0);	// depth of each node, set by its parent
+	for (int n = 0; n < nodeCount; n++) {
+		const BVHNode &node = bvh.nodes[n];
+		if (node.count < 0 || depth[n] >= BVH::STACK_SIZE) return false;
+		if (node.isLeaf()) {
+			if (node.offset < 0 || node.offset > (int)bvh.primIndices.size() - node.count) return false;
+			continue;
+		}
+		// the left child directly follows its parent, the right one follows the left subtree
+		if (node.offset <= n + 1 || node.offset >= nodeCount) return false;
+		depth[n + 1] = depth[node.offset] = depth[n] + 1;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns true if a cached track animates a known property of an element
+// rayTracer holds (Animation::apply indexes the element's array directly)
+static bool validTrack(const AnimationTrack &track, const RayTracer &rayTracer) {
+	if (track.property != PROPERTY_POSITION && track.property != PROPERTY_INTENSITY && track.property != PROPERTY_AIM) return false;
+	int count;		// elements of the target's kind
+	switch (track.target) {
+	case TARGET_CAMERA:
+	case TARGET_AREA_LIGHT:
+		count = 1;
+		break;
+	case TARGET_OBJECT:
+		count = (int)rayTracer.scene.size();
+		break;
+	case TARGET_LIGHT:
+		count = (int)rayTracer.lights.size();
+		break;
+	case TARGET_MESH_LIGHT:
+		count = (int)rayTracer.meshLights.size();
+		break;
+	default:
+		return false;
+	}
+	return track.index >= 0 && track.index < count;
+}
+
+//--------------------------------------------------------------
+// Loads a scene through its cache, or parses it and refreshes the cache
+bool SceneFile::load(const string &path, RayTracer &rayTracer, string &error, bool useCache) {
+	string cache = cachePath(path);
+	if (useCache && readCache(cache, rayTracer)) {
+		rayTracer.animation.apply(rayTracer, 0);
+		return true;
+	}
+
+	ifstream input(path);
+	if (!input) {
+		error = "cannot open " + path;
+		return false;
+	}
+	vector<string> dependencies;
+	dependencies.push_back(path);
+	if (!parse(input, directoryOf(path), rayTracer, dependencies, error)) {
+		error = path + ":" + error;
+		return false;
+	}
+	if (useCache && !writeCache(cache, rayTracer, dependencies)) {
+		cout << "could not write scene cache " << cache << endl;
+	}
+	rayTracer.animation.apply(rayTracer, 0);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Reads the scene one line at a time and builds its objects
+bool SceneFile::parse(std::istream &input, const string &directory, RayTracer &rayTracer, vector<string> &dependencies, string &error) {
+	rayTracer.clearScene();
+	// elements that keys can refer to, by name
+	std::map<string, std::pair<AnimationTarget, int>> names;
+	names["camera"] = std::make_pair(TARGET_CAMERA, 0);
+	names["arealight"] = std::make_pair(TARGET_AREA_LIGHT, 0);
+	// materials objects can refer to, by name
+	std::map<string, int> materials;
+	int lastKey = -1;		// highest key frame
+	bool hasFrames = false;	// the sequence length was given
+	string line;
+	int lineNumber = 0;
+	while (std::getline(input, line)) {
+		lineNumber++;
+		Statement statement(line);
+		string keyword = statement.keyword();
+		bool ok = true;
+		if (keyword.empty()) continue;
+
+		if (keyword == "image") {
+			if (statement.tokens.size() != 3) {
+				error = "image needs <width> <height>";
+				ok = false;
+			}
+			else {
+				rayTracer.imageWidth = atoi(statement.tokens[1].c_str());
+				rayTracer.imageHeight = atoi(statement.tokens[2].c_str());
+				ok = rayTracer.imageWidth > 0 && rayTracer.imageHeight > 0;
+				if (!ok) error = "image size must be positive";
+			}
+		}
+		else if (keyword == "background") {
+			float c[3];
+			ok = statement.tokens.size() == 4;
+			for (int i = 0; ok && i < 3; i++) c[i] = (float)atof(statement.tokens[i + 1].c_str());
+			if (ok) rayTracer.background = ofColor(c[0], c[1], c[2]);
+			else error = "background needs <r g b>";
+		}
+		else if (keyword == "phong") {
+			ok = statement.tokens.size() == 2;
+			if (ok) rayTracer.phongPower = (float)atof(statement.tokens[1].c_str());
+			else error = "phong needs <power>";
+		}
+		else if (keyword == "camera") {
+			RenderCam &camera = rayTracer.renderCam;
+			ok = statement.vec3("position", camera.position, error, true) && statement.vec3("aim", camera.aim, error) &&
+				statement.vec3("up", camera.up, error) && statement.number("fov", camera.fov, error) &&
+				statement.number("aperture", camera.aperture, error) && statement.number("focus", camera.focusDistance, error);
+			// a given fov must open a view (0 is the ViewPlane camera of scenes without one)
+			bool badFov = statement.has("fov") && !(camera.fov > 0 && camera.fov < 180);
+			if (ok && (badFov || camera.aperture < 0 || camera.focusDistance < 0)) {
+				error = "camera needs a fov between 0 and 180 degrees and a positive aperture and focus";
+				ok = false;
+			}
+		}
+		else if (keyword == "viewplane") {
+			glm::vec2 min = rayTracer.renderCam.view.min, max = rayTracer.renderCam.view.max;
+			ok = statement.vec2("min", min, error, true) && statement.vec2("max", max, error, true) &&
+				statement.number("z", rayTracer.renderCam.view.position.z, error);
+			rayTracer.renderCam.view.setSize(min, max);
+		}
+		else if (keyword == "material") {
+			Material material;
+			ok = statement.tokens.size() >= 2;
+			if (!ok) error = "material needs a <name>";
+			ok = ok && statement.color("specular", material.specularColor, error) && statement.number("reflect", material.reflectance, error) &&
+				statement.number("transmit", material.transmission, error) && statement.number("ior", material.ior, error) &&
+				statement.number("gloss", material.gloss, error);
+			if (ok && (material.reflectance < 0 || material.reflectance > 1 || material.transmission < 0 || material.transmission > 1 ||
+				material.ior < 1 || material.gloss < 0)) {
+				error = "material needs reflect and transmit between 0 and 1, an ior of at least 1 and a positive gloss";
+				ok = false;
+			}
+			if (ok && rayTracer.materials.size() > UINT16_MAX) {
+				error = "too many materials";
+				ok = false;
+			}
+			if (ok) materials[statement.tokens[1]] = rayTracer.addMaterial(material);
+		}
+		else if (keyword == "sphere") {
+			names[nameOf(statement, "sphere")] = std::make_pair(TARGET_OBJECT, (int)rayTracer.scene.size());
+			Sphere *sphere = rayTracer.addSphere(glm::vec3(0, 0, 0), 1);
+			ok = statement.vec3("position", sphere->position, error, true) &&
+				statement.number("radius", sphere->radius, error, true) &&
+				statement.color("color", sphere->diffuseColor, error) && readMaterial(statement, materials, sphere, error);
+		}
+		else if (keyword == "plane") {
+			glm::vec3 position, normal(0, 1, 0);
+			glm::vec2 size(20, 20), tiles(10, 10);
+			ofColor color = ofColor::darkOliveGreen;
+			string texture;
+			ok = statement.vec3("position", position, error, true) && statement.vec3("normal", normal, error) &&
+				statement.vec2("size", size, error) && statement.color("color", color, error) &&
+				statement.word("texture", texture, error) && statement.vec2("tiles", tiles, error);
+			if (ok) {
+				names[nameOf(statement, "plane")] = std::make_pair(TARGET_OBJECT, (int)rayTracer.scene.size());
+				Plane *plane = rayTracer.addPlane(position, normal, color, size.x, size.y);
+				plane->setTiles((int)tiles.x, (int)tiles.y);
+				if (rayTracer.floor == NULL) rayTracer.floor = plane;
+				if (!texture.empty() && !loadPlaneTexture(plane, resolvePath(directory, texture))) {
+					error = "cannot load texture " + texture;
+					ok = false;
+				}
+				ok = ok && readMaterial(statement, materials, plane, error);
+			}
+		}
+		else if (keyword == "mesh") {
+			string file;
+			glm::vec3 position;
+			ofColor color = ofColor::lightGray;
+			ok = statement.word("file", file, error, true) && statement.vec3("position", position, error) &&
+				statement.color("color", color, error);
+			if (ok) {
+				string path = resolvePath(directory, file);
+				int index = (int)rayTracer.scene.size();
+				Mesh *mesh = rayTracer.addMesh(path, position, color);
+				if (mesh != NULL) {
+					names[nameOf(statement, "mesh")] = std::make_pair(TARGET_OBJECT, index);
+					dependencies.push_back(path);
+					ok = readMaterial(statement, materials, mesh, error);
+				}
+				else {
+					error = "cannot open mesh " + file;
+					ok = false;
+				}
+			}
+		}
+		else if (keyword == "pointlight") {
+			glm::vec3 position;
+			float intensity = 100, radius = 0.1;
+			ofColor color = ofColor::white;
+			ok = statement.vec3("position", position, error, true) && statement.number("intensity", intensity, error) &&
+				statement.number("radius", radius, error) && statement.color("color", color, error);
+			if (ok) {
+				names[nameOf(statement, "pointlight")] = std::make_pair(TARGET_LIGHT, (int)rayTracer.lights.size());
+				rayTracer.addLight(position, intensity, radius, color);
+			}
+		}
+		else if (keyword == "arealight") {
+			glm::vec3 position;
+			float intensity = 100;
+			string file;
+			ok = statement.vec3("position", position, error, true) && statement.number("intensity", intensity, error) &&
+				statement.word("file", file, error);
+			if (ok) {
+				rayTracer.areaLight = AreaLight(position, intensity);
+				if (!file.empty()) {
+					string path = resolvePath(directory, file);
+					ok = rayTracer.loadAreaLight(path);
+					if (ok) dependencies.push_back(path);
+					else error = "cannot open area light " + file;
+				}
+			}
+		}
+		else if (keyword == "meshlight") {
+			string file;
+			glm::vec3 position;
+			float intensity = 100;
+			ok = statement.word("file", file, error, true) && statement.vec3("position", position, error) &&
+				statement.number("intensity", intensity, error);
+			if (ok) {
+				string path = resolvePath(directory, file);
+				int index = (int)rayTracer.meshLights.size();
+				if (rayTracer.addMeshLight(path, position, intensity) != NULL) {
+					names[nameOf(statement, "meshlight")] = std::make_pair(TARGET_MESH_LIGHT, index);
+					dependencies.push_back(path);
+				}
+				else {
+					error = "cannot open mesh light " + file;
+					ok = false;
+				}
+			}
+		}
+		else if (keyword == "frames") {
+			ok = statement.tokens.size() == 2 && atoi(statement.tokens[1].c_str()) > 0;
+			if (ok) {
+				rayTracer.animation.frameCount = atoi(statement.tokens[1].c_str());
+				hasFrames = true;
+			}
+			else {
+				error = "frames needs a positive <count>";
+			}
+		}
+		else if (keyword == "key") {
+			auto target = names.end();
+			float frame = 0, intensity = 0;
+			glm::vec3 position;
+			if (statement.tokens.size() < 2 || (target = names.find(statement.tokens[1])) == names.end()) {
+				error = "key needs the <name> of an element defined above";
+				ok = false;
+			}
+			else {
+				ok = statement.number("frame", frame, error, true) && statement.vec3("position", position, error) &&
+					statement.number("intensity", intensity, error);
+			}
+			if (ok && statement.has("intensity") && (target->second.first == TARGET_CAMERA || target->second.first == TARGET_OBJECT)) {
+				error = "only lights have an intensity";
+				ok = false;
+			}
+			glm::vec3 aim;
+			if (ok && statement.has("aim")) {
+				ok = statement.vec3("aim", aim, error);
+				if (ok && target->second.first != TARGET_CAMERA) {
+					error = "only the camera has an aim";
+					ok = false;
+				}
+			}
+			if (ok) {
+				AnimationTarget kind = target->second.first;
+				int index = target->second.second;
+				if (statement.has("position")) rayTracer.animation.addKey(kind, index, PROPERTY_POSITION, (int)frame, position);
+				if (statement.has("intensity")) rayTracer.animation.addKey(kind, index, PROPERTY_INTENSITY, (int)frame, glm::vec3(intensity, 0, 0));
+				if (statement.has("aim")) rayTracer.animation.addKey(kind, index, PROPERTY_AIM, (int)frame, aim);
+				lastKey = std::max(lastKey, (int)frame);
+			}
+		}
+		else {
+			error = "unknown statement '" + keyword + "'";
+			ok = false;
+		}
+
+		if (!ok) {
+			error = ofToString(lineNumber) + ": " + error;
+			return false;
+		}
+	}
+	// without a frames statement the sequence ends at the last key
+	if (!hasFrames) rayTracer.animation.frameCount = lastKey + 1 > 1 ? lastKey + 1 : 1;
+	rayTracer.setImageSize(rayTracer.imageWidth, rayTracer.imageHeight);
+	return true;
+}
+
+//--------------------------------------------------------------
+// Serializes the scene of the ray tracer, including mesh BVHs
+bool SceneFile::writeCache(const string &cachePath, const RayTracer &rayTracer, const vector<string> &dependencies) {
+	BinaryWriter out;
+	out.buffer.reserve(1 << 16);
+	out.write(CACHE_MAGIC);
+	out.write(CACHE_VERSION);
+
+	// files the cache was built from, to detect stale caches
+	out.write((uint32_t)dependencies.size());
+	for (const string &path : dependencies) {
+		uint64_t size;
+		int64_t modified;
+		if (!fileStamp(path, size, modified)) return false;
+		out.writeString(path);
+		out.write(size);
+		out.write(modified);
+	}
+
+	// image and camera settings
+	out.write((int32_t)rayTracer.imageWidth);
+	out.write((int32_t)rayTracer.imageHeight);
+	out.writeColor(rayTracer.background);
+	out.write(rayTracer.phongPower);
+	out.write(rayTracer.renderCam.position);
+	out.write(rayTracer.renderCam.aim);
+	out.write(rayTracer.renderCam.view.min);
+	out.write(rayTracer.renderCam.view.max);
+	out.write(rayTracer.renderCam.view.position.z);
+	out.write(rayTracer.renderCam.up);
+	out.write(rayTracer.renderCam.fov);
+	out.write(rayTracer.renderCam.aperture);
+	out.write(rayTracer.renderCam.focusDistance);
+
+	// materials (after the default material 0)
+	out.write((uint32_t)rayTracer.materials.size() - 1);
+	for (size_t i = 1; i < rayTracer.materials.size(); i++) {
+		const Material &material = rayTracer.materials[i];
+		out.writeColor(material.specularColor);
+		out.write(material.reflectance);
+		out.write(material.transmission);
+		out.write(material.ior);
+		out.write(material.gloss);
+	}
+
+	// scene objects
+	out.write((uint32_t)rayTracer.scene.size());
+	for (SceneObject *object : rayTracer.scene) {
+		if (object->type == OBJECT_SPHERE) {
+			Sphere *sphere = static_cast<Sphere *>(object);
+			out.write(CACHED_SPHERE);
+			out.write(sphere->position);
+			out.writeColor(sphere->diffuseColor);
+			out.write(sphere->material);
+			out.write(sphere->radius);
+		}
+		else if (object->type == OBJECT_PLANE) {
+			Plane *plane = static_cast<Plane *>(object);
+			out.write(CACHED_PLANE);
+			out.write(plane->position);
+			out.writeColor(plane->diffuseColor);
+			out.write(plane->material);
+			out.write(plane->normal);
+			out.write(plane->width);
+			out.write(plane->height);
+			out.writeString(plane->textureApplied ? plane->textureFile : "");
+			out.write((int32_t)plane->tilesX);
+			out.write((int32_t)plane->tilesY);
+		}
+		else if (object->type == OBJECT_MESH) {
+			Mesh *mesh = static_cast<Mesh *>(object);
+			out.write(CACHED_MESH);
+			out.write(mesh->position);
+			out.writeColor(mesh->diffuseColor);
+			out.write(mesh->material);
+			out.writeString(mesh->sourceFile);
+			out.writeArray(mesh->verts);
+			out.writeArray(mesh->triangles);
+			out.writeArray(mesh->bvh.nodes);
+			out.writeArray(mesh->bvh.primIndices);
+		}
+		else {
+			return false;
+		}
+	}
+
+	// lights
+	out.write((uint32_t)rayTracer.lights.size());
+	for (const PointLight &light : rayTracer.lights) {
+		out.write(light.position);
+		out.write(light.intensity);
+		out.write(light.radius);
+		out.writeColor(light.diffuseColor);
+	}
+	out.write(rayTracer.areaLight.position);
+	out.write(rayTracer.areaLight.intensity);
+	out.writeString(rayTracer.areaLightFile);
+	out.writeArray(rayTracer.areaLight.verts);
+	out.writeArray(rayTracer.areaLight.triangles);
+	out.write((uint32_t)rayTracer.meshLights.size());
+	for (const AreaLight &light : rayTracer.meshLights) {
+		out.write(light.position);
+		out.write(light.intensity);
+		out.writeArray(light.verts);
+		out.writeArray(light.triangles);
+	}
+
+	// animation
+	out.write((int32_t)rayTracer.animation.frameCount);
+	out.write((uint32_t)rayTracer.animation.tracks.size());
+	for (const AnimationTrack &track : rayTracer.animation.tracks) {
+		out.write(track.target);
+		out.write((int32_t)track.index);
+		out.write(track.property);
+		out.writeArray(track.keys);
+	}
+
+	// write to a temporary file first so readers never map a partial cache
+	string temporary = cachePath + ".tmp";
+	{
+		ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file) return false;
+		file.write(out.buffer.data(), out.buffer.size());
+		if (!file) return false;
+	}
+	remove(cachePath.c_str());
+	return rename(temporary.c_str(), cachePath.c_str()) == 0;
+}
+
+//--------------------------------------------------------------
+// Maps the cache and rebuilds the scene from it without parsing text or
+// rebuilding mesh BVHs
+bool SceneFile::readCache(const string &cachePath, RayTracer &rayTracer) {
+	MappedFile file;
+	if (!file.open(cachePath)) return false;
+	BinaryReader in(file.data(), file.size());
+
+	char magic[4];
+	uint32_t version;
+	if (!in.read(magic) || memcmp(magic, CACHE_MAGIC, 4) != 0 || !in.read(version) || version != CACHE_VERSION) return false;
+
+	// the cache is stale if any source file changed
+	uint32_t dependencyCount;
+	if (!in.read(dependencyCount)) return false;
+	for (uint32_t i = 0; i < dependencyCount; i++) {
+		string path;
+		uint64_t size, currentSize;
+		int64_t modified, currentModified;
+		if (!in.readString(path) || !in.read(size) || !in.read(modified)) return false;
+		if (!fileStamp(path, currentSize, currentModified) || currentSize != size || currentModified != modified) return false;
+	}
+
+	// image and camera settings
+	rayTracer.clearScene();
+	int32_t width, height;
+	glm::vec2 viewMin, viewMax;
+	if (!in.read(width) || !in.read(height) || !in.readColor(rayTracer.background) || !in.read(rayTracer.phongPower) ||
+		!in.read(rayTracer.renderCam.position) || !in.read(rayTracer.renderCam.aim) ||
+		!in.read(viewMin) || !in.read(viewMax) || !in.read(rayTracer.renderCam.view.position.z) ||
+		!in.read(rayTracer.renderCam.up) || !in.read(rayTracer.renderCam.fov) || !in.read(rayTracer.renderCam.aperture) ||
+		!in.read(rayTracer.renderCam.focusDistance)) return false;
+	rayTracer.renderCam.view.setSize(viewMin, viewMax);
+
+	// materials
+	uint32_t materialCount;
+	if (!in.read(materialCount)) return false;
+	for (uint32_t i = 0; i < materialCount; i++) {
+		Material material;
+		if (!in.readColor(material.specularColor) || !in.read(material.reflectance) || !in.read(material.transmission) ||
+			!in.read(material.ior) || !in.read(material.gloss)) return false;
+		rayTracer.addMaterial(material);
+	}
+
+	// scene objects
+	uint32_t objectCount;
+	if (!in.read(objectCount)) return false;
+	for (uint32_t i = 0; i < objectCount; i++) {
+		uint8_t type;
+		glm::vec3 position;
+		ofColor color;
+		uint16_t material;
+		if (!in.read(type) || !in.read(position) || !in.readColor(color) || !in.read(material) ||
+			material >= rayTracer.materials.size()) return false;
+		if (type == CACHED_SPHERE) {
+			float radius;
+			if (!in.read(radius)) return false;
+			rayTracer.addSphere(position, radius, color)->material = material;
+		}
+		else if (type == CACHED_PLANE) {
+			glm::vec3 normal;
+			float planeWidth, planeHeight;
+			string texture;
+			int32_t tilesX, tilesY;
+			if (!in.read(normal) || !in.read(planeWidth) || !in.read(planeHeight) || !in.readString(texture) ||
+				!in.read(tilesX) || !in.read(tilesY)) return false;
+			Plane *plane = rayTracer.addPlane(position, normal, color, planeWidth, planeHeight);
+			plane->material = material;
+			plane->setTiles(tilesX, tilesY);
+			if (rayTracer.floor == NULL) rayTracer.floor = plane;
+			if (!texture.empty() && !loadPlaneTexture(plane, texture)) return false;
+		}
+		else if (type == CACHED_MESH) {
+			Mesh *mesh = rayTracer.addMesh(position, color);
+			mesh->material = material;
+			if (!in.readString(mesh->sourceFile) || !in.readArray(mesh->verts) || !in.readArray(mesh->triangles) ||
+				!in.readArray(mesh->bvh.nodes) || !in.readArray(mesh->bvh.primIndices)) return false;
+			// a damaged cache must not index past the mesh arrays
+			if (!validTriangles(mesh->triangles, mesh->verts.size()) || !validBVH(mesh->bvh, mesh->triangles.size())) return false;
+			mesh->updateDrawMesh();
+		}
+		else {
+			return false;
+		}
+	}
+
+	// lights
+	uint32_t lightCount;
+	if (!in.read(lightCount)) return false;
+	for (uint32_t i = 0; i < lightCount; i++) {
+		glm::vec3 position;
+		float intensity, radius;
+		ofColor color;
+		if (!in.read(position) || !in.read(intensity) || !in.read(radius) || !in.readColor(color)) return false;
+		rayTracer.addLight(position, intensity, radius, color);
+	}
+	glm::vec3 areaPosition;
+	float areaIntensity;
+	if (!in.read(areaPosition) || !in.read(areaIntensity)) return false;
+	rayTracer.areaLight = AreaLight(areaPosition, areaIntensity);
+	if (!in.readString(rayTracer.areaLightFile) || !in.readArray(rayTracer.areaLight.verts) ||
+		!in.readArray(rayTracer.areaLight.triangles) ||
+		!validTriangles(rayTracer.areaLight.triangles, rayTracer.areaLight.verts.size())) return false;
+	rayTracer.areaLight.buildSampling();
+	uint32_t meshLightCount;
+	if (!in.read(meshLightCount)) return false;
+	for (uint32_t i = 0; i < meshLightCount; i++) {
+		glm::vec3 position;
+		float intensity;
+		if (!in.read(position) || !in.read(intensity)) return false;
+		AreaLight *light = rayTracer.meshLights.create(position, intensity);
+		if (!in.readArray(light->verts) || !in.readArray(light->triangles) ||
+			!validTriangles(light->triangles, light->verts.size())) return false;
+		light->buildSampling();
+	}
+
+	// animation
+	int32_t frameCount;
+	uint32_t trackCount;
+	if (!in.read(frameCount) || !in.read(trackCount)) return false;
+	rayTracer.animation.frameCount = frameCount;
+	rayTracer.animation.tracks.resize(trackCount);
+	for (AnimationTrack &track : rayTracer.animation.tracks) {
+		int32_t index;
+		if (!in.read(track.target) || !in.read(index) || !in.read(track.property) || !in.readArray(track.keys)) return false;
+		track.index = index;
+		if (!validTrack(track, rayTracer)) return false;
+	}
+
+	rayTracer.setImageSize(width, height);
+	return true;
+}
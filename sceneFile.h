@@ -0,0 +1,80 @@
+// This file provides the class definition of SceneFile, which loads text
+// scene descriptions into a RayTracer and keeps a binary cache of them
+// - author: Jared Bechthold
+//
+// Scene files are plain text with one statement per line. Everything after
+// a '#' is a comment. Each statement starts with a keyword followed by
+// "name value" arguments in any order; vectors and colors are written as
+// 3 (or 2) numbers and colors use 0-255 components. File names are
+// relative to the scene file.
+//
+//   image <width> <height>
+//   background <r g b>
+//   phong <power>
+//   camera position <x y z> [aim <x y z>] [up <x y z>] [fov <degrees>]
+//          [aperture <diameter>] [focus <distance>]
+//   viewplane min <x y> max <x y> [z <z>]
+//   material <name> [specular <r g b>] [reflect <r>] [transmit <t>] [ior <n>]
+//            [gloss <g>]
+//   sphere position <x y z> radius <r> [color <r g b>] [material <name>] [name <name>]
+//   plane position <x y z> [normal <x y z>] [size <w h>] [color <r g b>]
+//         [texture <image>] [tiles <x y>] [material <name>] [name <name>]
+//   mesh file <obj> [position <x y z>] [color <r g b>] [material <name>] [name <name>]
+//   pointlight position <x y z> [intensity <i>] [radius <r>] [color <r g b>] [name <name>]
+//   arealight position <x y z> [intensity <i>] [file <obj>]
+//   meshlight file <obj> [position <x y z>] [intensity <i>] [name <name>]
+//   frames <count>
+//   key <name> frame <n> [position <x y z>] [intensity <i>] [aim <x y z>]
+//
+// A camera with a fov looks from position at aim; without one it looks
+// down -z through the viewplane window (see RenderCam). An aperture turns
+// on depth of field, with the focus distance defaulting to the aim.
+//
+// A material mirrors "reflect" of the light at normal incidence (more at
+// grazing angles) and refracts "transmit" of the rest through an inside
+// of index of refraction "ior"; "gloss" blurs both. Objects without one
+// use plain Phong shading. Materials must be defined before their objects.
+//
+// A meshlight is an emissive mesh lit like the area light: it lights the
+// scene but is not an object, so it casts no shadow. A scene may have any
+// number of them; scenes with many lights pick a few per shaded point
+// (see RayTracer::lightTreeThreshold).
+//
+// A key sets the position (or light intensity, or camera aim) of a named
+// element at a frame of the sequence; "camera" and "arealight" are always
+// defined. Moving the camera moves its aim and viewplane along with it.
+// Values are interpolated linearly between keys, and the sequence is
+// "frames" long (or ends at the last key). Frame 0 is applied on load.
+//
+// The first load of a scene writes <scene>.cache next to it: a flat binary
+// copy of the parsed scene including the vertices, triangles and prebuilt
+// BVHs of every mesh. Later loads memory-map the cache instead of parsing
+// the text and OBJ files again, as long as none of them changed size or
+// modification time.
+
+#pragma once
+
+#include "rayTracer.h"
+#include <istream>
+
+//  Scene file parser and binary scene cache
+//
+class SceneFile {
+public:
+	// loads the scene at path into rayTracer (replacing its scene), reading the
+	// cache when it is up to date and refreshing it otherwise
+	static bool load(const string &path, RayTracer &rayTracer, string &error, bool useCache = true);
+
+	// parses a text scene line by line; file names are resolved against directory and
+	// every OBJ file read is appended to dependencies
+	static bool parse(std::istream &input, const string &directory, RayTracer &rayTracer, vector<string> &dependencies, string &error);
+
+	// writes the scene of rayTracer to a binary cache that depends on the given files
+	static bool writeCache(const string &cachePath, const RayTracer &rayTracer, const vector<string> &dependencies);
+	// reads a binary cache into rayTracer; returns false if the cache is missing,
+	// damaged or older than any of the files it was built from
+	static bool readCache(const string &cachePath, RayTracer &rayTracer);
+
+	// returns the path of the cache that belongs to a scene file
+	static string cachePath(const string &scenePath) { return scenePath + ".cache"; }
+};
@@ -0,0 +1,231 @@
+// This file provides the implementation of the self tests
+// - author: Jared Bechthold
+
+#include "selfTest.h"
+#include "sceneFile.h"
+#include "simdKernels.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+//--------------------------------------------------------------
+// Parses a scene given as text into rayTracer
+static bool parseScene(const string &text, RayTracer &rayTracer, string &error) {
+	std::istringstream input(text);
+	vector<string> dependencies;
+	return SceneFile::parse(input, "", rayTracer, dependencies, error);
+}
+
+//--------------------------------------------------------------
+// Statements one number short of an argument are rejected instead of
+// reading past the end of the line, and complete ones still parse
+static bool testTruncatedStatements(string &error) {
+	static const char *TRUNCATED[] = {
+		"sphere position 0 0 0 radius",
+		"sphere position 0 0",
+		"plane position 0 -2 0 size 10",
+		"camera position 0 0 10 fov",
+	};
+	RayTracer rayTracer;
+	string parseError;
+	for (const char *line : TRUNCATED) {
+		if (parseScene(line, rayTracer, parseError)) {
+			error = string("accepted '") + line + "'";
+			return false;
+		}
+	}
+	if (!parseScene("sphere position 0 0 0 radius 2", rayTracer, parseError)) {
+		error = "rejected a complete sphere: " + parseError;
+		return false;
+	}
+	if (rayTracer.scene.size() != 1 || rayTracer.scene[0]->type != OBJECT_SPHERE ||
+		static_cast<Sphere *>(rayTracer.scene[0])->radius != 2) {
+		error = "complete sphere parsed wrong";
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// A cache whose animation track points before the start of the scene is
+// rejected (so the scene file is parsed again), while the intact cache loads
+static bool testCorruptTrackIndex(string &error) {
+	RayTracer rayTracer;
+	string parseError;
+	if (!parseScene("sphere position 0 0 0 radius 1 name ball\nkey ball frame 0 position 1 2 3", rayTracer, parseError)) {
+		error = "could not parse the animated scene: " + parseError;
+		return false;
+	}
+	string path = (std::filesystem::temp_directory_path() / "rayTracerSelfTest.scene.cache").string();
+	if (!SceneFile::writeCache(path, rayTracer, vector<string>())) {
+		error = "could not write " + path;
+		return false;
+	}
+	RayTracer loaded;
+	bool intact = SceneFile::readCache(path, loaded);
+
+	// the track is the last thing in the cache: its index, property (1 byte),
+	// key count (8 bytes) and its one key follow each other at the end
+	std::ifstream input(path, std::ios::binary);
+	vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+	input.close();
+	size_t at = bytes.size() - (sizeof(int32_t) + 1 + sizeof(uint64_t) + sizeof(Keyframe));
+	int32_t index = -1;
+	memcpy(&bytes[at], &index, sizeof(index));
+	std::ofstream output(path, std::ios::binary | std::ios::trunc);
+	output.write(bytes.data(), bytes.size());
+	output.close();
+	bool corrupt = SceneFile::readCache(path, loaded);
+	remove(path.c_str());
+
+	if (!intact) error = "rejected the intact cache";
+	else if (corrupt) error = "accepted a track of scene object -1";
+	return intact && !corrupt;
+}
+
+//--------------------------------------------------------------
+// A scene file that fails halfway leaves the loaded scene as it was, and a
+// good one replaces it
+static bool testFailedLoadKeepsScene(string &error) {
+	RayTracer rayTracer;
+	string parseError;
+	if (!parseScene("sphere position 0 0 0 radius 1\nsphere position 3 0 0 radius 1", rayTracer, parseError)) {
+		error = "could not parse the first scene: " + parseError;
+		return false;
+	}
+	string path = (std::filesystem::temp_directory_path() / "rayTracerSelfTest.scene").string();
+	remove(SceneFile::cachePath(path).c_str());
+	std::ofstream output(path);
+	output << "sphere position 0 0 0 radius 2" << endl << "sphere position 0 0" << endl;
+	output.close();
+	bool broken = rayTracer.loadScene(path);
+	int objects = (int)rayTracer.scene.size();
+	output.open(path, std::ios::trunc);
+	output << "sphere position 0 0 0 radius 2" << endl;
+	output.close();
+	bool good = rayTracer.loadScene(path);
+	remove(path.c_str());
+	remove(SceneFile::cachePath(path).c_str());
+
+	if (broken) error = "accepted a truncated statement";
+	else if (objects != 2) error = "the failed load left " + ofToString(objects) + " objects instead of 2";
+	else if (!good || rayTracer.scene.size() != 1) error = "the good scene did not replace the old one";
+	return !broken && objects == 2 && good && rayTracer.scene.size() == 1;
+}
+
+//--------------------------------------------------------------
+// Builds a small scene whose floor has a fine checker texture, so texture
+// filtering depends on the footprint, and a mirror sphere for secondary rays
+static void buildTextureScene(RayTracer &rayTracer) {
+	ofPixels checker;
+	checker.allocate(64, 64, OF_IMAGE_COLOR);
+	for (int y = 0; y < 64; y++) {
+		for (int x = 0; x < 64; x++) {
+			checker.setColor(x, y, (x / 4 + y / 4) % 2 == 0 ? ofColor::white : ofColor::black);
+		}
+	}
+	ofImage texture;
+	texture.setUseTexture(false);
+	texture.setFromPixels(checker);
+	rayTracer.floor = rayTracer.addPlane(glm::vec3(0, -2, 0), glm::vec3(0, 1, 0), ofColor::grey);
+	rayTracer.floor->applyTexture(texture);
+	rayTracer.floor->setTiles(20, 20);
+	Material mirror;
+	mirror.reflectance = 0.5f;
+	rayTracer.addSphere(glm::vec3(0, 0, -2), 1.5f, ofColor::blue)->material = (uint16_t)rayTracer.addMaterial(mirror);
+	rayTracer.addSphere(glm::vec3(-3, -1, 1), 1, ofColor::red);
+	rayTracer.addLight(glm::vec3(-4, 5, 4), 100, 0.1f);
+	rayTracer.phongPower = 20;
+	rayTracer.setImageSize(120, 80);
+}
+
+//--------------------------------------------------------------
+// The progressive passes end with the same image as a single full
+// resolution pass: the pixels they keep from coarse passes were shaded
+// (and texture filtered) exactly as the full resolution pass shades them
+static bool testProgressiveMatchesSingle(string &error) {
+	RayTracer rayTracer;
+	buildTextureScene(rayTracer);
+	if (!rayTracer.renderImage(false)) {
+		error = "single pass render cancelled";
+		return false;
+	}
+	Framebuffer single = rayTracer.framebuffer;
+	if (!rayTracer.renderImage(true)) {
+		error = "progressive render cancelled";
+		return false;
+	}
+	for (int y = 0; y < rayTracer.imageHeight; y++) {
+		for (int x = 0; x < rayTracer.imageWidth; x++) {
+			if (rayTracer.framebuffer.getPixel(x, y) != single.getPixel(x, y)) {
+				error = "pixel " + ofToString(x) + ", " + ofToString(y) + " differs";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// The padded lanes of a sphere packet are never hit, even by rays from far
+// away through the origin, where rounding makes |d|^2 - t0^2 very negative
+// (padding at the origin with a negative squared radius was hit by them)
+static bool testSpherePacketPadding(string &error) {
+	alignas(32) SpherePacket packet;
+	packet.clear();
+	packet.centerX[0] = 5;	// one real sphere of radius 1 beside the origin
+	packet.centerY[0] = packet.centerZ[0] = 0;
+	packet.radiusSquared[0] = 1;
+	packet.object[0] = 0;
+	const SimdKernels &kernels = simdKernels();
+	const int DIRECTIONS = 1000;
+	for (float scale = 10; scale <= 1e7f; scale *= 10) {
+		for (int d = 0; d < DIRECTIONS; d++) {
+			// directions spread evenly over the sphere (Fibonacci lattice)
+			float y = 1 - 2 * (d + 0.5f) / DIRECTIONS;
+			float phi = d * 2.39996323f;
+			float r = sqrt(1 - y * y);
+			glm::vec3 direction = glm::normalize(glm::vec3(r * cos(phi), y, r * sin(phi)));
+			float t;
+			int lane = kernels.spheres(packet, -scale * direction, direction, std::numeric_limits<float>::infinity(), t);
+			if (lane > 0) {
+				error = string(kernels.name) + " kernel hit padded lane " + ofToString(lane) + " at distance " + ofToString(scale);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// Returns the tests in the order they run
+vector<SelfTest> selfTests() {
+	vector<SelfTest> tests;
+	tests.push_back({ "scene_truncated_statements", testTruncatedStatements });
+	tests.push_back({ "cache_corrupt_track_index", testCorruptTrackIndex });
+	tests.push_back({ "failed_load_keeps_scene", testFailedLoadKeepsScene });
+	tests.push_back({ "progressive_matches_single", testProgressiveMatchesSingle });
+	tests.push_back({ "sphere_packet_padding", testSpherePacketPadding });
+	return tests;
+}
+
+//--------------------------------------------------------------
+// Runs the tests that match the filter, reporting each one
+int runSelfTests(const string &filter) {
+	int failed = 0;
+	for (const SelfTest &test : selfTests()) {
+		if (!filter.empty() && test.name.find(filter) == string::npos) continue;
+		string error;
+		if (test.run(error)) {
+			cout << test.name << ": ok" << endl;
+		}
+		else {
+			cout << test.name << ": FAILED (" << error << ")" << endl;
+			failed++;
+		}
+	}
+	return failed;
+}
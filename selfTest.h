@@ -0,0 +1,26 @@
+// This file provides the self tests of the renderer, which check the scene
+// parser and the render passes against known results without a window
+// - author: Jared Bechthold
+//
+// The tests run headless with "--self-test" (and "--filter <text>" to run
+// only the tests whose name contains text); the exit code is the number of
+// failed tests.
+
+#pragma once
+
+#include "rayTracer.h"
+#include <functional>
+
+//  One self test
+//
+struct SelfTest {
+	string name;	// name printed with the result
+	// runs the test; returns false and sets error if it fails
+	std::function<bool(string &error)> run;
+};
+
+// returns every self test
+vector<SelfTest> selfTests();
+// runs the tests whose name contains filter and prints their results; returns
+// the process exit code
+int runSelfTests(const string &filter);
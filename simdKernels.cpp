@@ -0,0 +1,250 @@
+// This file provides the scalar, SSE and AVX2 implementations of the
+// sphere and plane packet kernels and picks one at runtime
+// - author: Jared Bechthold
+
+#include "simdKernels.h"
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC compiles intrinsics of any instruction set without extra flags
+#define RT_TARGET_AVX2
+#else
+// GCC and Clang need the instruction set enabled per function
+#define RT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// smallest distance and denominator accepted, the same epsilon used by
+// Sphere::intersect and Plane::intersect
+static const float KERNEL_EPSILON = std::numeric_limits<float>::epsilon();
+static const float KERNEL_INFINITY = std::numeric_limits<float>::infinity();
+
+//--------------------------------------------------------------
+// Fills every lane with a sphere that can never be hit
+void SpherePacket::clear() {
+	for (int i = 0; i < PACKET_WIDTH; i++) {
+		centerX[i] = centerY[i] = centerZ[i] = KERNEL_INFINITY;
+		radiusSquared[i] = -1;
+		object[i] = -1;
+	}
+}
+
+//--------------------------------------------------------------
+// Fills every lane with a plane that can never be hit
+void PlanePacket::clear() {
+	for (int i = 0; i < PACKET_WIDTH; i++) {
+		centerX[i] = centerY[i] = centerZ[i] = 0;
+		normalX[i] = normalY[i] = normalZ[i] = 0;
+		halfWidth[i] = halfHeight[i] = 0;
+		object[i] = -1;
+	}
+}
+
+//--------------------------------------------------------------
+// Returns the lane with the smallest distance below tMax, or -1
+static int closestLane(const float *t, float tMax, float &tHit) {
+	int lane = -1;
+	for (int i = 0; i < PACKET_WIDTH; i++) {
+		if (t[i] < tMax) {
+			tMax = t[i];
+			lane = i;
+		}
+	}
+	tHit = tMax;
+	return lane;
+}
+
+//--------------------------------------------------------------
+// Scalar sphere kernel (reference for the SIMD versions)
+static int spheresScalar(const SpherePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit) {
+	float t[PACKET_WIDTH];
+	for (int i = 0; i < PACKET_WIDTH; i++) {
+		t[i] = KERNEL_INFINITY;
+		float dx = packet.centerX[i] - origin.x;
+		float dy = packet.centerY[i] - origin.y;
+		float dz = packet.centerZ[i] - origin.z;
+		float t0 = dx * dir.x + dy * dir.y + dz * dir.z;
+		float dSquared = dx * dx + dy * dy + dz * dz - t0 * t0;
+		// written so NaN distances of padded lanes are rejected like in the SIMD kernels
+		if (!(dSquared <= packet.radiusSquared[i])) continue;
+		float t1 = sqrtf(packet.radiusSquared[i] - dSquared);
+		float hit = t0 > t1 + KERNEL_EPSILON ? t0 - t1 : t0 + t1;
+		if (hit > KERNEL_EPSILON) t[i] = hit;
+	}
+	return closestLane(t, tMax, tHit);
+}
+
+//--------------------------------------------------------------
+// Scalar plane kernel (reference for the SIMD versions)
+static int planesScalar(const PlanePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit) {
+	float t[PACKET_WIDTH];
+	for (int i = 0; i < PACKET_WIDTH; i++) {
+		t[i] = KERNEL_INFINITY;
+		float denom = dir.x * packet.normalX[i] + dir.y * packet.normalY[i] + dir.z * packet.normalZ[i];
+		if (fabsf(denom) <= KERNEL_EPSILON) continue;
+		float dist = ((packet.centerX[i] - origin.x) * packet.normalX[i] + (packet.centerY[i] - origin.y) * packet.normalY[i]
+			+ (packet.centerZ[i] - origin.z) * packet.normalZ[i]) / denom;
+		if (dist <= 0) continue;
+		float x = origin.x + dist * dir.x;
+		float z = origin.z + dist * dir.z;
+		if (x < packet.centerX[i] + packet.halfWidth[i] && x > packet.centerX[i] - packet.halfWidth[i] &&
+			z < packet.centerZ[i] + packet.halfHeight[i] && z > packet.centerZ[i] - packet.halfHeight[i]) {
+			t[i] = dist;
+		}
+	}
+	return closestLane(t, tMax, tHit);
+}
+
+#ifdef RT_X86
+
+//--------------------------------------------------------------
+// SSE sphere kernel, two groups of 4 lanes
+static int spheresSSE(const SpherePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit) {
+	alignas(16) float t[PACKET_WIDTH];
+	const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+	const __m128 rx = _mm_set1_ps(dir.x), ry = _mm_set1_ps(dir.y), rz = _mm_set1_ps(dir.z);
+	const __m128 eps = _mm_set1_ps(KERNEL_EPSILON), inf = _mm_set1_ps(KERNEL_INFINITY), zero = _mm_setzero_ps();
+	for (int i = 0; i < PACKET_WIDTH; i += 4) {
+		__m128 dx = _mm_sub_ps(_mm_load_ps(packet.centerX + i), ox);
+		__m128 dy = _mm_sub_ps(_mm_load_ps(packet.centerY + i), oy);
+		__m128 dz = _mm_sub_ps(_mm_load_ps(packet.centerZ + i), oz);
+		__m128 r2 = _mm_load_ps(packet.radiusSquared + i);
+		__m128 t0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, rx), _mm_mul_ps(dy, ry)), _mm_mul_ps(dz, rz));
+		__m128 dSquared = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)), _mm_mul_ps(t0, t0));
+		__m128 valid = _mm_cmple_ps(dSquared, r2);
+		__m128 t1 = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(r2, dSquared), zero));
+		// near root when the sphere is in front, far root when the origin is inside
+		__m128 useNear = _mm_cmpgt_ps(t0, _mm_add_ps(t1, eps));
+		__m128 hit = _mm_or_ps(_mm_and_ps(useNear, _mm_sub_ps(t0, t1)), _mm_andnot_ps(useNear, _mm_add_ps(t0, t1)));
+		valid = _mm_and_ps(valid, _mm_cmpgt_ps(hit, eps));
+		_mm_store_ps(t + i, _mm_or_ps(_mm_and_ps(valid, hit), _mm_andnot_ps(valid, inf)));
+	}
+	return closestLane(t, tMax, tHit);
+}
+
+//--------------------------------------------------------------
+// SSE plane kernel, two groups of 4 lanes
+static int planesSSE(const PlanePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit) {
+	alignas(16) float t[PACKET_WIDTH];
+	const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+	const __m128 rx = _mm_set1_ps(dir.x), ry = _mm_set1_ps(dir.y), rz = _mm_set1_ps(dir.z);
+	const __m128 eps = _mm_set1_ps(KERNEL_EPSILON), inf = _mm_set1_ps(KERNEL_INFINITY), zero = _mm_setzero_ps();
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	for (int i = 0; i < PACKET_WIDTH; i += 4) {
+		__m128 cx = _mm_load_ps(packet.centerX + i), cy = _mm_load_ps(packet.centerY + i), cz = _mm_load_ps(packet.centerZ + i);
+		__m128 nx = _mm_load_ps(packet.normalX + i), ny = _mm_load_ps(packet.normalY + i), nz = _mm_load_ps(packet.normalZ + i);
+		__m128 hw = _mm_load_ps(packet.halfWidth + i), hh = _mm_load_ps(packet.halfHeight + i);
+		__m128 denom = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, nx), _mm_mul_ps(ry, ny)), _mm_mul_ps(rz, nz));
+		__m128 valid = _mm_cmpgt_ps(_mm_and_ps(denom, absMask), eps);
+		__m128 num = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(cx, ox), nx), _mm_mul_ps(_mm_sub_ps(cy, oy), ny)), _mm_mul_ps(_mm_sub_ps(cz, oz), nz));
+		__m128 dist = _mm_div_ps(num, denom);
+		valid = _mm_and_ps(valid, _mm_cmpgt_ps(dist, zero));
+		// the hit point must lie inside the plane's width x height area
+		__m128 x = _mm_add_ps(ox, _mm_mul_ps(dist, rx));
+		__m128 z = _mm_add_ps(oz, _mm_mul_ps(dist, rz));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmplt_ps(x, _mm_add_ps(cx, hw)), _mm_cmpgt_ps(x, _mm_sub_ps(cx, hw))));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmplt_ps(z, _mm_add_ps(cz, hh)), _mm_cmpgt_ps(z, _mm_sub_ps(cz, hh))));
+		_mm_store_ps(t + i, _mm_or_ps(_mm_and_ps(valid, dist), _mm_andnot_ps(valid, inf)));
+	}
+	return closestLane(t, tMax, tHit);
+}
+
+//--------------------------------------------------------------
+// AVX2 sphere kernel, all 8 lanes at once
+RT_TARGET_AVX2 static int spheresAVX2(const SpherePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit) {
+	alignas(32) float t[PACKET_WIDTH];
+	const __m256 eps = _mm256_set1_ps(KERNEL_EPSILON), inf = _mm256_set1_ps(KERNEL_INFINITY), zero = _mm256_setzero_ps();
+	__m256 dx = _mm256_sub_ps(_mm256_load_ps(packet.centerX), _mm256_set1_ps(origin.x));
+	__m256 dy = _mm256_sub_ps(_mm256_load_ps(packet.centerY), _mm256_set1_ps(origin.y));
+	__m256 dz = _mm256_sub_ps(_mm256_load_ps(packet.centerZ), _mm256_set1_ps(origin.z));
+	__m256 r2 = _mm256_load_ps(packet.radiusSquared);
+	__m256 t0 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, _mm256_set1_ps(dir.x)), _mm256_mul_ps(dy, _mm256_set1_ps(dir.y))), _mm256_mul_ps(dz, _mm256_set1_ps(dir.z)));
+	__m256 dSquared = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)), _mm256_mul_ps(t0, t0));
+	__m256 valid = _mm256_cmp_ps(dSquared, r2, _CMP_LE_OQ);
+	__m256 t1 = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(r2, dSquared), zero));
+	// near root when the sphere is in front, far root when the origin is inside
+	__m256 useNear = _mm256_cmp_ps(t0, _mm256_add_ps(t1, eps), _CMP_GT_OQ);
+	__m256 hit = _mm256_blendv_ps(_mm256_add_ps(t0, t1), _mm256_sub_ps(t0, t1), useNear);
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(hit, eps, _CMP_GT_OQ));
+	_mm256_store_ps(t, _mm256_blendv_ps(inf, hit, valid));
+	return closestLane(t, tMax, tHit);
+}
+
+//--------------------------------------------------------------
+// AVX2 plane kernel, all 8 lanes at once
+RT_TARGET_AVX2 static int planesAVX2(const PlanePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit) {
+	alignas(32) float t[PACKET_WIDTH];
+	const __m256 ox = _mm256_set1_ps(origin.x), oy = _mm256_set1_ps(origin.y), oz = _mm256_set1_ps(origin.z);
+	const __m256 rx = _mm256_set1_ps(dir.x), ry = _mm256_set1_ps(dir.y), rz = _mm256_set1_ps(dir.z);
+	const __m256 eps = _mm256_set1_ps(KERNEL_EPSILON), inf = _mm256_set1_ps(KERNEL_INFINITY), zero = _mm256_setzero_ps();
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 cx = _mm256_load_ps(packet.centerX), cy = _mm256_load_ps(packet.centerY), cz = _mm256_load_ps(packet.centerZ);
+	__m256 nx = _mm256_load_ps(packet.normalX), ny = _mm256_load_ps(packet.normalY), nz = _mm256_load_ps(packet.normalZ);
+	__m256 hw = _mm256_load_ps(packet.halfWidth), hh = _mm256_load_ps(packet.halfHeight);
+	__m256 denom = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, nx), _mm256_mul_ps(ry, ny)), _mm256_mul_ps(rz, nz));
+	__m256 valid = _mm256_cmp_ps(_mm256_and_ps(denom, absMask), eps, _CMP_GT_OQ);
+	__m256 num = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(cx, ox), nx), _mm256_mul_ps(_mm256_sub_ps(cy, oy), ny)), _mm256_mul_ps(_mm256_sub_ps(cz, oz), nz));
+	__m256 dist = _mm256_div_ps(num, denom);
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(dist, zero, _CMP_GT_OQ));
+	// the hit point must lie inside the plane's width x height area
+	__m256 x = _mm256_add_ps(ox, _mm256_mul_ps(dist, rx));
+	__m256 z = _mm256_add_ps(oz, _mm256_mul_ps(dist, rz));
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(x, _mm256_add_ps(cx, hw), _CMP_LT_OQ), _mm256_cmp_ps(x, _mm256_sub_ps(cx, hw), _CMP_GT_OQ)));
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(z, _mm256_add_ps(cz, hh), _CMP_LT_OQ), _mm256_cmp_ps(z, _mm256_sub_ps(cz, hh), _CMP_GT_OQ)));
+	_mm256_store_ps(t, _mm256_blendv_ps(inf, dist, valid));
+	return closestLane(t, tMax, tHit);
+}
+
+//--------------------------------------------------------------
+// Returns true if the CPU and operating system support AVX2
+static bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	// AVX needs OSXSAVE and the OS saving the ymm registers
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28))) return false;
+	if ((_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+// kernel sets for every instruction set
+static const SimdKernels scalarKernels = { spheresScalar, planesScalar, "scalar" };
+#ifdef RT_X86
+static const SimdKernels sseKernels = { spheresSSE, planesSSE, "sse" };
+static const SimdKernels avx2Kernels = { spheresAVX2, planesAVX2, "avx2" };
+#endif
+
+//--------------------------------------------------------------
+// Returns the fastest kernels the CPU supports (SSE2 is part of every x86-64 CPU)
+const SimdKernels &simdKernels() {
+#ifdef RT_X86
+	static const SimdKernels &best = cpuSupportsAVX2() ? avx2Kernels : sseKernels;
+	return best;
+#else
+	return scalarKernels;
+#endif
+}
+
+//--------------------------------------------------------------
+// Returns the kernels of the named instruction set if they can run here
+const SimdKernels &simdKernels(const char *name) {
+#ifdef RT_X86
+	if (strcmp(name, "avx2") == 0 && cpuSupportsAVX2()) return avx2Kernels;
+	if (strcmp(name, "sse") == 0) return sseKernels;
+#endif
+	return scalarKernels;
+}
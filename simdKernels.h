@@ -0,0 +1,65 @@
+// This file provides the structure-of-arrays primitive packets and the
+// SIMD kernels that intersect one ray with up to 8 spheres or planes
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// number of primitives stored in one packet
+static const int PACKET_WIDTH = 8;
+
+//  Up to 8 spheres stored as structure of arrays
+//  Unused lanes are centered at infinity: their distances are NaN, which
+//  fails every kernel's comparisons, however far the ray origin is (a
+//  negative squared radius alone is beaten by the rounding of dSquared).
+//
+struct alignas(32) SpherePacket {
+	float centerX[PACKET_WIDTH];
+	float centerY[PACKET_WIDTH];
+	float centerZ[PACKET_WIDTH];
+	float radiusSquared[PACKET_WIDTH];
+	int object[PACKET_WIDTH];		// index of the SceneObject in each lane
+
+	// fills every lane with a sphere that can never be hit
+	void clear();
+};
+
+//  Up to 8 planes stored as structure of arrays
+//  Each plane is limited to |x - centerX| < halfWidth and |z - centerZ| < halfHeight,
+//  the same range as Plane::intersect. Unused lanes have a zero normal.
+//
+struct alignas(32) PlanePacket {
+	float centerX[PACKET_WIDTH];
+	float centerY[PACKET_WIDTH];
+	float centerZ[PACKET_WIDTH];
+	float normalX[PACKET_WIDTH];
+	float normalY[PACKET_WIDTH];
+	float normalZ[PACKET_WIDTH];
+	float halfWidth[PACKET_WIDTH];
+	float halfHeight[PACKET_WIDTH];
+	int object[PACKET_WIDTH];		// index of the SceneObject in each lane
+
+	// fills every lane with a plane that can never be hit
+	void clear();
+};
+
+// kernel that intersects one ray with every lane of a packet; returns the lane
+// of the closest hit with distance in (0, tMax) and stores the distance in tHit,
+// or returns -1 if no lane is hit
+typedef int (*SphereKernel)(const SpherePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit);
+typedef int (*PlaneKernel)(const PlanePacket &packet, const glm::vec3 &origin, const glm::vec3 &dir, float tMax, float &tHit);
+
+//  Set of kernels for one instruction set
+//
+struct SimdKernels {
+	SphereKernel spheres;
+	PlaneKernel planes;
+	const char *name;	// "avx2", "sse" or "scalar"
+};
+
+// returns the fastest kernels supported by the CPU (detected once)
+const SimdKernels &simdKernels();
+// returns the kernels for a given instruction set name, falling back to
+// scalar if the CPU or compiler does not support it (for testing and benchmarks)
+const SimdKernels &simdKernels(const char *name);
@@ -0,0 +1,169 @@
+// This file provides the implementation of the Texture class
+// - author: Jared Bechthold
+
+#include "texture.h"
+
+// spreads the low 16 bits of x to the even bits of the result
+static uint32_t spreadBits(uint32_t x) {
+	x &= 0xffff;
+	x = (x | (x << 8)) & 0x00ff00ffu;
+	x = (x | (x << 4)) & 0x0f0f0f0fu;
+	x = (x | (x << 2)) & 0x33333333u;
+	x = (x | (x << 1)) & 0x55555555u;
+	return x;
+}
+
+// returns the Morton (Z order) index of block (x, y)
+static uint32_t morton(uint32_t x, uint32_t y) {
+	return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+// packs an RGB color into a texel
+static uint32_t packTexel(int r, int g, int b) {
+	return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | 0xff000000u;
+}
+
+// unpacks the RGB channels of a texel
+static glm::vec3 unpackTexel(uint32_t t) {
+	return glm::vec3((float)(t & 0xff), (float)((t >> 8) & 0xff), (float)((t >> 16) & 0xff));
+}
+
+// wraps a texel coordinate into [0, size)
+static int wrap(int x, int size) {
+	x %= size;
+	return x < 0 ? x + size : x;
+}
+
+//--------------------------------------------------------------
+// Copies the image into the tiled full resolution level and averages
+// 2x2 texels of each level into the next one down to a single texel
+void Texture::build(const ofPixels &pixels) {
+	clear();
+	int width = (int)pixels.getWidth();
+	int height = (int)pixels.getHeight();
+	int channels = (int)pixels.getNumChannels();
+	if (width <= 0 || height <= 0 || channels < 3) return;
+
+	// count the levels and reserve all texels at once
+	size_t total = 0;
+	for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+		total += (size_t)((w + 3) / 4) * ((h + 3) / 4) * 16;
+		if (w == 1 && h == 1) break;
+	}
+	texels.reserve(total * 2);
+
+	// full resolution level
+	addLevel(width, height);
+	const unsigned char *data = pixels.getData();
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const unsigned char *p = data + ((size_t)y * width + x) * channels;
+			texels[texelIndex(levels[0], x, y)] = packTexel(p[0], p[1], p[2]);
+		}
+	}
+
+	// box filtered levels
+	while (levels.back().width > 1 || levels.back().height > 1) {
+		int source = (int)levels.size() - 1;
+		addLevel(std::max(1, levels[source].width / 2), std::max(1, levels[source].height / 2));
+		const Level &from = levels[source];
+		const Level &to = levels.back();
+		for (int y = 0; y < to.height; y++) {
+			for (int x = 0; x < to.width; x++) {
+				glm::vec3 sum = unpackTexel(fetch(from, 2 * x, 2 * y)) + unpackTexel(fetch(from, 2 * x + 1, 2 * y)) +
+					unpackTexel(fetch(from, 2 * x, 2 * y + 1)) + unpackTexel(fetch(from, 2 * x + 1, 2 * y + 1));
+				sum = sum * 0.25f + glm::vec3(0.5f);
+				texels[texelIndex(to, x, y)] = packTexel((int)sum.x, (int)sum.y, (int)sum.z);
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+// Lays the blocks of a level out in Morton order unless that would waste
+// more than half of the level's storage on padding
+Texture::Level &Texture::addLevel(int width, int height) {
+	Level level;
+	level.width = width;
+	level.height = height;
+	level.blocksX = (width + 3) / 4;
+	level.blocksY = (height + 3) / 4;
+	level.offset = texels.size();
+	size_t blocks = (size_t)level.blocksX * level.blocksY;
+	size_t mortonBlocks = (size_t)morton(level.blocksX - 1, level.blocksY - 1) + 1;
+	level.morton = level.blocksX <= 0x10000 && level.blocksY <= 0x10000 && mortonBlocks <= 2 * blocks;
+	texels.resize(texels.size() + (level.morton ? mortonBlocks : blocks) * 16, 0);
+	levels.push_back(level);
+	return levels.back();
+}
+
+//--------------------------------------------------------------
+// Finds the block of the texel and its position inside the 4x4 block
+size_t Texture::texelIndex(const Level &level, int x, int y) const {
+	size_t block = level.morton ? morton(x >> 2, y >> 2) : (size_t)(y >> 2) * level.blocksX + (x >> 2);
+	return level.offset + block * 16 + ((y & 3) << 2) + (x & 3);
+}
+
+//--------------------------------------------------------------
+// Reads a texel, repeating the level in both directions
+uint32_t Texture::fetch(const Level &level, int x, int y) const {
+	return texels[texelIndex(level, wrap(x, level.width), wrap(y, level.height))];
+}
+
+//--------------------------------------------------------------
+// Measures the longer of the two footprint axes in full resolution texels
+float Texture::levelOfDetail(glm::vec2 dUVdx, glm::vec2 dUVdy) const {
+	if (levels.empty()) return 0;
+	glm::vec2 size((float)levels[0].width, (float)levels[0].height);
+	float footprint = std::max(glm::length(dUVdx * size), glm::length(dUVdy * size));
+	return footprint > 1 ? log2(footprint) : 0;
+}
+
+//--------------------------------------------------------------
+// Dispatches to the sampler of the filter
+glm::vec3 Texture::sample(float u, float v, TextureFilter filter, float lod) const {
+	if (levels.empty()) return glm::vec3(0);
+	switch (filter) {
+	case TEXTURE_NEAREST:
+		return sampleNearest(u, v);
+	case TEXTURE_BILINEAR:
+		return sampleBilinear(u, v);
+	default:
+		return sampleTrilinear(u, v, lod);
+	}
+}
+
+//--------------------------------------------------------------
+// Returns the texel that contains (u, v)
+glm::vec3 Texture::sampleNearest(float u, float v, int level) const {
+	const Level &l = levels[level];
+	return unpackTexel(fetch(l, (int)floor(u * l.width), (int)floor(v * l.height)));
+}
+
+//--------------------------------------------------------------
+// Weighs the 4 texel centers around (u, v) by their distance
+glm::vec3 Texture::sampleBilinear(float u, float v, int level) const {
+	const Level &l = levels[level];
+	float x = u * l.width - 0.5f;
+	float y = v * l.height - 0.5f;
+	float x0 = floor(x);
+	float y0 = floor(y);
+	float fx = x - x0;
+	float fy = y - y0;
+	int ix = (int)x0;
+	int iy = (int)y0;
+	glm::vec3 top = glm::mix(unpackTexel(fetch(l, ix, iy)), unpackTexel(fetch(l, ix + 1, iy)), fx);
+	glm::vec3 bottom = glm::mix(unpackTexel(fetch(l, ix, iy + 1)), unpackTexel(fetch(l, ix + 1, iy + 1)), fx);
+	return glm::mix(top, bottom, fy);
+}
+
+//--------------------------------------------------------------
+// Blends the two levels around lod (clamped to the mip chain)
+glm::vec3 Texture::sampleTrilinear(float u, float v, float lod) const {
+	int last = (int)levels.size() - 1;
+	if (lod <= 0) return sampleBilinear(u, v, 0);
+	if (lod >= last) return sampleBilinear(u, v, last);
+	int level = (int)lod;
+	float t = lod - level;
+	return glm::mix(sampleBilinear(u, v, level), sampleBilinear(u, v, level + 1), t);
+}
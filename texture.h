@@ -0,0 +1,69 @@
+// This file provides the class definition of Texture, a mipmapped image
+// stored in a tiled layout for fast filtered sampling
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "ofMain.h"
+#include <cstdint>
+
+//  Filters used to sample a Texture
+//
+enum TextureFilter {
+	TEXTURE_NEAREST,	// closest texel of the full resolution level
+	TEXTURE_BILINEAR,	// 4 texels of the full resolution level
+	TEXTURE_TRILINEAR	// 4 texels of the two levels that match the pixel footprint
+};
+
+//  Repeating RGB texture with a prebuilt mip chain
+//  Texels are stored as packed RGBA in 4x4 blocks of 64 bytes (one cache
+//  line), and the blocks of each level are laid out in Morton order, so the
+//  2x2 texels of a bilinear lookup and the lookups of neighboring pixels
+//  usually hit the same cache lines. Texture coordinates repeat every 1.0
+//  and texel centers are at (i + 0.5) / width.
+//
+class Texture {
+public:
+	// builds the mip chain from the pixels of an image (RGB or RGBA)
+	void build(const ofPixels &pixels);
+	// frees the texels
+	void clear() { levels.clear(); texels.clear(); }
+	// returns true if no image has been built
+	bool empty() const { return levels.empty(); }
+	// returns the width and height of the full resolution level
+	int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+	int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+	// returns the number of mip levels
+	int levelCount() const { return (int)levels.size(); }
+
+	// returns the mip level whose texels match a pixel footprint given by the
+	// texture coordinate derivatives along the image x and y axes
+	float levelOfDetail(glm::vec2 dUVdx, glm::vec2 dUVdy) const;
+	// samples the texture at (u, v) with a filter; lod is only used by TEXTURE_TRILINEAR
+	glm::vec3 sample(float u, float v, TextureFilter filter, float lod = 0) const;
+	// samples the closest texel of a level
+	glm::vec3 sampleNearest(float u, float v, int level = 0) const;
+	// interpolates the 4 texels around (u, v) of a level
+	glm::vec3 sampleBilinear(float u, float v, int level = 0) const;
+	// interpolates between the bilinear samples of the two levels around lod
+	glm::vec3 sampleTrilinear(float u, float v, float lod) const;
+
+private:
+	//  One mip level
+	struct Level {
+		int width, height;		// size in texels
+		int blocksX, blocksY;	// size in 4x4 blocks
+		bool morton;			// blocks in Morton order (false for very elongated levels)
+		size_t offset;			// index of the level's first texel
+	};
+
+	// returns the index of texel (x, y) of a level; x and y must be in range
+	size_t texelIndex(const Level &level, int x, int y) const;
+	// returns texel (x, y) of a level, wrapping coordinates outside the level
+	uint32_t fetch(const Level &level, int x, int y) const;
+	// appends a level of the given size and returns it (texels set to 0)
+	Level &addLevel(int width, int height);
+
+	vector<Level> levels;		// full resolution level first
+	vector<uint32_t> texels;	// packed RGBA texels of all levels
+};
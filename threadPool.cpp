@@ -0,0 +1,108 @@
+// This file provides the implementation of the WorkStealingPool
+// - author: Jared Bechthold
+
+#include "threadPool.h"
+
+// Creates the per worker queues and starts the worker threads
+WorkStealingPool::WorkStealingPool(int numThreads) : queues(numThreads > 0 ? numThreads : hardwareThreads()) {
+	for (int i = 0; i < (int)queues.size(); i++) {
+		workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+	}
+}
+
+// Signals all workers to exit and waits for them
+WorkStealingPool::~WorkStealingPool() {
+	{
+		std::lock_guard<std::mutex> guard(runLock);
+		shuttingDown = true;
+	}
+	workReady.notify_all();
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+}
+
+// Returns the number of hardware threads (hardware_concurrency may report 0)
+int WorkStealingPool::hardwareThreads() {
+	unsigned cores = std::thread::hardware_concurrency();
+	return cores > 0 ? (int)cores : 1;
+}
+
+// Deals the tasks out to the worker queues, wakes the workers and waits
+// until every task has run
+void WorkStealingPool::run(int taskCount, const TaskFunction &task, bool deterministic) {
+	if (taskCount <= 0) return;
+
+	stealing = !deterministic;
+	{
+		std::lock_guard<std::mutex> guard(runLock);
+		remaining = taskCount;
+	}
+
+	// deal tasks round-robin so every worker starts with an even share of work
+	for (int i = 0; i < taskCount; i++) {
+		WorkQueue &queue = queues[i % queues.size()];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.tasks.push_back(WorkItem{ i, &task });
+	}
+
+	std::unique_lock<std::mutex> guard(runLock);
+	generation++;
+	workReady.notify_all();
+	workDone.wait(guard, [this] { return remaining == 0; });
+}
+
+// Waits for a new run, then executes tasks until no queue has work left
+void WorkStealingPool::workerLoop(int worker) {
+	unsigned seenGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(runLock);
+			workReady.wait(guard, [&] { return shuttingDown || generation != seenGeneration; });
+			if (shuttingDown) return;
+			seenGeneration = generation;
+		}
+
+		WorkItem item;
+		int finished = 0;
+		while (nextTask(worker, item)) {
+			(*item.function)(item.index, worker);
+			finished++;
+		}
+
+		// report finished tasks; the last worker to finish wakes run()
+		if (finished > 0) {
+			std::lock_guard<std::mutex> guard(runLock);
+			remaining -= finished;
+			if (remaining == 0) workDone.notify_all();
+		}
+	}
+}
+
+// Takes the oldest task from the worker's own queue; when it is empty and
+// stealing is enabled, takes the newest task from another worker's queue
+bool WorkStealingPool::nextTask(int worker, WorkItem &item) {
+	{
+		WorkQueue &own = queues[worker];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.tasks.empty()) {
+			item = own.tasks.front();
+			own.tasks.pop_front();
+			return true;
+		}
+	}
+	if (!stealing) return false;
+
+	// visit the other workers starting with the next one so thieves spread out
+	int count = (int)queues.size();
+	for (int offset = 1; offset < count; offset++) {
+		WorkQueue &victim = queues[(worker + offset) % count];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.tasks.empty()) {
+			item = victim.tasks.back();
+			victim.tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
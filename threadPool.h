@@ -0,0 +1,71 @@
+// This file provides the class definition of WorkStealingPool, a fixed
+// size pool of worker threads used to run independent render tasks
+// - author: Jared Bechthold
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//  Thread pool where every worker owns a queue of task indices and
+//  idle workers steal from the queues of busy workers
+//
+class WorkStealingPool {
+public:
+	// task callback receives the index of the task and the index of the worker running it
+	typedef std::function<void(int task, int worker)> TaskFunction;
+
+	// creates a pool of numThreads workers (0 uses the number of hardware cores)
+	WorkStealingPool(int numThreads = 0);
+	// joins all workers
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool &) = delete;
+	WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+	// runs taskCount tasks and blocks until all of them have finished
+	// (only one thread may call run at a time)
+	// in deterministic mode tasks are dealt round-robin to workers and never stolen,
+	// so every task always runs on the same worker in the same order
+	void run(int taskCount, const TaskFunction &task, bool deterministic = false);
+
+	// returns the number of worker threads in the pool
+	int size() const { return (int)workers.size(); }
+
+	// returns the number of cores reported by the system (at least 1)
+	static int hardwareThreads();
+
+private:
+	// a queued task keeps the callback of the run it belongs to
+	struct WorkItem {
+		int index;
+		const TaskFunction *function;
+	};
+
+	// per worker queue of tasks
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<WorkItem> tasks;
+	};
+
+	// main loop of each worker thread
+	void workerLoop(int worker);
+	// pops a task from the worker's own queue or steals one from another worker
+	bool nextTask(int worker, WorkItem &item);
+
+	std::vector<std::thread> workers;		// worker threads
+	std::vector<WorkQueue> queues;			// one queue per worker
+	std::atomic<bool> stealing{ true };	// disabled in deterministic mode
+
+	std::mutex runLock;						// guards generation, remaining and shuttingDown
+	std::condition_variable workReady;		// signals workers that a new run started
+	std::condition_variable workDone;		// signals run() that all tasks finished
+	unsigned generation = 0;				// incremented for every run
+	int remaining = 0;						// tasks left in the current run
+	bool shuttingDown = false;				// set by the destructor
+};
@@ -0,0 +1,110 @@
+// This file provides the implementation of the TileRenderer
+// - author: Jared Bechthold
+
+#include "tileRenderer.h"
+#include <algorithm>
+#include <cstdint>
+
+// Sets the number of render threads; the pool is rebuilt on the next render
+void TileRenderer::setThreadCount(int threads) {
+	threads = threads > 0 ? threads : 0;
+	if (threads != threadCount) {
+		threadCount = threads;
+		pool.reset();
+	}
+}
+
+// Returns the number of threads used to render
+int TileRenderer::getThreadCount() {
+	return getPool().size();
+}
+
+// Creates the pool if it does not exist yet
+WorkStealingPool &TileRenderer::getPool() {
+	if (!pool) pool.reset(new WorkStealingPool(threadCount));
+	return *pool;
+}
+
+// Splits the region into tileSize x tileSize tiles (edge tiles may be smaller)
+// listed in the tile order
+std::vector<Tile> TileRenderer::makeTiles(const Tile &region) const {
+	int columns = (region.x1 - region.x0 + tileSize - 1) / tileSize;
+	int rows = (region.y1 - region.y0 + tileSize - 1) / tileSize;
+	std::vector<int> cells;
+	curveOrder(columns, rows, order, cells);
+	std::vector<Tile> tiles;
+	for (int cell : cells) {
+		int x = region.x0 + cell / rows * tileSize;
+		int y = region.y0 + cell % rows * tileSize;
+		Tile tile(x, y, std::min(x + tileSize, region.x1), std::min(y + tileSize, region.y1));
+		tile.index = (int)tiles.size();
+		tiles.push_back(tile);
+	}
+	return tiles;
+}
+
+// Spreads the low 16 bits of v to the even bits of the result
+static uint32_t spreadBits(uint32_t v) {
+	v &= 0xffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+// Returns the distance of cell (x, y) along the Hilbert curve over an n x n
+// grid (n a power of two), rotating the quadrant at every level
+static uint64_t hilbertDistance(uint32_t n, uint32_t x, uint32_t y) {
+	uint64_t d = 0;
+	for (uint32_t s = n / 2; s > 0; s /= 2) {
+		uint32_t rx = (x & s) > 0;
+		uint32_t ry = (y & s) > 0;
+		d += (uint64_t)s * s * ((3 * rx) ^ ry);
+		if (ry == 0) {
+			if (rx == 1) {
+				x = s - 1 - (x & (s - 1));
+				y = s - 1 - (y & (s - 1));
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+// Numbers every cell along the curve over the smallest power of two square
+// holding the grid and sorts the cells by it; cells of the square outside
+// the grid are skipped, so the order stays local on grids of any shape
+void curveOrder(int columns, int rows, PixelOrder order, std::vector<int> &cells) {
+	cells.resize(std::max(columns, 0) * std::max(rows, 0));
+	for (int k = 0; k < (int)cells.size(); k++) {
+		cells[k] = k;
+	}
+	if (order == PIXEL_ORDER_COLUMNS) return;
+
+	uint32_t n = 1;
+	while (n < (uint32_t)std::max(columns, rows)) n *= 2;
+	std::vector<uint64_t> keys(cells.size());
+	for (int k = 0; k < (int)cells.size(); k++) {
+		uint32_t x = k / rows, y = k % rows;
+		keys[k] = order == PIXEL_ORDER_MORTON ? (spreadBits(x) | (spreadBits(y) << 1)) : hilbertDistance(n, x, y);
+	}
+	std::sort(cells.begin(), cells.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+}
+
+// Matches the names of the command line
+bool parsePixelOrder(const std::string &name, PixelOrder &order) {
+	if (name == "columns") order = PIXEL_ORDER_COLUMNS;
+	else if (name == "morton") order = PIXEL_ORDER_MORTON;
+	else if (name == "hilbert") order = PIXEL_ORDER_HILBERT;
+	else return false;
+	return true;
+}
+
+// Renders all tiles of the region on the pool
+void TileRenderer::render(const Tile &region, const TileFunction &renderTile) {
+	std::vector<Tile> tiles = makeTiles(region);
+	getPool().run((int)tiles.size(), [&](int task, int worker) {
+		renderTile(tiles[task], worker);
+	}, deterministic);
+}
@@ -0,0 +1,102 @@
+// This file provides the class definitions Tile and TileRenderer used to
+// split an image into tiles and render them on a WorkStealingPool
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "threadPool.h"
+#include <memory>
+#include <string>
+
+// order the tiles of an image and the pixels of a tile are rendered in
+enum PixelOrder {
+	PIXEL_ORDER_COLUMNS,	// column by column from the left, each from the bottom up
+	PIXEL_ORDER_MORTON,		// Z-order curve: cells next in the order are mostly neighbors in the image
+	PIXEL_ORDER_HILBERT		// Hilbert curve: every step moves to an adjacent cell
+};
+
+// fills cells with the indices (column * rows + row) of the cells of a
+// columns x rows grid in the given order
+void curveOrder(int columns, int rows, PixelOrder order, std::vector<int> &cells);
+// returns the order with the given name ("columns", "morton" or "hilbert");
+// returns false if the name is unknown
+bool parsePixelOrder(const std::string &name, PixelOrder &order);
+
+//  Last grid order computed by curveOrder(), kept so the tiles of a pass,
+//  which are nearly all the same size, only compute it once per thread
+//
+class CurveOrder {
+public:
+	// returns the cells of a columns x rows grid in the given order
+	const std::vector<int> &cells(int columns, int rows, PixelOrder order) {
+		if (columns != this->columns || rows != this->rows || order != this->order) {
+			curveOrder(columns, rows, order, list);
+			this->columns = columns;
+			this->rows = rows;
+			this->order = order;
+		}
+		return list;
+	}
+
+private:
+	int columns = -1;			// grid of the list
+	int rows = -1;
+	PixelOrder order = PIXEL_ORDER_COLUMNS;	// order of the list
+	std::vector<int> list;		// cells in order
+};
+
+//  Rectangular region of the image in pixel coordinates
+//  covering columns [x0, x1) and rows [y0, y1)
+//
+class Tile {
+public:
+	// Tile constructor
+	Tile(int x0, int y0, int x1, int y1) { this->x0 = x0; this->y0 = y0; this->x1 = x1; this->y1 = y1; }
+
+	// returns the number of pixels covered by the tile
+	int pixelCount() const { return (x1 - x0) * (y1 - y0); }
+
+	int x0, y0, x1, y1;	// bounds of the tile
+	int index = 0;		// position of the tile in the render order
+};
+
+//  Splits an image into tiles and renders them in parallel
+//
+class TileRenderer {
+public:
+	// callback that renders one tile on the given worker
+	typedef std::function<void(const Tile &tile, int worker)> TileFunction;
+
+	// sets the number of render threads (0 uses all hardware cores)
+	void setThreadCount(int threads);
+	// returns the number of threads that render() uses
+	int getThreadCount();
+	// sets the width and height of each tile in pixels
+	void setTileSize(int size) { tileSize = size > 0 ? size : 1; }
+	// in deterministic mode every tile is always rendered by the same worker,
+	// which makes per-worker state reproducible for regression tests
+	void setDeterministic(bool enabled) { deterministic = enabled; }
+	// sets the order the tiles are handed to the workers in
+	void setOrder(PixelOrder order) { this->order = order; }
+
+	// builds the tile list for a width x height image
+	std::vector<Tile> makeTiles(int width, int height) const { return makeTiles(Tile(0, 0, width, height)); }
+	// builds the tile list covering a region of the image
+	std::vector<Tile> makeTiles(const Tile &region) const;
+	// renders every tile of a width x height image and blocks until all are done
+	void render(int width, int height, const TileFunction &renderTile) { render(Tile(0, 0, width, height), renderTile); }
+	// renders every tile of a region of the image and blocks until all are done
+	void render(const Tile &region, const TileFunction &renderTile);
+
+	int tileSize = 32;			// width and height of each tile
+	bool deterministic = false;	// disables work stealing when true
+	PixelOrder order = PIXEL_ORDER_HILBERT;	// order of the tiles, so tiles rendered at the same
+											//  time share the scene data they touch
+
+private:
+	// creates the pool on first use or after the thread count changed
+	WorkStealingPool &getPool();
+
+	int threadCount = 0;						// requested threads (0 = hardware cores)
+	std::unique_ptr<WorkStealingPool> pool;		// worker threads, created lazily
+};
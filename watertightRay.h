@@ -0,0 +1,68 @@
+// This file provides the class definition of WatertightRay, the ray/triangle
+// test shared by meshes and area lights
+// - author: Jared Bechthold
+
+#pragma once
+
+#include "rayTracer.h"
+
+//  Ray transformed for the watertight ray/triangle test of Woop, Benthin
+//  and Wald (2013). The ray is sheared so it points along +z, which makes
+//  the edge tests exact on shared edges (no cracks between triangles).
+//
+class WatertightRay {
+public:
+	// precomputes the axis permutation and shear for the ray
+	WatertightRay(const Ray &ray) {
+		origin = ray.p;
+		// z axis is the dimension where the ray direction is largest
+		glm::vec3 absDir = glm::abs(ray.d);
+		kz = absDir.x > absDir.y ? (absDir.x > absDir.z ? 0 : 2) : (absDir.y > absDir.z ? 1 : 2);
+		kx = (kz + 1) % 3;
+		ky = (kx + 1) % 3;
+		// swap kx and ky to keep the winding of triangles
+		if (ray.d[kz] < 0) std::swap(kx, ky);
+		sx = ray.d[kx] / ray.d[kz];
+		sy = ray.d[ky] / ray.d[kz];
+		sz = 1.0f / ray.d[kz];
+	}
+
+	// tests the triangle (v0, v1, v2); returns true and sets t if it is hit in (0, tMax)
+	bool intersect(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2, float tMax, float &t) const {
+		// vertices relative to the ray origin
+		glm::vec3 a = v0 - origin;
+		glm::vec3 b = v1 - origin;
+		glm::vec3 c = v2 - origin;
+
+		// shear and scale the vertices into ray space
+		float ax = a[kx] - sx * a[kz];
+		float ay = a[ky] - sy * a[kz];
+		float bx = b[kx] - sx * b[kz];
+		float by = b[ky] - sy * b[kz];
+		float cx = c[kx] - sx * c[kz];
+		float cy = c[ky] - sy * c[kz];
+
+		// scaled barycentric coordinates
+		double u = (double)cx * by - (double)cy * bx;
+		double v = (double)ax * cy - (double)ay * cx;
+		double w = (double)bx * ay - (double)by * ax;
+
+		// the ray misses if the edge functions have mixed signs
+		if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0)) return false;
+		double det = u + v + w;
+		if (det == 0) return false;
+
+		// scaled hit distance
+		double az = sz * a[kz];
+		double bz = sz * b[kz];
+		double cz = sz * c[kz];
+		double hit = (u * az + v * bz + w * cz) / det;
+		if (hit <= 0 || hit >= tMax) return false;
+		t = (float)hit;
+		return true;
+	}
+
+	glm::vec3 origin;	// origin of the ray
+	int kx, ky, kz;		// permutation of the axes
+	float sx, sy, sz;	// shear constants
+};